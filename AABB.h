@@ -0,0 +1,73 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+//==============================================================================
+
+struct AABB
+{
+	glm::vec3 min;
+	glm::vec3 max;
+
+	AABB() noexcept :
+		min( FLT_MAX,  FLT_MAX,  FLT_MAX),
+		max(-FLT_MAX, -FLT_MAX, -FLT_MAX)
+	{
+	}
+
+	AABB(const glm::vec3 &min, const glm::vec3 &max) noexcept :
+		min(min),
+		max(max)
+	{
+	}
+
+	void Add(const glm::vec3 &point) noexcept
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	void Add(const AABB &box) noexcept
+	{
+		min = glm::min(min, box.min);
+		max = glm::max(max, box.max);
+	}
+
+	void Inflate(float value) noexcept
+	{
+		min -= glm::vec3(value);
+		max += glm::vec3(value);
+	}
+
+	glm::vec3 GetCenter() const noexcept
+	{
+		return 0.5f * (min + max);
+	}
+
+	float GetArea() const noexcept
+	{
+		const auto d = glm::max(max - min, glm::vec3(0.0f));
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	bool Overlaps(const AABB &box) const noexcept
+	{
+		return (min.x <= box.max.x) && (max.x >= box.min.x) &&
+		       (min.y <= box.max.y) && (max.y >= box.min.y) &&
+		       (min.z <= box.max.z) && (max.z >= box.min.z);
+	}
+
+	bool Contains(const glm::vec3 &point) const noexcept
+	{
+		return (point.x >= min.x) && (point.x <= max.x) &&
+		       (point.y >= min.y) && (point.y <= max.y) &&
+		       (point.z >= min.z) && (point.z <= max.z);
+	}
+};
+
+//==============================================================================
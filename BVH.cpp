@@ -0,0 +1,363 @@
+
+#include "BVH.h"
+
+#include <algorithm>
+
+#include "MemoryReport.h"
+
+//==============================================================================
+
+void BVH::Subdivide(uint node, const std::vector<AABB> &boxes, uint depth) noexcept
+{
+	const auto first = nodes[node].first;
+	const auto count = nodes[node].count;
+
+	if (count <= leaf_size)
+	{
+		return;
+	}
+
+	AABB bounds;
+	for (uint i = first; i < first + count; i++)
+	{
+		bounds.Add(centroids[primitives[i]]);
+	}
+
+	const auto left_count = Split(first, count, bounds, boxes, depth);
+
+	const auto left  = static_cast<uint>(nodes.size());
+	const auto right = left + 1;
+
+	nodes.push_back({ AABB(), first, left_count });
+	nodes.push_back({ AABB(), first + left_count, count - left_count });
+
+	for (const auto child : { left, right })
+	{
+		auto &box = nodes[child].box;
+		for (uint i = nodes[child].first; i < nodes[child].first + nodes[child].count; i++)
+		{
+			box.Add(boxes[primitives[i]]);
+		}
+	}
+
+	nodes[node].first = left;
+	nodes[node].count = 0;
+
+	Subdivide(left,  boxes, depth + 1);
+	Subdivide(right, boxes, depth + 1);
+}
+
+//==============================================================================
+
+uint BVH::Split(uint first, uint count, const AABB &bounds, const std::vector<AABB> &boxes, uint depth) noexcept
+{
+	const auto extent = bounds.max - bounds.min;
+
+	uint axis = 0;
+	if (extent.y > extent[axis]) axis = 1;
+	if (extent.z > extent[axis]) axis = 2;
+
+	const auto begin = primitives.begin() + first;
+	const auto end   = begin + count;
+
+	const auto median = [&]()
+	{
+		const auto middle = begin + count / 2;
+		std::nth_element(begin, middle, end, [&](uint a, uint b)
+		{
+			return centroids[a][axis] < centroids[b][axis];
+		});
+
+		return count / 2;
+	};
+
+	if ((depth >= max_depth) || (extent[axis] <= FLT_EPSILON))
+	{
+		return median();
+	}
+
+	constexpr uint bins = 16;
+
+	AABB bin_boxes[bins];
+	uint bin_counts[bins] = {};
+
+	const auto scale = static_cast<float>(bins) / extent[axis];
+	const auto bin = [&](uint primitive)
+	{
+		const auto b = static_cast<uint>((centroids[primitive][axis] - bounds.min[axis]) * scale);
+		return std::min(b, bins - 1);
+	};
+
+	for (auto it = begin; it != end; ++it)
+	{
+		const auto b = bin(*it);
+		bin_counts[b]++;
+		bin_boxes[b].Add(boxes[*it]);
+	}
+
+	float right_areas[bins];
+	AABB box;
+	for (uint i = bins - 1; i > 0; i--)
+	{
+		box.Add(bin_boxes[i]);
+		right_areas[i] = box.GetArea();
+	}
+
+	auto best_cost = FLT_MAX;
+	uint best_bin = 0;
+
+	box = AABB();
+	uint left_count = 0;
+	for (uint i = 0; i < bins - 1; i++)
+	{
+		box.Add(bin_boxes[i]);
+		left_count += bin_counts[i];
+
+		const auto right_count = count - left_count;
+		if (!left_count || !right_count)
+		{
+			continue;
+		}
+
+		const auto cost = box.GetArea() * left_count + right_areas[i + 1] * right_count;
+		if (cost < best_cost)
+		{
+			best_cost = cost;
+			best_bin = i;
+		}
+	}
+
+	if (best_cost == FLT_MAX)
+	{
+		return median();
+	}
+
+	const auto middle = std::partition(begin, end, [&](uint primitive)
+	{
+		return bin(primitive) <= best_bin;
+	});
+
+	return static_cast<uint>(middle - begin);
+}
+
+//==============================================================================
+
+BVH::BVH() noexcept :
+	build_quality(0.0f),
+	rebuild_threshold(1.5f)
+{
+}
+
+//==============================================================================
+
+bool BVH::IsEmpty() const noexcept
+{
+	return nodes.empty();
+}
+
+//==============================================================================
+
+const AABB &BVH::GetBounds() const noexcept
+{
+	static const AABB empty;
+
+	if (nodes.empty())
+	{
+		return empty;
+	}
+
+	return nodes[0].box;
+}
+
+//==============================================================================
+
+const std::vector<BVH::Node> &BVH::GetNodes() const noexcept
+{
+	return nodes;
+}
+
+//==============================================================================
+
+const std::vector<uint> &BVH::GetPrimitives() const noexcept
+{
+	return primitives;
+}
+
+//==============================================================================
+
+float BVH::GetQuality() const noexcept
+{
+	if (nodes.empty())
+	{
+		return 0.0f;
+	}
+
+	auto area = 0.0f;
+	for (const auto &node : nodes)
+	{
+		if (!node.count)
+		{
+			area += node.box.GetArea();
+		}
+	}
+
+	const auto root_area = nodes[0].box.GetArea();
+
+	return (root_area > 0.0f) ? area / root_area : 0.0f;
+}
+
+//==============================================================================
+
+void BVH::SetRebuildThreshold(float value) noexcept
+{
+	rebuild_threshold = value;
+}
+
+//==============================================================================
+
+void BVH::GetSelfQueryTasks(uint count, std::vector<std::pair<uint, uint>> &tasks) const noexcept
+{
+	tasks.clear();
+
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	// Breadth first, in place: tasks holds the finished pairs, then the queue
+	// of the current level, then the pairs the level expands to.
+
+	uint finished = 0;
+	tasks.emplace_back(0, 0);
+
+	while ((finished < tasks.size()) && (tasks.size() < count))
+	{
+		const auto level = static_cast<uint>(tasks.size());
+
+		for (auto k = finished; k < level; k++)
+		{
+			const auto pair = tasks[k];
+
+			const auto &a = nodes[pair.first];
+			const auto &b = nodes[pair.second];
+
+			if (pair.first == pair.second)
+			{
+				if (a.count)
+				{
+					tasks[finished++] = pair;
+				}
+				else
+				{
+					tasks.emplace_back(a.first, a.first);
+					tasks.emplace_back(a.first + 1, a.first + 1);
+					tasks.emplace_back(a.first, a.first + 1);
+				}
+			}
+			else
+			if (a.box.Overlaps(b.box))
+			{
+				if (a.count || b.count)
+				{
+					tasks[finished++] = pair;
+				}
+				else
+				{
+					tasks.emplace_back(a.first, b.first);
+					tasks.emplace_back(a.first, b.first + 1);
+					tasks.emplace_back(a.first + 1, b.first);
+					tasks.emplace_back(a.first + 1, b.first + 1);
+				}
+			}
+		}
+
+		tasks.erase(tasks.begin() + finished, tasks.begin() + level);
+	}
+}
+
+//==============================================================================
+
+void BVH::Build(const std::vector<AABB> &boxes) noexcept
+{
+	const auto size = static_cast<uint>(boxes.size());
+
+	nodes.clear();
+	primitives.resize(size);
+	centroids.resize(size);
+
+	if (!size)
+	{
+		build_quality = 0.0f;
+		return;
+	}
+
+	AABB bounds;
+	for (uint i = 0; i < size; i++)
+	{
+		primitives[i] = i;
+		centroids[i] = boxes[i].GetCenter();
+		bounds.Add(boxes[i]);
+	}
+
+	nodes.reserve(2 * (size / leaf_size + 1));
+	nodes.push_back({ bounds, 0, size });
+
+	Subdivide(0, boxes, 0);
+
+	build_quality = GetQuality();
+}
+
+//==============================================================================
+
+void BVH::Refit(const std::vector<AABB> &boxes) noexcept
+{
+	if (boxes.size() != primitives.size())
+	{
+		Build(boxes);
+		return;
+	}
+
+	for (auto i = nodes.size(); i-- > 0;)
+	{
+		auto &node = nodes[i];
+
+		AABB box;
+		if (node.count)
+		{
+			for (uint j = node.first; j < node.first + node.count; j++)
+			{
+				box.Add(boxes[primitives[j]]);
+			}
+		}
+		else
+		{
+			box = nodes[node.first].box;
+			box.Add(nodes[node.first + 1].box);
+		}
+
+		node.box = box;
+	}
+}
+
+//==============================================================================
+
+void BVH::Update(const std::vector<AABB> &boxes) noexcept
+{
+	Refit(boxes);
+
+	if (GetQuality() > rebuild_threshold * build_quality)
+	{
+		Build(boxes);
+	}
+}
+
+//==============================================================================
+
+void BVH::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "nodes", MemoryReport::GetBytes(nodes));
+	report.Add(prefix + "primitives", MemoryReport::GetBytes(primitives));
+	report.Add(prefix + "centroids", MemoryReport::GetBytes(centroids));
+}
+
+//==============================================================================
@@ -0,0 +1,240 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AABB.h"
+#include "Ray.h"
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class MemoryReport;
+
+//==============================================================================
+
+class BVH
+{
+public:
+	struct Node
+	{
+		AABB box;
+		uint first; // left child for inner nodes, first primitive for leaves
+		uint count; // 0 for inner nodes
+	};
+
+private:
+	std::vector<Node> nodes;
+	std::vector<uint> primitives;
+	std::vector<glm::vec3> centroids;
+
+	float build_quality;
+	float rebuild_threshold;
+
+	static constexpr uint leaf_size = 4;
+	static constexpr uint max_depth = 48;
+	static constexpr uint stack_size = 96;
+	static constexpr uint pair_stack_size = 2 * stack_size + 2; // two depths, up to two pending pairs per level
+
+private:
+	void Subdivide(uint node, const std::vector<AABB> &boxes, uint depth) noexcept;
+	uint Split(uint first, uint count, const AABB &bounds, const std::vector<AABB> &boxes, uint depth) noexcept;
+
+public:
+	BVH() noexcept;
+
+	bool IsEmpty() const noexcept;
+	const AABB &GetBounds() const noexcept;
+	const std::vector<Node> &GetNodes() const noexcept;
+	const std::vector<uint> &GetPrimitives() const noexcept;
+
+	float GetQuality() const noexcept;
+	void SetRebuildThreshold(float value) noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+
+	void Build  (const std::vector<AABB> &boxes) noexcept;
+	void Refit  (const std::vector<AABB> &boxes) noexcept;
+	void Update (const std::vector<AABB> &boxes) noexcept;
+
+	template <typename Callback>
+	void Query(const AABB &box, Callback callback) const noexcept;
+
+	template <typename Callback>
+	void Raycast(const Ray &ray, float tmax, Callback callback) const noexcept;
+
+	void GetSelfQueryTasks(uint count, std::vector<std::pair<uint, uint>> &tasks) const noexcept;
+
+	template <typename Callback>
+	void SelfQuery(uint node1, uint node2, Callback callback) const noexcept;
+};
+
+//==============================================================================
+
+template <typename Callback>
+void BVH::Query(const AABB &box, Callback callback) const noexcept
+{
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	uint stack[stack_size];
+	uint size = 0;
+	stack[size++] = 0;
+
+	while (size)
+	{
+		const auto &node = nodes[stack[--size]];
+		if (!node.box.Overlaps(box))
+		{
+			continue;
+		}
+
+		if (node.count)
+		{
+			for (uint i = node.first; i < node.first + node.count; i++)
+			{
+				callback(primitives[i]);
+			}
+		}
+		else
+		{
+			stack[size++] = node.first + 1;
+			stack[size++] = node.first;
+		}
+	}
+}
+
+//==============================================================================
+
+template <typename Callback>
+void BVH::Raycast(const Ray &ray, float tmax, Callback callback) const noexcept
+{
+	float t;
+	if (nodes.empty() || !ray.BoxIntersection(nodes[0].box, tmax, t))
+	{
+		return;
+	}
+
+	uint stack[stack_size];
+	uint size = 0;
+	stack[size++] = 0;
+
+	while (size)
+	{
+		const auto &node = nodes[stack[--size]];
+		if (!ray.BoxIntersection(node.box, tmax, t))
+		{
+			continue;
+		}
+
+		if (node.count)
+		{
+			for (uint i = node.first; i < node.first + node.count; i++)
+			{
+				callback(primitives[i], tmax);
+			}
+		}
+		else
+		{
+			const auto left  = node.first;
+			const auto right = node.first + 1;
+
+			float t1, t2;
+			const auto hit1 = ray.BoxIntersection(nodes[left].box,  tmax, t1);
+			const auto hit2 = ray.BoxIntersection(nodes[right].box, tmax, t2);
+
+			if (hit1 && hit2)
+			{
+				stack[size++] = (t1 < t2) ? right : left;
+				stack[size++] = (t1 < t2) ? left : right;
+			}
+			else
+			if (hit1)
+			{
+				stack[size++] = left;
+			}
+			else
+			if (hit2)
+			{
+				stack[size++] = right;
+			}
+		}
+	}
+}
+
+//==============================================================================
+
+template <typename Callback>
+void BVH::SelfQuery(uint node1, uint node2, Callback callback) const noexcept
+{
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	std::pair<uint, uint> stack[pair_stack_size];
+	uint size = 0;
+	stack[size++] = std::make_pair(node1, node2);
+
+	while (size)
+	{
+		const auto pair = stack[--size];
+
+		const auto &a = nodes[pair.first];
+		const auto &b = nodes[pair.second];
+
+		if (pair.first == pair.second)
+		{
+			if (a.count)
+			{
+				for (uint i = a.first; i < a.first + a.count; i++)
+				for (uint j = i + 1; j < a.first + a.count; j++)
+				{
+					callback(primitives[i], primitives[j]);
+				}
+			}
+			else
+			{
+				stack[size++] = std::make_pair(a.first, a.first);
+				stack[size++] = std::make_pair(a.first + 1, a.first + 1);
+				stack[size++] = std::make_pair(a.first, a.first + 1);
+			}
+
+			continue;
+		}
+
+		if (!a.box.Overlaps(b.box))
+		{
+			continue;
+		}
+
+		if (a.count && b.count)
+		{
+			for (uint i = a.first; i < a.first + a.count; i++)
+			for (uint j = b.first; j < b.first + b.count; j++)
+			{
+				callback(primitives[i], primitives[j]);
+			}
+		}
+		else
+		if (a.count || (!b.count && (b.box.GetArea() > a.box.GetArea())))
+		{
+			stack[size++] = std::make_pair(pair.first, b.first);
+			stack[size++] = std::make_pair(pair.first, b.first + 1);
+		}
+		else
+		{
+			stack[size++] = std::make_pair(a.first, pair.second);
+			stack[size++] = std::make_pair(a.first + 1, pair.second);
+		}
+	}
+}
+
+//==============================================================================
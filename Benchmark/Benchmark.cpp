@@ -0,0 +1,557 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Collider.h"
+#include "Memory.h"
+#include "MemoryReport.h"
+#include "PerfCounters.h"
+#include "Physics.h"
+#include "Trace.h"
+
+//==============================================================================
+
+struct Scene
+{
+	std::string name;
+	uint vertices;
+};
+
+struct Options
+{
+	uint frames;
+	bool telemetry;
+	bool memory;
+	bool allocations;
+	Solver solver;
+	uint iterations; // of block descent, 0 for its default
+	uint threads;
+	bool pinned;
+	bool self_collision;
+	bool continuous_collision;
+};
+
+struct Result
+{
+	uint particles;
+	double seconds;
+	double checksum;
+	unsigned long long hash;
+	std::string phases;
+	std::string quality;
+	std::string memory;
+	std::string allocations;
+	bool allocation_free;
+};
+
+//==============================================================================
+
+const uint substeps = 5; // fixed by Physics::Simulate
+
+//==============================================================================
+
+uint GetSide(uint vertices) noexcept
+{
+	const auto side = static_cast<uint>(std::lround(std::sqrt(static_cast<double>(vertices))));
+	return (side < 2) ? 2 : side;
+}
+
+//==============================================================================
+
+void GetGrid(uint nx, uint ny, std::vector<uint> &indices) noexcept
+{
+	indices.clear();
+	indices.reserve(6 * nx * ny);
+
+	for (uint i = 0; i < nx; i++)
+	{
+		for (uint j = 0; j < ny; j++)
+		{
+			indices.push_back((i + 0) * (ny + 1) + (j + 0));
+			indices.push_back((i + 1) * (ny + 1) + (j + 0));
+			indices.push_back((i + 0) * (ny + 1) + (j + 1));
+
+			indices.push_back((i + 1) * (ny + 1) + (j + 1));
+			indices.push_back((i + 0) * (ny + 1) + (j + 1));
+			indices.push_back((i + 1) * (ny + 1) + (j + 0));
+		}
+	}
+}
+
+//==============================================================================
+
+uint AddSheet(Physics &physics, uint vertices) noexcept
+{
+	const auto step = 1.0f / static_cast<float>(GetSide(vertices) - 1);
+	const auto cloth = physics.AddCloth(1.0f, 1.0f, step);
+
+	const auto nx = static_cast<uint>(1.0f / step);
+	const auto ny = static_cast<uint>(1.0f / step);
+
+	physics.FixClothPoint(cloth, (ny + 1) - 1);
+	physics.FixClothPoint(cloth, (ny + 1) * (nx + 1) - 1);
+
+	return cloth;
+}
+
+//==============================================================================
+
+uint AddFlag(Physics &physics, uint vertices) noexcept
+{
+	const auto step = 1.0f / static_cast<float>(GetSide(vertices) - 1);
+	const auto cloth = physics.AddCloth(1.5f, 1.0f, step);
+
+	const auto ny = static_cast<uint>(1.0f / step);
+
+	for (uint j = 0; j < ny + 1; j++)
+	{
+		physics.FixClothPoint(cloth, j);
+	}
+
+	physics.SetGravity(glm::vec3(4.0f, -9.8f, 1.0f));
+
+	return cloth;
+}
+
+//==============================================================================
+
+uint AddDrape(Physics &physics, uint vertices) noexcept
+{
+	const auto side = GetSide(vertices);
+	const auto n = side - 1;
+	const auto step = 1.0f / static_cast<float>(n);
+
+	const auto radius = 0.25f;
+	const auto center = glm::vec3(0.0f, 0.1f, 0.0f);
+
+	// starts resting on the sphere, half an edge above it (the cloth
+	// thickness), so the contacts begin in the first frames
+	const auto height = center.y + radius + 0.5f * step;
+
+	std::vector<float> V;
+	V.reserve(3 * side * side);
+
+	for (uint i = 0; i < side; i++)
+	{
+		for (uint j = 0; j < side; j++)
+		{
+			V.push_back(i * step - 0.5f);
+			V.push_back(height);
+			V.push_back(j * step - 0.5f);
+		}
+	}
+
+	std::vector<uint> indices;
+	GetGrid(n, n, indices);
+
+	const auto cloth = physics.AddCloth(V, indices);
+
+	const auto sphere = physics.AddCollider(new SphereCollider(radius));
+	physics.SetColliderTransform(sphere, glm::translate(glm::mat4(1.0f), center));
+
+	const auto floor = physics.AddCollider(new PlaneCollider);
+	physics.SetColliderTransform(floor, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, 0.0f)));
+
+	return cloth;
+}
+
+//==============================================================================
+
+bool Run(const Scene &scene, const Options &options, Result &result) noexcept
+{
+	srand(1);
+
+	Physics physics;
+	if (options.threads || options.pinned)
+	{
+		physics.SetThreads(options.threads, options.pinned);
+	}
+
+	physics.SetSelfCollision(options.self_collision);
+	physics.SetContinuousCollision(options.continuous_collision);
+	physics.SetTelemetry(options.telemetry);
+	physics.SetSolver(options.solver);
+
+	if (options.iterations)
+	{
+		physics.SetBlockDescentIterations(options.iterations);
+	}
+
+	uint cloth;
+	if (scene.name == "sheet")
+	{
+		cloth = AddSheet(physics, scene.vertices);
+	}
+	else
+	if (scene.name == "flag")
+	{
+		cloth = AddFlag(physics, scene.vertices);
+	}
+	else
+	if (scene.name == "drape")
+	{
+		cloth = AddDrape(physics, scene.vertices);
+	}
+	else
+	{
+		return false;
+	}
+
+	std::vector<float> vertices;
+	std::vector<float> normals;
+	std::vector<float> uvs;
+	std::vector<uint>  indices;
+
+	const auto warmup = std::min(10u, options.frames / 2);
+
+	Memory::Counts simulate = { 0, 0 };
+	Memory::Counts render = { 0, 0 };
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (uint i = 0; i < options.frames; i++)
+	{
+		physics.Simulate();
+
+		if (options.allocations)
+		{
+			// the viewer's per-frame fetch, minus the GL upload
+			const AllocationCounter counter;
+			physics.GetCloth(cloth, vertices, normals, uvs, indices);
+
+			if (i >= warmup)
+			{
+				const auto &frame = physics.GetFrameAllocations();
+				const auto fetch = counter.Get();
+
+				simulate.allocations += frame.allocations;
+				simulate.bytes += frame.bytes;
+				render.allocations += fetch.allocations;
+				render.bytes += fetch.bytes;
+			}
+		}
+	}
+
+	const auto finish = std::chrono::steady_clock::now();
+
+	result.phases.clear();
+	for (const auto &name : physics.GetProfiler().GetNames())
+	{
+		Profiler::Stats stats;
+		physics.GetTimerStats(name, stats);
+
+		char text[256];
+		snprintf(text, sizeof(text), "%s\"%s\": {\"unit\": \"%s\", \"mean\": %.2f, \"p50\": %.2f, \"p99\": %.2f, \"max\": %.2f}",
+		         result.phases.empty() ? "" : ", ", name.c_str(), stats.unit, stats.mean, stats.p50, stats.p99, stats.max);
+		result.phases += text;
+	}
+
+	result.quality.clear();
+
+	SolverStats stats;
+	if (physics.GetSolverStats(cloth, stats))
+	{
+		char iterations[32] = "";
+		if (stats.iterative)
+		{
+			snprintf(iterations, sizeof(iterations), ", \"iterations\": %u", stats.iterations);
+		}
+
+		char text[256];
+		snprintf(text, sizeof(text), ", \"quality\": {\"max_stretch\": %.6g, \"rms_stretch\": %.6g, "
+		         "\"max_bend_error\": %.6g, \"rms_bend_error\": %.6g, \"kinetic_energy\": %.6g, \"fallback\": %s%s}",
+		         stats.max_stretch, stats.rms_stretch, stats.max_bend_error, stats.rms_bend_error, stats.kinetic_energy,
+		         stats.fallback ? "true" : "false", iterations);
+		result.quality = text;
+	}
+
+	result.memory.clear();
+
+	if (options.memory)
+	{
+		MemoryReport report;
+		physics.GetMemoryUsage(report);
+
+		char text[256];
+		snprintf(text, sizeof(text), ", \"memory\": {\"total\": %zu, \"construction_peak\": %zu",
+		         report.GetTotal(), physics.GetConstructionPeak(cloth));
+		result.memory = text;
+
+		for (const auto &entry : report.GetEntries())
+		{
+			snprintf(text, sizeof(text), ", \"%s\": %zu", entry.name.c_str(), entry.bytes);
+			result.memory += text;
+		}
+
+		result.memory += "}";
+	}
+
+	result.allocations.clear();
+	result.allocation_free = (simulate.allocations == 0) && (render.allocations == 0);
+
+	if (options.allocations)
+	{
+		char text[256];
+		snprintf(text, sizeof(text), ", \"allocations\": {\"warmup\": %u, \"simulate\": %llu, \"simulate_bytes\": %llu, "
+		         "\"render\": %llu, \"render_bytes\": %llu}",
+		         warmup, simulate.allocations, simulate.bytes, render.allocations, render.bytes);
+		result.allocations = text;
+	}
+
+	physics.GetCloth(cloth, vertices, normals, uvs, indices);
+
+	result.particles = static_cast<uint>(vertices.size() / 3);
+	result.seconds = std::chrono::duration<double>(finish - start).count();
+	result.checksum = 0.0;
+	result.hash = 14695981039346656037ull;
+
+	for (const auto v : vertices)
+	{
+		result.checksum += v;
+
+		unsigned int bits;
+		memcpy(&bits, &v, sizeof(bits));
+
+		for (uint k = 0; k < 4; k++)
+		{
+			result.hash ^= (bits >> (8 * k)) & 0xff;
+			result.hash *= 1099511628211ull;
+		}
+	}
+
+	return true;
+}
+
+//==============================================================================
+
+long GetPeakMemory() noexcept
+{
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss; // kilobytes on Linux
+}
+
+//==============================================================================
+
+std::vector<uint> ParseList(const char *text) noexcept
+{
+	std::vector<uint> values;
+
+	while (*text)
+	{
+		char *end;
+		const auto value = strtoul(text, &end, 10);
+		if (end == text)
+		{
+			break;
+		}
+
+		values.push_back(static_cast<uint>(value));
+		text = (*end == ',') ? end + 1 : end;
+	}
+
+	return values;
+}
+
+//==============================================================================
+
+void PrintUsage() noexcept
+{
+	printf("usage: cloth_benchmark [--scene=sheet|flag|drape|all] [--vertices=N[,N...]] [--frames=N] [--solver=xpbd|stencil|tiled|block_descent|projective_dynamics|implicit_euler] [--iterations=N] [--threads=N] [--pin] [--no-self-collision] [--continuous-collision] [--telemetry] [--memory] [--allocations] [--trace=file.json]\n");
+}
+
+//==============================================================================
+
+int main(int argc, char **argv)
+{
+	std::string scene_name = "all";
+	std::vector<uint> sizes = { 1000, 4000, 16000, 64000, 256000, 1000000, 4000000 };
+	Options options = { 100, false, false, false, Solver::XPBD, 0, 0, false, true, false };
+	std::string trace;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const auto arg = argv[i];
+
+		if (strncmp(arg, "--scene=", 8) == 0)
+		{
+			scene_name = arg + 8;
+		}
+		else
+		if (strncmp(arg, "--vertices=", 11) == 0)
+		{
+			sizes = ParseList(arg + 11);
+		}
+		else
+		if (strncmp(arg, "--frames=", 9) == 0)
+		{
+			options.frames = static_cast<uint>(strtoul(arg + 9, nullptr, 10));
+		}
+		else
+		if (strcmp(arg, "--solver=xpbd") == 0)
+		{
+			options.solver = Solver::XPBD;
+		}
+		else
+		if (strcmp(arg, "--solver=stencil") == 0)
+		{
+			options.solver = Solver::STENCIL;
+		}
+		else
+		if (strcmp(arg, "--solver=tiled") == 0)
+		{
+			options.solver = Solver::TILED;
+		}
+		else
+		if (strcmp(arg, "--solver=block_descent") == 0)
+		{
+			options.solver = Solver::BLOCK_DESCENT;
+		}
+		else
+		if (strcmp(arg, "--solver=projective_dynamics") == 0)
+		{
+			options.solver = Solver::PROJECTIVE_DYNAMICS;
+		}
+		else
+		if (strcmp(arg, "--solver=implicit_euler") == 0)
+		{
+			options.solver = Solver::IMPLICIT_EULER;
+		}
+		else
+		if (strncmp(arg, "--iterations=", 13) == 0)
+		{
+			options.iterations = static_cast<uint>(strtoul(arg + 13, nullptr, 10));
+		}
+		else
+		if (strncmp(arg, "--threads=", 10) == 0)
+		{
+			options.threads = static_cast<uint>(strtoul(arg + 10, nullptr, 10));
+		}
+		else
+		if (strcmp(arg, "--pin") == 0)
+		{
+			options.pinned = true;
+		}
+		else
+		if (strcmp(arg, "--no-self-collision") == 0)
+		{
+			options.self_collision = false;
+		}
+		else
+		if (strcmp(arg, "--continuous-collision") == 0)
+		{
+			options.continuous_collision = true;
+		}
+		else
+		if (strcmp(arg, "--telemetry") == 0)
+		{
+			options.telemetry = true;
+		}
+		else
+		if (strcmp(arg, "--memory") == 0)
+		{
+			options.memory = true;
+		}
+		else
+		if (strcmp(arg, "--allocations") == 0)
+		{
+			options.allocations = true;
+		}
+		else
+		if (strncmp(arg, "--trace=", 8) == 0)
+		{
+			trace = arg + 8;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	std::vector<Scene> scenes;
+	for (const auto &name : { "sheet", "flag", "drape" })
+	{
+		if ((scene_name == "all") || (scene_name == name))
+		{
+			for (const auto size : sizes)
+			{
+				scenes.push_back({ name, size });
+			}
+		}
+	}
+
+	if (scenes.empty() || (options.frames == 0))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+#ifdef CLOTH_PERF
+	if (!PerfCounters::IsAvailable())
+	{
+		fprintf(stderr, "hardware performance counters are not available\n");
+	}
+#endif
+
+	if (options.allocations && !Memory::IsTracking())
+	{
+		fprintf(stderr, "--allocations needs a build with CLOTH_MEMORY\n");
+		return 1;
+	}
+
+	printf("{\n  \"frames\": %u,\n  \"substeps\": %u,\n  \"scenes\": [\n", options.frames, substeps);
+
+	auto allocation_free = true;
+
+	for (size_t i = 0; i < scenes.size(); i++)
+	{
+		const auto &scene = scenes[i];
+
+		Result result;
+		Run(scene, options, result);
+
+		allocation_free = allocation_free && result.allocation_free;
+
+		const auto steps = static_cast<double>(options.frames) * substeps * result.particles;
+
+		printf("    {\"scene\": \"%s\", \"vertices\": %u, \"seconds\": %.6f, "
+		       "\"ns_per_particle_substep\": %.3f, \"fps\": %.3f, \"peak_rss_kb\": %ld, "
+		       "\"checksum\": %.9g, \"hash\": \"%016llx\", \"phases\": {%s}%s%s%s}%s\n",
+		       scene.name.c_str(), result.particles, result.seconds,
+		       1.0e9 * result.seconds / steps, options.frames / result.seconds, GetPeakMemory(),
+		       result.checksum, result.hash, result.phases.c_str(), result.quality.c_str(), result.memory.c_str(), result.allocations.c_str(),
+		       (i + 1 < scenes.size()) ? "," : "");
+
+		fflush(stdout);
+	}
+
+	printf("  ]\n}\n");
+
+	if (!trace.empty() && !Trace::Write(trace))
+	{
+		fprintf(stderr, "cannot write %s\n", trace.c_str());
+		return 1;
+	}
+
+	if (!allocation_free)
+	{
+		fprintf(stderr, "steady-state frames allocated memory\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+//==============================================================================
@@ -0,0 +1,961 @@
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Cloth.h"
+#include "ClothBatch.h"
+#include "Constraint.h"
+#include "Particle.h"
+#include "Ray.h"
+#include "StencilSolver.h"
+#include "ThreadPool.h"
+#include "TiledSolver.h"
+#include "Topology.h"
+#include "TriangleBatch.h"
+
+//==============================================================================
+
+struct Options
+{
+	std::vector<uint> sizes;
+	uint warmup;
+	uint repetitions;
+	std::string filter;
+};
+
+struct Stats
+{
+	double min;
+	double median;
+	double mean;
+	double stddev;
+	double max;
+};
+
+//==============================================================================
+
+volatile double sink = 0.0;
+
+//==============================================================================
+
+Stats Measure(uint warmup, uint repetitions, const std::function<void()> &kernel) noexcept
+{
+	for (uint i = 0; i < warmup; i++)
+	{
+		kernel();
+	}
+
+	std::vector<double> samples(repetitions);
+	for (auto &sample : samples)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		kernel();
+		const auto finish = std::chrono::steady_clock::now();
+
+		sample = std::chrono::duration<double, std::nano>(finish - start).count();
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	Stats stats;
+	stats.min = samples.front();
+	stats.max = samples.back();
+	stats.median = (repetitions % 2) ? samples[repetitions / 2] :
+	               0.5 * (samples[repetitions / 2 - 1] + samples[repetitions / 2]);
+
+	auto sum = 0.0;
+	for (const auto sample : samples)
+	{
+		sum += sample;
+	}
+	stats.mean = sum / repetitions;
+
+	auto variance = 0.0;
+	for (const auto sample : samples)
+	{
+		variance += (sample - stats.mean) * (sample - stats.mean);
+	}
+	stats.stddev = (repetitions > 1) ? std::sqrt(variance / (repetitions - 1)) : 0.0;
+
+	return stats;
+}
+
+//==============================================================================
+
+void Report(const Options &options, const char *kernel, uint vertices, uint elements,
+            const std::function<void()> &function) noexcept
+{
+	if (!options.filter.empty() && !strstr(kernel, options.filter.c_str()))
+	{
+		return;
+	}
+
+	const auto stats = Measure(options.warmup, options.repetitions, function);
+
+	static auto first = true;
+	printf("%s    {\"kernel\": \"%s\", \"vertices\": %u, \"elements\": %u, "
+	       "\"min_ns\": %.0f, \"median_ns\": %.0f, \"mean_ns\": %.0f, \"stddev_ns\": %.0f, \"max_ns\": %.0f, "
+	       "\"median_ns_per_element\": %.3f}",
+	       first ? "" : ",\n", kernel, vertices, elements,
+	       stats.min, stats.median, stats.mean, stats.stddev, stats.max,
+	       stats.median / std::max(elements, 1u));
+	fflush(stdout);
+
+	first = false;
+}
+
+//==============================================================================
+
+uint GetOpposite(const std::vector<uint> &indices, uint triangle, uint ind1, uint ind2) noexcept
+{
+	for (uint k = 0; k < 2; k++)
+	{
+		const auto index = indices[3 * triangle + k];
+		if ((index != ind1) && (index != ind2))
+		{
+			return index;
+		}
+	}
+
+	return indices[3 * triangle + 2];
+}
+
+//==============================================================================
+
+// The hash map construction Topology used before sorting half-edges, kept as
+// the reference the sorted one is validated and timed against
+struct ReferenceTopology
+{
+	std::vector<Topology::Edge> edges;
+
+	std::vector<std::unordered_map<uint, uint>> vertices_vertices_edges;
+	std::vector<std::vector<uint>> vertices_edges;
+	std::vector<std::vector<uint>> vertices_triangles;
+	std::vector<std::vector<uint>> edges_triangles;
+
+	ReferenceTopology(uint vertices_size, const std::vector<uint> &indices) noexcept
+	{
+		vertices_vertices_edges.resize(vertices_size);
+
+		for (uint i = 0; i < indices.size(); i += 3)
+		{
+			for (uint j = 0; j < 3; j++)
+			{
+				const auto ind1 = indices[i + j];
+				const auto ind2 = indices[i + (j + 1) % 3];
+
+				auto &edges1 = vertices_vertices_edges[ind1];
+				auto &edges2 = vertices_vertices_edges[ind2];
+
+				if ((edges1.find(ind2) == edges1.end()) &&
+					(edges2.find(ind1) == edges2.end()))
+				{
+					edges.emplace_back(ind1, ind2);
+
+					const auto edge = static_cast<uint>(edges.size() - 1);
+					edges1[ind2] = edge;
+					edges2[ind1] = edge;
+				}
+			}
+		}
+
+		edges_triangles.resize(edges.size());
+		vertices_triangles.resize(vertices_size);
+
+		for (uint i = 0, triangle = 0; i < indices.size(); i += 3, triangle++)
+		{
+			const auto ind1 = indices[i + 0];
+			const auto ind2 = indices[i + 1];
+			const auto ind3 = indices[i + 2];
+
+			edges_triangles[vertices_vertices_edges[ind1][ind2]].push_back(triangle);
+			edges_triangles[vertices_vertices_edges[ind2][ind3]].push_back(triangle);
+			edges_triangles[vertices_vertices_edges[ind3][ind1]].push_back(triangle);
+
+			vertices_triangles[ind1].push_back(triangle);
+			if (ind2 != ind1)
+			{
+				vertices_triangles[ind2].push_back(triangle);
+			}
+			if ((ind3 != ind1) && (ind3 != ind2))
+			{
+				vertices_triangles[ind3].push_back(triangle);
+			}
+		}
+
+		vertices_edges.resize(vertices_size);
+
+		for (uint i = 0; i < edges.size(); i++)
+		{
+			auto &edge = edges[i];
+
+			vertices_edges[edge.ind1].push_back(i);
+			if (edge.ind2 != edge.ind1)
+			{
+				vertices_edges[edge.ind2].push_back(i);
+			}
+
+			const auto &triangles = edges_triangles[i];
+			edge.boundary = (triangles.size() <= 1);
+			if (!edge.boundary)
+			{
+				edge.ind3 = GetOpposite(indices, triangles[0], edge.ind1, edge.ind2);
+				edge.ind4 = GetOpposite(indices, triangles[1], edge.ind1, edge.ind2);
+			}
+		}
+	}
+
+	bool IsAdjacent(uint ind1, uint ind2) const noexcept
+	{
+		return vertices_vertices_edges[ind1].count(ind2) != 0;
+	}
+};
+
+//==============================================================================
+
+// number of edges and vertices whose adjacency differs from the reference
+uint Compare(const Topology &topology, const ReferenceTopology &reference, uint vertices_size) noexcept
+{
+	const auto &edges = topology.GetEdges();
+	if (edges.size() != reference.edges.size())
+	{
+		return static_cast<uint>(std::max(edges.size(), reference.edges.size()));
+	}
+
+	const auto Same = [](Topology::Range range, const std::vector<uint> &values)
+	{
+		return (range.size() == values.size()) && std::equal(range.begin(), range.end(), values.begin());
+	};
+
+	uint mismatches = 0;
+
+	for (uint e = 0; e < edges.size(); e++)
+	{
+		const auto &E = edges[e];
+		const auto &R = reference.edges[e];
+
+		if ((E.ind1 != R.ind1) || (E.ind2 != R.ind2) || (E.boundary != R.boundary) ||
+			(!E.boundary && ((E.ind3 != R.ind3) || (E.ind4 != R.ind4))) ||
+			!Same(topology.GetEdgeTriangles(e), reference.edges_triangles[e]))
+		{
+			mismatches++;
+		}
+	}
+
+	for (uint v = 0; v < vertices_size; v++)
+	{
+		auto same = Same(topology.GetVertexEdges(v), reference.vertices_edges[v]) &&
+		            Same(topology.GetVertexTriangles(v), reference.vertices_triangles[v]);
+
+		for (uint w = 0; w < vertices_size; w++)
+		{
+			same = same && (topology.IsAdjacent(v, w) == reference.IsAdjacent(v, w));
+		}
+
+		mismatches += same ? 0 : 1;
+	}
+
+	return mismatches;
+}
+
+//==============================================================================
+
+// number of stencils of the StencilSolver that are not constraints of the topology, and the reverse
+uint CompareStencils(const Topology &topology, const StencilSolver &solver) noexcept
+{
+	std::vector<uint> distances;
+	std::vector<uint> bends;
+	solver.GetStencils(distances, bends);
+
+	std::vector<std::array<uint, 4>> expected;
+	std::vector<std::array<uint, 4>> actual;
+
+	for (const auto &edge : topology.GetEdges())
+	{
+		expected.push_back({ { std::min(edge.ind1, edge.ind2), std::max(edge.ind1, edge.ind2), ~0u, ~0u } });
+
+		if (!edge.boundary)
+		{
+			expected.push_back({ { edge.ind1, edge.ind2, edge.ind3, edge.ind4 } });
+		}
+	}
+
+	for (uint i = 0; i < distances.size(); i += 2)
+	{
+		actual.push_back({ { std::min(distances[i], distances[i + 1]), std::max(distances[i], distances[i + 1]), ~0u, ~0u } });
+	}
+
+	for (uint i = 0; i < bends.size(); i += 4)
+	{
+		actual.push_back({ { bends[i + 0], bends[i + 1], bends[i + 2], bends[i + 3] } });
+	}
+
+	std::sort(expected.begin(), expected.end());
+	std::sort(actual.begin(), actual.end());
+
+	std::vector<std::array<uint, 4>> difference;
+	std::set_symmetric_difference(expected.begin(), expected.end(), actual.begin(), actual.end(), std::back_inserter(difference));
+
+	return static_cast<uint>(difference.size());
+}
+
+//==============================================================================
+
+// number of coordinates where an instance of ClothBatch differs from stepping
+// the same constraints through Particle, DistanceConstraint and BendConstraint
+uint CompareBatch(const std::vector<ClothBatch::Parameters> &parameters, ThreadPool &pool) noexcept
+{
+	const Cloth cloth(8.0f, 8.0f, 1.0f, pool);
+
+	const auto vertices = cloth.GetVertices();
+	const auto &indices = cloth.GetIndices();
+	const auto count = static_cast<uint>(vertices.size() / 3);
+
+	constexpr uint frames = 30;
+	constexpr auto time_step = 1.0f / 60.0f;
+	const glm::vec3 gravity(0.0f, -9.8f, 0.0f);
+
+	ClothBatch batch(vertices, indices, parameters, pool);
+	batch.SetGravity(gravity);
+	batch.SetTimeStep(time_step);
+	batch.FixParticle(8);
+	batch.FixParticle(count - 1);
+	batch.Simulate(frames);
+
+	const auto &edges = batch.GetTopology().GetEdges();
+
+	uint mismatches = 0;
+	for (uint n = 0; n < parameters.size(); n++)
+	{
+		const auto &parameter = parameters[n];
+
+		std::vector<Particle> particles;
+		particles.reserve(count);
+		for (uint i = 0; i < count; i++)
+		{
+			particles.emplace_back(glm::vec3(vertices[3 * i + 0], vertices[3 * i + 1], vertices[3 * i + 2]));
+			particles.back().SetAcceleration(gravity);
+		}
+
+		particles[8].SetFixed(true);
+		particles[count - 1].SetFixed(true);
+
+		std::vector<DistanceConstraint> distance_constraints;
+		std::vector<BendConstraint> bend_constraints;
+
+		for (const auto &edge : edges)
+		{
+			distance_constraints.emplace_back(&particles[edge.ind1], &particles[edge.ind2], parameter.stiffness);
+		}
+
+		for (const auto &edge : edges)
+		{
+			if (!edge.boundary)
+			{
+				constexpr auto PI = 3.1415927f;
+				bend_constraints.emplace_back(&particles[edge.ind1], &particles[edge.ind2],
+				                              &particles[edge.ind3], &particles[edge.ind4], parameter.bend, PI);
+			}
+		}
+
+		const auto inv_mass = 1.0f / (parameter.mass / static_cast<float>(count));
+
+		const auto iterations = 5;
+		const auto dt = time_step / iterations;
+
+		for (uint frame = 0; frame < frames; frame++)
+		{
+			for (uint i = 0; i < iterations; i++)
+			{
+				for (auto &particle : particles)
+				{
+					particle.PredictPosition(dt);
+				}
+
+				for (const auto &constraint : distance_constraints)
+				{
+					constraint.Project(dt, inv_mass);
+				}
+
+				for (const auto &constraint : bend_constraints)
+				{
+					constraint.Project(dt, inv_mass);
+				}
+
+				for (auto &particle : particles)
+				{
+					particle.UpdateVelocity(dt, 0.999f);
+					particle.UpdatePosition();
+				}
+			}
+		}
+
+		const auto V = batch.GetVertices(n);
+		for (uint i = 0; i < count; i++)
+		{
+			const auto &P = particles[i].GetPosition();
+
+			mismatches += (V[3 * i + 0] != P.x) + (V[3 * i + 1] != P.y) + (V[3 * i + 2] != P.z);
+		}
+	}
+
+	return mismatches;
+}
+
+//==============================================================================
+
+// every kernel path compiled in against Ray::TriangleIntersection, on random
+// triangles and random rays, single rays and blocks, full and padded packets
+uint CompareRaycast(const std::vector<uint> &sizes, uint rays_size, uint &paths, ThreadPool &pool) noexcept
+{
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+
+	const auto point = [&]()
+	{
+		return glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+	};
+
+	const TriangleBatch::Path all[] = { TriangleBatch::Path::SCALAR, TriangleBatch::Path::SSE2, TriangleBatch::Path::AVX };
+
+	paths = 0;
+	for (const auto path : all)
+	{
+		paths += TriangleBatch::IsAvailable(path) ? 1 : 0;
+	}
+
+	uint mismatches = 0;
+	for (const auto size : sizes)
+	{
+		std::vector<glm::vec3> corners(3 * size);
+		for (auto &corner : corners)
+		{
+			corner = 0.5f * point();
+		}
+
+		TriangleBatch batch;
+		batch.Resize(size);
+		for (uint i = 0; i < size; i++)
+		{
+			batch.Set(i, corners[3 * i + 0], corners[3 * i + 1], corners[3 * i + 2]);
+		}
+
+		std::vector<Ray> rays;
+		std::vector<RayHit> expected(rays_size);
+		for (uint r = 0; r < rays_size; r++)
+		{
+			rays.emplace_back(2.0f * point(), 0.5f * point());
+
+			for (uint i = 0; i < size; i++)
+			{
+				float u, v, t;
+				if (rays[r].TriangleIntersection(corners[3 * i + 0], corners[3 * i + 1], corners[3 * i + 2], u, v, t) &&
+				    (t > 0.0f) && (t < expected[r].t || !expected[r].IsHit()))
+				{
+					expected[r].triangle = i;
+					expected[r].t = t;
+					expected[r].u = u;
+					expected[r].v = v;
+				}
+			}
+		}
+
+		const auto differs = [](const RayHit &hit, const RayHit &reference)
+		{
+			if (hit.IsHit() != reference.IsHit())
+			{
+				return true;
+			}
+
+			// another triangle only at the same distance, where two of them cross
+			const auto tolerance = 1e-4f * std::max(reference.t, 1.0f);
+			return reference.IsHit() && ((std::fabs(hit.t - reference.t) > tolerance) ||
+			       ((hit.triangle == reference.triangle) &&
+			        ((std::fabs(hit.u - reference.u) > 1e-4f) || (std::fabs(hit.v - reference.v) > 1e-4f))));
+		};
+
+		for (const auto path : all)
+		{
+			if (!TriangleBatch::IsAvailable(path))
+			{
+				continue;
+			}
+
+			std::vector<RayHit> hits;
+			batch.Intersect(rays, hits, pool, path);
+
+			for (uint r = 0; r < rays_size; r++)
+			{
+				RayHit hit;
+				batch.Intersect(rays[r], hit, path);
+
+				mismatches += differs(hit, expected[r]) + differs(hits[r], expected[r]);
+			}
+		}
+	}
+
+	return mismatches;
+}
+
+//==============================================================================
+
+// Fan of triangles around hub vertex 0, listed from the last rim edge back to
+// the first so the hub's half-edges arrive in descending order.
+std::vector<uint> GetFan(uint triangles) noexcept
+{
+	std::vector<uint> indices;
+	indices.reserve(3 * triangles);
+
+	for (auto t = triangles; t > 0; t--)
+	{
+		indices.push_back(0);
+		indices.push_back(t);
+		indices.push_back(t + 1);
+	}
+
+	return indices;
+}
+
+//==============================================================================
+
+// share of the constraints a TiledSolver keeps interior to its tiles on the noisy sheet of Cloth
+float GetInteriorRatio(uint size, ThreadPool &pool) noexcept
+{
+	const auto side = std::max(static_cast<uint>(std::lround(std::sqrt(static_cast<double>(size)))), 2u);
+	const Cloth cloth(1.0f, 1.0f, 1.0f / static_cast<float>(side - 1), pool);
+
+	const auto vertices = cloth.GetVertices();
+	const auto count = static_cast<uint>(vertices.size() / 3);
+
+	std::vector<Particle> particles;
+	particles.reserve(count);
+	for (uint i = 0; i < count; i++)
+	{
+		particles.emplace_back(glm::vec3(vertices[3 * i + 0], vertices[3 * i + 1], vertices[3 * i + 2]));
+	}
+
+	const Topology topology(count, cloth.GetIndices(), pool);
+
+	std::vector<Particle*> pointers;
+	std::vector<DistanceConstraint> distance_constraints;
+	std::vector<BendConstraint> bend_constraints;
+
+	for (auto &particle : particles)
+	{
+		pointers.push_back(&particle);
+	}
+
+	for (const auto &edge : topology.GetEdges())
+	{
+		distance_constraints.emplace_back(pointers[edge.ind1], pointers[edge.ind2], 1.0e3f);
+
+		if (!edge.boundary)
+		{
+			constexpr auto PI = 3.1415927f;
+			bend_constraints.emplace_back(pointers[edge.ind1], pointers[edge.ind2],
+			                              pointers[edge.ind3], pointers[edge.ind4], 0.0005f, PI);
+		}
+	}
+
+	const TiledSolver solver(pointers, distance_constraints, bend_constraints, pool);
+	return solver.GetInteriorRatio();
+}
+
+//==============================================================================
+
+// Checks the sorted Topology against the reference on random non-manifold meshes,
+// on reversed fans around a high-valence hub, the grid constructor against both on every grid up to 9 * 9, the StencilSolver
+// offset tables against the grid, ClothBatch against the scalar constraints and
+// that TiledSolver keeps most constraints of a sheet inside its tiles.
+// Returns false on any mismatch.
+bool Validate() noexcept
+{
+	ThreadPool pool;
+	std::mt19937 random(1);
+
+	constexpr uint meshes = 200;
+
+	uint random_mismatches = 0;
+	for (uint m = 0; m < meshes; m++)
+	{
+		// few vertices for many triangles: edges shared by three or more
+		// triangles, repeated corners and a few unused vertices
+		const auto used = 3 + static_cast<uint>(random() % 30);
+		const auto vertices_size = used + static_cast<uint>(random() % 4);
+
+		std::vector<uint> indices(3 * (1 + random() % 120));
+		for (auto &index : indices)
+		{
+			index = static_cast<uint>(random() % used);
+		}
+
+		const ReferenceTopology reference(vertices_size, indices);
+		const Topology topology(vertices_size, indices, pool);
+
+		random_mismatches += Compare(topology, reference, vertices_size);
+	}
+
+	const std::vector<uint> fans = { 1, 2, 33, 1000, 20000 };
+
+	uint fan_mismatches = 0;
+	for (const auto triangles : fans)
+	{
+		const auto indices = GetFan(triangles);
+
+		const ReferenceTopology reference(triangles + 2, indices);
+		const Topology topology(triangles + 2, indices, pool);
+
+		fan_mismatches += Compare(topology, reference, triangles + 2);
+	}
+
+	constexpr uint max_size = 9;
+
+	uint grid_mismatches = 0;
+	uint stencil_mismatches = 0;
+	for (uint nx = 1; nx <= max_size; nx++)
+	{
+		for (uint ny = 1; ny <= max_size; ny++)
+		{
+			const Cloth cloth(static_cast<float>(nx), static_cast<float>(ny), 1.0f, pool);
+
+			const auto &indices = cloth.GetIndices();
+			const auto vertices_size = (nx + 1) * (ny + 1);
+
+			const ReferenceTopology reference(vertices_size, indices);
+			const Topology general(vertices_size, indices, pool);
+			const Topology grid(nx, ny, indices, pool);
+
+			grid_mismatches += Compare(general, reference, vertices_size) + Compare(grid, reference, vertices_size);
+
+			const StencilSolver solver(nx, ny, pool);
+			stencil_mismatches += CompareStencils(grid, solver);
+		}
+	}
+
+	// eleven instances: a full block of eight lanes and a padded one
+	std::vector<ClothBatch::Parameters> parameters;
+	for (uint n = 0; n < 11; n++)
+	{
+		parameters.emplace_back(0.5f + 0.25f * n, 2.0e2f * (n + 1), 0.0002f * (n + 1));
+	}
+
+	const auto batch_mismatches = CompareBatch(parameters, pool);
+
+	const std::vector<uint> triangle_sizes = { 1, 7, 8, 9, 100, 1003 };
+	constexpr uint rays_size = 500;
+
+	uint paths;
+	const auto raycast_mismatches = CompareRaycast(triangle_sizes, rays_size, paths, pool);
+
+	// a tile of 1024 particles on a sheet is a patch of about 32 * 32, so only
+	// its rim, under a tenth of its constraints, should straddle tiles
+	constexpr auto min_interior_ratio = 0.85f;
+	const std::vector<uint> sheets = { 4000, 16000, 64000 };
+
+	auto interior_ratio = 1.0f;
+	uint tiled_mismatches = 0;
+	for (const auto size : sheets)
+	{
+		const auto ratio = GetInteriorRatio(size, pool);
+
+		interior_ratio = std::min(interior_ratio, ratio);
+		tiled_mismatches += (ratio < min_interior_ratio) ? 1 : 0;
+	}
+
+	printf("{\n  \"validation\": [\n");
+	printf("    {\"check\": \"topology_random\", \"cases\": %u, \"mismatches\": %u},\n", meshes, random_mismatches);
+	printf("    {\"check\": \"topology_fan\", \"cases\": %u, \"mismatches\": %u},\n", static_cast<uint>(fans.size()), fan_mismatches);
+	printf("    {\"check\": \"topology_grid\", \"cases\": %u, \"mismatches\": %u},\n", max_size * max_size, grid_mismatches);
+	printf("    {\"check\": \"stencil_offsets\", \"cases\": %u, \"mismatches\": %u},\n", max_size * max_size, stencil_mismatches);
+	printf("    {\"check\": \"cloth_batch\", \"cases\": %u, \"mismatches\": %u},\n", static_cast<uint>(parameters.size()), batch_mismatches);
+	printf("    {\"check\": \"triangle_batch\", \"cases\": %u, \"mismatches\": %u, \"paths\": %u},\n", static_cast<uint>(triangle_sizes.size()) * rays_size, raycast_mismatches, paths);
+	printf("    {\"check\": \"tiled_interior\", \"cases\": %u, \"mismatches\": %u, \"min_ratio\": %.3f}\n", static_cast<uint>(sheets.size()), tiled_mismatches, interior_ratio);
+	printf("  ]\n}\n");
+
+	return (random_mismatches == 0) && (fan_mismatches == 0) && (grid_mismatches == 0) && (stencil_mismatches == 0) &&
+	       (batch_mismatches == 0) && (raycast_mismatches == 0) && (tiled_mismatches == 0);
+}
+
+//==============================================================================
+
+void Run(const Options &options, uint size) noexcept
+{
+	const auto side = std::max(static_cast<uint>(std::lround(std::sqrt(static_cast<double>(size)))), 2u);
+	const auto step = 1.0f / static_cast<float>(side - 1);
+
+	ThreadPool pool;
+	Cloth cloth(1.0f, 1.0f, step, pool);
+
+	const auto vertices = cloth.GetVertices();
+	const auto &indices = cloth.GetIndices();
+	const auto count = static_cast<uint>(vertices.size() / 3);
+	const auto triangles = static_cast<uint>(indices.size() / 3);
+
+	Report(options, "cloth_construction", count, count, [&]()
+	{
+		Cloth cloth(1.0f, 1.0f, step, pool);
+		sink = sink + cloth.GetIndices().size();
+	});
+
+	Report(options, "topology_construction", count, triangles, [&]()
+	{
+		Topology topology(count, indices, pool);
+		sink = sink + topology.GetEdges().size();
+	});
+
+	// the cloth is square, (cells + 1)^2 vertices
+	const auto cells = static_cast<uint>(std::lround(std::sqrt(static_cast<double>(count)))) - 1;
+
+	Report(options, "topology_construction_grid", count, triangles, [&]()
+	{
+		Topology topology(cells, cells, indices, pool);
+		sink = sink + topology.GetEdges().size();
+	});
+
+	Report(options, "topology_construction_reference", count, triangles, [&]()
+	{
+		ReferenceTopology topology(count, indices);
+		sink = sink + topology.edges.size();
+	});
+
+	// as many triangles as the sheet, all around one hub
+	const auto fan = GetFan(triangles);
+
+	Report(options, "topology_construction_fan", triangles + 2, triangles, [&]()
+	{
+		Topology topology(triangles + 2, fan, pool);
+		sink = sink + topology.GetEdges().size();
+	});
+
+	Report(options, "topology_construction_fan_reference", triangles + 2, triangles, [&]()
+	{
+		ReferenceTopology topology(triangles + 2, fan);
+		sink = sink + topology.edges.size();
+	});
+
+	std::vector<Particle*> particles;
+	particles.reserve(count);
+	for (uint i = 0; i < count; i++)
+	{
+		particles.push_back(new Particle(glm::vec3(vertices[3 * i + 0], vertices[3 * i + 1], vertices[3 * i + 2])));
+	}
+
+	Topology topology(count, indices, pool);
+
+	std::vector<DistanceConstraint> distance_constraints;
+	std::vector<BendConstraint> bend_constraints;
+
+	for (const auto &edge : topology.GetEdges())
+	{
+		distance_constraints.emplace_back(particles[edge.ind1], particles[edge.ind2], 1.0e3f);
+
+		if (!edge.boundary)
+		{
+			constexpr auto PI = 3.1415927f;
+			bend_constraints.emplace_back(particles[edge.ind1], particles[edge.ind2],
+			                              particles[edge.ind3], particles[edge.ind4], 0.0005f, PI);
+		}
+	}
+
+	const auto inv_mass = static_cast<float>(count);
+	const auto dt = 0.001f / 5.0f;
+
+	Report(options, "distance_project", count, static_cast<uint>(distance_constraints.size()), [&]()
+	{
+		for (const auto &constraint : distance_constraints)
+		{
+			constraint.Project(dt, inv_mass);
+		}
+	});
+
+	Report(options, "bend_project", count, static_cast<uint>(bend_constraints.size()), [&]()
+	{
+		for (const auto &constraint : bend_constraints)
+		{
+			constraint.Project(dt, inv_mass);
+		}
+	});
+
+	for (const auto particle : particles)
+	{
+		delete particle;
+	}
+
+	Report(options, "calculate_normals", count, triangles, [&]()
+	{
+		cloth.CalculateNormals();
+	});
+
+	Report(options, "get_vertices", count, count, [&]()
+	{
+		sink = sink + cloth.GetVertices().size();
+	});
+
+	Report(options, "get_normals", count, count, [&]()
+	{
+		sink = sink + cloth.GetNormals().size();
+	});
+
+	constexpr uint ray_count = 256;
+
+	std::vector<Ray> rays;
+	rays.reserve(ray_count);
+	for (uint i = 0; i < ray_count; i++)
+	{
+		const auto x = (i % 16) / 16.0f - 0.47f;
+		const auto y = (i / 16) / 16.0f + 0.03f;
+		rays.emplace_back(glm::vec3(x, y, 1.5f), glm::vec3(0.9f * x, y, -10.0f));
+	}
+
+	Report(options, "cloth_raycast", count, ray_count, [&]()
+	{
+		for (const auto &ray : rays)
+		{
+			uint point;
+			glm::vec3 P;
+			sink = sink + (cloth.Raycast(ray, point, P) ? point : 0);
+		}
+	});
+
+	std::vector<glm::vec3> positions(count);
+	for (uint i = 0; i < count; i++)
+	{
+		positions[i] = glm::vec3(vertices[3 * i + 0], vertices[3 * i + 1], vertices[3 * i + 2]);
+	}
+
+	Report(options, "triangle_intersection", count, triangles, [&]()
+	{
+		const auto &ray = rays[ray_count / 2];
+
+		uint hits = 0;
+		for (uint i = 0; i < triangles; i++)
+		{
+			float u, v, t;
+			hits += ray.TriangleIntersection(positions[indices[3 * i + 0]],
+			                                 positions[indices[3 * i + 1]],
+			                                 positions[indices[3 * i + 2]], u, v, t);
+		}
+
+		sink = sink + hits;
+	});
+
+	// a folded sheet, so that the particles spread over several layers of cells;
+	// no two particles are closer than the thickness, the pass only gathers
+	Cloth folded(1.0f, 1.0f, step, pool);
+	for (const auto particle : folded.GetParticles())
+	{
+		const auto &P = particle->GetPosition();
+		particle->SetPosition(glm::vec3(P.x, P.y, 0.1f * std::sin(25.0f * P.x)));
+	}
+
+	Report(options, "self_collision", count, count, [&]()
+	{
+		folded.ProjectSelfCollision();
+	});
+}
+
+//==============================================================================
+
+std::vector<uint> ParseList(const char *text) noexcept
+{
+	std::vector<uint> values;
+
+	while (*text)
+	{
+		char *end;
+		const auto value = strtoul(text, &end, 10);
+		if (end == text)
+		{
+			break;
+		}
+
+		values.push_back(static_cast<uint>(value));
+		text = (*end == ',') ? end + 1 : end;
+	}
+
+	return values;
+}
+
+//==============================================================================
+
+void PrintUsage() noexcept
+{
+	printf("usage: cloth_microbenchmark [--sizes=N[,N...]] [--warmup=N] [--repetitions=N] [--filter=kernel] [--validate]\n");
+}
+
+//==============================================================================
+
+int main(int argc, char **argv)
+{
+	Options options;
+	options.sizes = { 1000, 4000, 16000, 64000, 256000 };
+	options.warmup = 3;
+	options.repetitions = 20;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const auto arg = argv[i];
+
+		if (strncmp(arg, "--sizes=", 8) == 0)
+		{
+			options.sizes = ParseList(arg + 8);
+		}
+		else
+		if (strncmp(arg, "--warmup=", 9) == 0)
+		{
+			options.warmup = static_cast<uint>(strtoul(arg + 9, nullptr, 10));
+		}
+		else
+		if (strncmp(arg, "--repetitions=", 14) == 0)
+		{
+			options.repetitions = static_cast<uint>(strtoul(arg + 14, nullptr, 10));
+		}
+		else
+		if (strncmp(arg, "--filter=", 9) == 0)
+		{
+			options.filter = arg + 9;
+		}
+		else
+		if (strcmp(arg, "--validate") == 0)
+		{
+			return Validate() ? 0 : 1;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (options.sizes.empty() || (options.repetitions == 0))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	printf("{\n  \"warmup\": %u,\n  \"repetitions\": %u,\n  \"results\": [\n", options.warmup, options.repetitions);
+
+	for (const auto size : options.sizes)
+	{
+		Run(options, size);
+	}
+
+	printf("\n  ]\n}\n");
+
+	return 0;
+}
+
+//==============================================================================
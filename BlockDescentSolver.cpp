@@ -0,0 +1,309 @@
+
+#include "BlockDescentSolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+#include "Constraint.h"
+#include "MemoryReport.h"
+#include "Particle.h"
+#include "ThreadPool.h"
+#include "Topology.h"
+
+//==============================================================================
+
+BlockDescentSolver::BlockDescentSolver(const Topology &topology, uint particles_size, ThreadPool &pool) noexcept :
+	pool(&pool),
+	iterations(default_iterations),
+	started(false)
+{
+	// bend constraints follow the interior edges in order, see Cloth::GenerateBendConstraints
+
+	const auto &topology_edges = topology.GetEdges();
+
+	bend_offsets.assign(particles_size + 1, 0);
+
+	for (const auto &edge : topology_edges)
+	{
+		if (!edge.boundary)
+		{
+			for (const auto ind : { edge.ind1, edge.ind2, edge.ind3, edge.ind4 })
+			{
+				bends.push_back(ind);
+				bend_offsets[ind + 1]++;
+			}
+		}
+	}
+
+	for (uint i = 0; i < particles_size; i++)
+	{
+		bend_offsets[i + 1] += bend_offsets[i];
+	}
+
+	bend_roles.resize(bends.size());
+
+	auto next = bend_offsets;
+	for (uint k = 0; k < static_cast<uint>(bends.size()); k++)
+	{
+		bend_roles[next[bends[k]]++] = k;
+	}
+
+	// greedy coloring, particles sharing a distance or bend constraint get different colors
+
+	const uint none = ~0u;
+
+	std::vector<uint> colors(particles_size, none);
+	std::vector<uint> marks;
+	std::vector<uint> counts;
+
+	const auto Mark = [&](uint neighbour, uint particle)
+	{
+		const auto color = colors[neighbour];
+		if (color != none)
+		{
+			marks[color] = particle;
+		}
+	};
+
+	for (uint i = 0; i < particles_size; i++)
+	{
+		for (const auto e : topology.GetVertexEdges(i))
+		{
+			Mark(topology_edges[e].ind1, i);
+			Mark(topology_edges[e].ind2, i);
+		}
+
+		for (auto k = bend_offsets[i]; k < bend_offsets[i + 1]; k++)
+		{
+			const auto bend = bend_roles[k] / 4;
+			for (uint role = 0; role < 4; role++)
+			{
+				Mark(bends[4 * bend + role], i);
+			}
+		}
+
+		uint color = 0;
+		while ((color < marks.size()) && (marks[color] == i))
+		{
+			color++;
+		}
+
+		if (color == marks.size())
+		{
+			marks.push_back(none);
+			counts.push_back(0);
+		}
+
+		colors[i] = color;
+		counts[color]++;
+	}
+
+	color_offsets.assign(1, 0);
+	for (const auto count : counts)
+	{
+		color_offsets.push_back(color_offsets.back() + count);
+	}
+
+	color_particles.resize(particles_size);
+
+	next = color_offsets;
+	for (uint i = 0; i < particles_size; i++)
+	{
+		color_particles[next[colors[i]]++] = i;
+	}
+
+	positions.resize(particles_size);
+	inertia.resize(particles_size);
+	previous.resize(particles_size);
+	older.resize(particles_size);
+	velocities.resize(particles_size);
+}
+
+//==============================================================================
+
+uint BlockDescentSolver::GetIterations() const noexcept
+{
+	return iterations;
+}
+
+//==============================================================================
+
+void BlockDescentSolver::SetIterations(uint value) noexcept
+{
+	iterations = std::max(value, 1u);
+}
+
+//==============================================================================
+
+void BlockDescentSolver::Solve(uint particle, const std::vector<Particle*> &particles, const Topology &topology,
+                               const std::vector<DistanceConstraint> &distance_constraints,
+                               const std::vector<BendConstraint> &bend_constraints,
+                               float dt, float inv_mass) noexcept
+{
+	if (particles[particle]->IsFixed())
+	{
+		return;
+	}
+
+	const auto &x = positions[particle];
+
+	const auto inertia_stiffness = 1.0f / (inv_mass * dt * dt);
+
+	auto force = inertia_stiffness * (inertia[particle] - x);
+	auto hessian = glm::mat3(inertia_stiffness);
+
+	const auto &edges = topology.GetEdges();
+	for (const auto e : topology.GetVertexEdges(particle))
+	{
+		const auto &constraint = distance_constraints[e];
+		const auto stiffness = 1.0f / constraint.GetCompliance();
+
+		const auto other = (edges[e].ind1 == particle) ? edges[e].ind2 : edges[e].ind1;
+
+		const auto L = x - positions[other];
+		const auto length = std::sqrt(glm::dot(L, L));
+		if (length < 1e-12f)
+		{
+			continue;
+		}
+
+		const auto u = L / length;
+		const auto stretch = length - constraint.GetDistance();
+
+		// the transverse term is dropped under compression to keep the block positive definite
+		const auto uu = glm::outerProduct(u, u);
+		const auto transverse = std::max(stretch / length, 0.0f);
+
+		force -= stiffness * stretch * u;
+		hessian += stiffness * (uu + transverse * (glm::mat3(1.0f) - uu));
+	}
+
+	for (auto k = bend_offsets[particle]; k < bend_offsets[particle + 1]; k++)
+	{
+		const auto bend = bend_roles[k] / 4;
+		const auto role = bend_roles[k] % 4;
+
+		const auto &constraint = bend_constraints[bend];
+		const auto ind = &bends[4 * bend];
+
+		float value;
+		glm::vec3 gradient[4];
+
+		if (!BendConstraint::GetGradient(positions[ind[0]], positions[ind[1]], positions[ind[2]], positions[ind[3]],
+		                                 constraint.GetAngle(), value, gradient))
+		{
+			continue;
+		}
+
+		const auto stiffness = 1.0f / constraint.GetCompliance();
+		const auto &g = gradient[role];
+
+		force -= stiffness * value * g;
+		hessian += stiffness * glm::outerProduct(g, g);
+	}
+
+	if (std::fabs(glm::determinant(hessian)) > 1e-30f)
+	{
+		positions[particle] += glm::inverse(hessian) * force;
+	}
+}
+
+//==============================================================================
+
+void BlockDescentSolver::Project(const std::vector<Particle*> &particles, const Topology &topology,
+                                 const std::vector<DistanceConstraint> &distance_constraints,
+                                 const std::vector<BendConstraint> &bend_constraints,
+                                 float dt, float inv_mass) noexcept
+{
+	const auto size = static_cast<uint>(particles.size());
+
+	// The predicted y = x + dt v + dt^2 a keeps the full external acceleration a.
+	// The initial guess keeps only its share along a that the particle actually
+	// gained in the previous substep, clamped to [0, 1], so resting cloth does
+	// not start a gravity step below its support.
+	pool->ParallelFor(0, size, 4096, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto particle = particles[i];
+
+			inertia[i] = particle->GetPosition();
+			positions[i] = inertia[i];
+
+			const auto &a = particle->GetAcceleration();
+			const auto &v = particle->GetVelocity();
+			const auto a2 = glm::dot(a, a);
+
+			if (started && !particle->IsFixed() && (a2 > 0.0f))
+			{
+				const auto gained = glm::dot(v - velocities[i], a) / (dt * a2);
+				const auto share = std::min(std::max(gained, 0.0f), 1.0f);
+
+				positions[i] -= (1.0f - share) * dt * dt * a;
+			}
+
+			velocities[i] = v;
+			previous[i] = positions[i];
+			older[i] = positions[i];
+		}
+	});
+
+	started = true;
+
+	auto omega = 1.0f;
+	const auto rho2 = spectral_radius * spectral_radius;
+
+	for (uint iteration = 0; iteration < iterations; iteration++)
+	{
+		for (uint color = 0; color + 1 < static_cast<uint>(color_offsets.size()); color++)
+		{
+			pool->ParallelFor(color_offsets[color], color_offsets[color + 1], 1024, [&](uint first, uint last)
+			{
+				for (auto k = first; k < last; k++)
+				{
+					Solve(color_particles[k], particles, topology, distance_constraints, bend_constraints, dt, inv_mass);
+				}
+			});
+		}
+
+		// Chebyshev weights: 1, 2 / (2 - rho^2), then 4 / (4 - rho^2 omega)
+		omega = (iteration == 0) ? 1.0f : (iteration == 1) ? 2.0f / (2.0f - rho2) : 4.0f / (4.0f - rho2 * omega);
+
+		pool->ParallelFor(0, size, 4096, [&](uint first, uint last)
+		{
+			for (auto i = first; i < last; i++)
+			{
+				if (iteration > 0)
+				{
+					positions[i] = omega * (positions[i] - older[i]) + older[i];
+				}
+
+				older[i] = previous[i];
+				previous[i] = positions[i];
+			}
+		});
+	}
+
+	pool->ParallelFor(0, size, 4096, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			particles[i]->Move(positions[i] - inertia[i]);
+		}
+	});
+}
+
+//==============================================================================
+
+void BlockDescentSolver::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "bends", MemoryReport::GetBytes(bends) + MemoryReport::GetBytes(bend_offsets) +
+	                             MemoryReport::GetBytes(bend_roles));
+	report.Add(prefix + "colors", MemoryReport::GetBytes(color_offsets) + MemoryReport::GetBytes(color_particles));
+	report.Add(prefix + "positions", MemoryReport::GetBytes(positions) + MemoryReport::GetBytes(inertia) +
+	                                 MemoryReport::GetBytes(previous) + MemoryReport::GetBytes(older) +
+	                                 MemoryReport::GetBytes(velocities));
+}
+
+//==============================================================================
@@ -0,0 +1,80 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class BendConstraint;
+class DistanceConstraint;
+class MemoryReport;
+class Particle;
+class ThreadPool;
+class Topology;
+
+//==============================================================================
+
+// Vertex block descent on the substep energy
+//   G(x) = m / (2 dt^2) |x - y|^2 + sum |C(x)|^2 / (2 compliance)
+// where y are the predicted positions and C runs over the distance and bend
+// constraints. Each particle in turn takes a 3x3 Newton step on G with its
+// neighbours held fixed (Gauss-Newton for bending, stretch Hessians clamped
+// to stay positive definite). Particles are greedy colored so that no two of
+// a color share a constraint, and each color is updated in parallel.
+// The descent starts from the adaptive initial guess of the VBD paper (the
+// predicted positions with only as much of the external acceleration as the
+// particle showed in the previous substep) and its iterations are Chebyshev
+// accelerated.
+class BlockDescentSolver
+{
+public:
+	static constexpr uint default_iterations = 2;
+	static constexpr float spectral_radius = 0.5f; // rho of the Chebyshev weights
+
+private:
+	ThreadPool *pool;
+
+	uint iterations;
+	bool started; // velocities hold the previous substep
+
+	std::vector<uint> bends;        // 4 particles per bend constraint
+	std::vector<uint> bend_offsets; // per particle, into bend_roles
+	std::vector<uint> bend_roles;   // 4 * bend + corner
+
+	std::vector<uint> color_offsets;
+	std::vector<uint> color_particles;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> inertia;    // y, the positions the substep predicted
+	std::vector<glm::vec3> previous;   // x of the previous iteration
+	std::vector<glm::vec3> older;      // x of the iteration before it
+	std::vector<glm::vec3> velocities; // of the previous substep
+
+private:
+	void Solve(uint particle, const std::vector<Particle*> &particles, const Topology &topology,
+	           const std::vector<DistanceConstraint> &distance_constraints,
+	           const std::vector<BendConstraint> &bend_constraints,
+	           float dt, float inv_mass) noexcept;
+
+public:
+	BlockDescentSolver(const Topology &topology, uint particles_size, ThreadPool &pool) noexcept;
+
+	uint GetIterations() const noexcept;
+	void SetIterations(uint value) noexcept;
+
+	void Project(const std::vector<Particle*> &particles, const Topology &topology,
+	             const std::vector<DistanceConstraint> &distance_constraints,
+	             const std::vector<BendConstraint> &bend_constraints,
+	             float dt, float inv_mass) noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+};
+
+//==============================================================================
@@ -1,9 +1,23 @@
 
 #include "Cloth.h"
 
+#include "BVH.h"
+#include "Collider.h"
+#include "ContinuousCollision.h"
+#include "MemoryReport.h"
 #include "Particle.h"
+#include "SelfCollision.h"
+#include "BlockDescentSolver.h"
+#include "ImplicitEulerSolver.h"
+#include "ProjectiveDynamicsSolver.h"
+#include "StencilSolver.h"
+#include "TiledSolver.h"
+#include "ThreadPool.h"
 #include "Topology.h"
 
+#include <algorithm>
+#include <cmath>
+
 //==============================================================================
 
 void Cloth::AddNoise(float value) noexcept
@@ -68,54 +82,107 @@ void Cloth::GenerateBendConstraints() noexcept
 
 //==============================================================================
 
-Cloth::Cloth(float width, float height, float step) noexcept
+void Cloth::CalculateTriangleBoxes() noexcept
+{
+	triangle_boxes.resize(indices.size() / 3);
+
+	for (size_t i = 0; i < triangle_boxes.size(); i++)
+	{
+		const auto &p1 = particles[indices[3 * i + 0]]->GetPosition();
+		const auto &p2 = particles[indices[3 * i + 1]]->GetPosition();
+		const auto &p3 = particles[indices[3 * i + 2]]->GetPosition();
+
+		auto &box = triangle_boxes[i];
+		box.min = glm::min(glm::min(p1, p2), p3);
+		box.max = glm::max(glm::max(p1, p2), p3);
+	}
+}
+
+//==============================================================================
+
+float Cloth::GetAverageEdgeLength() const noexcept
+{
+	if (distance_constraints.empty())
+	{
+		return 0.0f;
+	}
+
+	auto sum = 0.0f;
+	for (const auto &constraint : distance_constraints)
+	{
+		sum += constraint.GetDistance();
+	}
+
+	return sum / static_cast<float>(distance_constraints.size());
+}
+
+//==============================================================================
+
+Cloth::Cloth(float width, float height, float step, ThreadPool &pool) noexcept :
+	pool(&pool),
+	solver(Solver::XPBD),
+	solver_fallback(false),
+	solver_iterations(0),
+	tiled_solver(nullptr),
+	block_descent_solver(nullptr),
+	block_descent_iterations(BlockDescentSolver::default_iterations),
+	projective_dynamics_solver(nullptr),
+	implicit_euler_solver(nullptr)
 {
 	const auto nx = static_cast<uint>(width  / step);
 	const auto ny = static_cast<uint>(height / step);
 
 	const auto size = (nx + 1) * (ny + 1);
-	particles.reserve(size);
+	particles.resize(size);
 
-	for (uint i = 0; i < nx + 1; i++)
+	pool.ParallelFor(0, size, 4096, [&](uint first, uint last)
 	{
-		for (uint j = 0; j < ny + 1; j++)
+		for (auto k = first; k < last; k++)
 		{
+			const auto i = k / (ny + 1);
+			const auto j = k % (ny + 1);
+
 			const auto x = i * step - width / 2.0f;
 			const auto y = j * step;
 
-			particles.push_back(new Particle(glm::vec3(x, y, 0.0f)));
+			particles[k] = new Particle(glm::vec3(x, y, 0.0f));
 		}
-	}
+	});
 
-	const auto triangles = 2 * (nx * ny);
-	indices.reserve(3 * triangles);
+	const auto cells = nx * ny;
+	indices.resize(6 * cells);
 
-	for (uint i = 0; i < nx; i++)
+	pool.ParallelFor(0, cells, 4096, [&](uint first, uint last)
 	{
-		for (uint j = 0; j < ny; j++)
+		for (auto c = first; c < last; c++)
 		{
+			const auto i = c / ny;
+			const auto j = c % ny;
+
+			auto index = &indices[6 * c];
+
 			if (i < nx / 2)
 			{
-				indices.push_back((i + 0) * (ny + 1) + (j + 0));
-				indices.push_back((i + 1) * (ny + 1) + (j + 0));
-				indices.push_back((i + 0) * (ny + 1) + (j + 1));
+				index[0] = (i + 0) * (ny + 1) + (j + 0);
+				index[1] = (i + 1) * (ny + 1) + (j + 0);
+				index[2] = (i + 0) * (ny + 1) + (j + 1);
 
-				indices.push_back((i + 1) * (ny + 1) + (j + 1));
-				indices.push_back((i + 0) * (ny + 1) + (j + 1));
-				indices.push_back((i + 1) * (ny + 1) + (j + 0));
+				index[3] = (i + 1) * (ny + 1) + (j + 1);
+				index[4] = (i + 0) * (ny + 1) + (j + 1);
+				index[5] = (i + 1) * (ny + 1) + (j + 0);
 			}
 			else
 			{
-				indices.push_back((i + 0) * (ny + 1) + (j + 0));
-				indices.push_back((i + 1) * (ny + 1) + (j + 0));
-				indices.push_back((i + 1) * (ny + 1) + (j + 1));
+				index[0] = (i + 0) * (ny + 1) + (j + 0);
+				index[1] = (i + 1) * (ny + 1) + (j + 0);
+				index[2] = (i + 1) * (ny + 1) + (j + 1);
 
-				indices.push_back((i + 0) * (ny + 1) + (j + 1));
-				indices.push_back((i + 0) * (ny + 1) + (j + 0));
-				indices.push_back((i + 1) * (ny + 1) + (j + 1));
+				index[3] = (i + 0) * (ny + 1) + (j + 1);
+				index[4] = (i + 0) * (ny + 1) + (j + 0);
+				index[5] = (i + 1) * (ny + 1) + (j + 1);
 			}
 		}
-	}
+	});
 
 	uvs.reserve(particles.size());
 	for (const auto particle : particles)
@@ -124,23 +191,39 @@ Cloth::Cloth(float width, float height, float step) noexcept
 		uvs.emplace_back(P.x, P.y);
 	}
 	
-	const auto vertices_size = static_cast<uint>(particles.size());
-	topology = new Topology(vertices_size, indices);
+	topology = new Topology(nx, ny, indices, pool);
+	bvh = new BVH;
+	self_collision = new SelfCollision(pool);
+	continuous_collision = new ContinuousCollision(pool);
+	stencil_solver = new StencilSolver(nx, ny, pool);
 
 	AddNoise(0.001f);
 
 	CalculateNormals();
 	GenerateConstraints();
+	stencil_solver->SetRestShape(particles);
+	UpdateBVH();
 
 	SetMass(1.0f);
 	SetStiffness(1.0e3f);
 	SetBend(0.0005f);
+	SetThickness(0.5f * GetAverageEdgeLength());
 }
 
 //==============================================================================
 
-Cloth::Cloth(const std::vector<float> &vertices, const std::vector<uint> &indices) noexcept :
-	indices(indices)
+Cloth::Cloth(const std::vector<float> &vertices, const std::vector<uint> &indices, ThreadPool &pool) noexcept :
+	pool(&pool),
+	indices(indices),
+	solver(Solver::XPBD),
+	solver_fallback(false),
+	solver_iterations(0),
+	stencil_solver(nullptr),
+	tiled_solver(nullptr),
+	block_descent_solver(nullptr),
+	block_descent_iterations(BlockDescentSolver::default_iterations),
+	projective_dynamics_solver(nullptr),
+	implicit_euler_solver(nullptr)
 {
 	particles.reserve(vertices.size() / 3);
 
@@ -161,16 +244,21 @@ Cloth::Cloth(const std::vector<float> &vertices, const std::vector<uint> &indice
 	}
 
 	const auto vertices_size = static_cast<uint>(particles.size());
-	topology = new Topology(vertices_size, indices);
+	topology = new Topology(vertices_size, indices, pool);
+	bvh = new BVH;
+	self_collision = new SelfCollision(pool);
+	continuous_collision = new ContinuousCollision(pool);
 
 	AddNoise(0.01f);
 
+	CalculateNormals();
+	GenerateConstraints();
+	UpdateBVH();
+
 	SetMass(1.0f);
 	SetStiffness(1.0e3f);
 	SetBend(0.0005f);
-
-	CalculateNormals();
-	GenerateConstraints();
+	SetThickness(0.5f * GetAverageEdgeLength());
 }
 
 //==============================================================================
@@ -183,6 +271,14 @@ Cloth::~Cloth() noexcept
 	}
 
 	delete topology;
+	delete bvh;
+	delete self_collision;
+	delete continuous_collision;
+	delete stencil_solver;
+	delete tiled_solver;
+	delete block_descent_solver;
+	delete projective_dynamics_solver;
+	delete implicit_euler_solver;
 }
 
 //==============================================================================
@@ -204,17 +300,7 @@ Particle *Cloth::GetParticle(const uint index) const
 std::vector<float> Cloth::GetVertices() const noexcept
 {
 	std::vector<float> V;
-	V.reserve(3 * particles.size());
-
-	for (const auto particle : particles)
-	{
-		const auto &p = particle->GetPosition();
-
-		V.push_back(p.x);
-		V.push_back(p.y);
-		V.push_back(p.z);
-	}
-
+	GetVertices(V);
 	return V;
 }
 
@@ -223,15 +309,7 @@ std::vector<float> Cloth::GetVertices() const noexcept
 std::vector<float> Cloth::GetNormals() const noexcept
 {
 	std::vector<float> N;
-	N.reserve(3 * normals.size());
-
-	for (const auto &n : normals)
-	{
-		N.push_back(n.x);
-		N.push_back(n.y);
-		N.push_back(n.z);
-	}
-
+	GetNormals(N);
 	return N;
 }
 
@@ -240,15 +318,51 @@ std::vector<float> Cloth::GetNormals() const noexcept
 std::vector<float> Cloth::GetUVs() const noexcept
 {
 	std::vector<float> UV;
-	UV.reserve(2 * uvs.size());
+	GetUVs(UV);
+	return UV;
+}
 
-	for (const auto &uv : uvs)
+//==============================================================================
+
+void Cloth::GetVertices(std::vector<float> &V) const noexcept
+{
+	V.resize(3 * particles.size());
+
+	for (size_t i = 0; i < particles.size(); i++)
 	{
-		UV.push_back(uv.x);
-		UV.push_back(uv.y);
+		const auto &p = particles[i]->GetPosition();
+
+		V[3 * i + 0] = p.x;
+		V[3 * i + 1] = p.y;
+		V[3 * i + 2] = p.z;
 	}
+}
 
-	return UV;
+//==============================================================================
+
+void Cloth::GetNormals(std::vector<float> &N) const noexcept
+{
+	N.resize(3 * normals.size());
+
+	for (size_t i = 0; i < normals.size(); i++)
+	{
+		N[3 * i + 0] = normals[i].x;
+		N[3 * i + 1] = normals[i].y;
+		N[3 * i + 2] = normals[i].z;
+	}
+}
+
+//==============================================================================
+
+void Cloth::GetUVs(std::vector<float> &UV) const noexcept
+{
+	UV.resize(2 * uvs.size());
+
+	for (size_t i = 0; i < uvs.size(); i++)
+	{
+		UV[2 * i + 0] = uvs[i].x;
+		UV[2 * i + 1] = uvs[i].y;
+	}
 }
 
 //==============================================================================
@@ -274,6 +388,21 @@ void Cloth::SetStiffness(float value) noexcept
 	{
 		constraint.SetStiffness(value);
 	}
+
+	if (stencil_solver)
+	{
+		stencil_solver->SetStiffness(value);
+	}
+
+	if (tiled_solver)
+	{
+		tiled_solver->SetStiffness(value);
+	}
+
+	if (projective_dynamics_solver)
+	{
+		projective_dynamics_solver->Invalidate();
+	}
 }
 
 //==============================================================================
@@ -284,6 +413,94 @@ void Cloth::SetBend(float value) noexcept
 	{
 		constraint.SetStiffness(value);
 	}
+
+	if (stencil_solver)
+	{
+		stencil_solver->SetBend(value);
+	}
+
+	if (tiled_solver)
+	{
+		tiled_solver->SetBend(value);
+	}
+
+	if (projective_dynamics_solver)
+	{
+		projective_dynamics_solver->Invalidate();
+	}
+}
+
+//==============================================================================
+
+void Cloth::SetThickness(float value) noexcept
+{
+	self_collision->SetThickness(value);
+	continuous_collision->SetThickness(value);
+}
+
+//==============================================================================
+
+void Cloth::SetSelfCollision(bool value) noexcept
+{
+	self_collision->SetEnabled(value);
+}
+
+//==============================================================================
+
+void Cloth::SetContinuousCollision(bool value) noexcept
+{
+	continuous_collision->SetEnabled(value);
+}
+
+//==============================================================================
+
+bool Cloth::SetSolver(Solver value) noexcept
+{
+	if ((value == Solver::STENCIL) && !stencil_solver)
+	{
+		solver = Solver::XPBD;
+		return false;
+	}
+
+	// tiles follow the particle layout at the time the mode is first chosen
+	if ((value == Solver::TILED) && !tiled_solver)
+	{
+		tiled_solver = new TiledSolver(particles, distance_constraints, bend_constraints, *pool);
+	}
+
+	if ((value == Solver::BLOCK_DESCENT) && !block_descent_solver)
+	{
+		block_descent_solver = new BlockDescentSolver(*topology, static_cast<uint>(particles.size()), *pool);
+		block_descent_solver->SetIterations(block_descent_iterations);
+	}
+
+	// the bending model and the ordering follow the shape at the time the mode is first chosen
+	if ((value == Solver::PROJECTIVE_DYNAMICS) && !projective_dynamics_solver)
+	{
+		projective_dynamics_solver = new ProjectiveDynamicsSolver(particles, *topology, *pool);
+	}
+
+	if ((value == Solver::IMPLICIT_EULER) && !implicit_euler_solver)
+	{
+		implicit_euler_solver = new ImplicitEulerSolver(*topology, static_cast<uint>(particles.size()), *pool);
+	}
+
+	solver = value;
+	solver_fallback = false;
+	solver_iterations = 0;
+	return true;
+}
+
+//==============================================================================
+
+void Cloth::SetBlockDescentIterations(uint value) noexcept
+{
+	block_descent_iterations = value;
+
+	if (block_descent_solver)
+	{
+		block_descent_solver->SetIterations(value);
+	}
 }
 
 //==============================================================================
@@ -375,10 +592,78 @@ void Cloth::UpdatePosition() noexcept
 
 void Cloth::ProjectConstraints(float dt) noexcept
 {
+	ProjectDistanceConstraints(dt);
+	ProjectBendConstraints(dt);
+	ProjectSelfCollision();
+}
+
+//==============================================================================
+
+void Cloth::ProjectDistanceConstraints(float dt) noexcept
+{
+	if (solver == Solver::STENCIL)
+	{
+		stencil_solver->ProjectDistanceConstraints(particles, dt, inv_mass);
+		return;
+	}
+
+	if (solver == Solver::TILED)
+	{
+		tiled_solver->ProjectDistanceConstraints(particles, dt, inv_mass);
+		return;
+	}
+
+	if (solver == Solver::BLOCK_DESCENT)
+	{
+		block_descent_solver->Project(particles, *topology, distance_constraints, bend_constraints, dt, inv_mass);
+		solver_iterations += block_descent_solver->GetIterations();
+		return;
+	}
+
+	if (solver == Solver::PROJECTIVE_DYNAMICS)
+	{
+		solver_fallback = !projective_dynamics_solver->Project(particles, *topology, distance_constraints, bend_constraints, dt, inv_mass);
+		if (!solver_fallback)
+		{
+			return;
+		}
+	}
+
+	if (solver == Solver::IMPLICIT_EULER)
+	{
+		implicit_euler_solver->Project(particles, *topology, distance_constraints, bend_constraints, dt, inv_mass);
+		solver_iterations += implicit_euler_solver->GetIterations();
+		return;
+	}
+
 	for (auto &constraint : distance_constraints)
 	{
 		constraint.Project(dt, inv_mass);
 	}
+}
+
+//==============================================================================
+
+void Cloth::ProjectBendConstraints(float dt) noexcept
+{
+	if (solver == Solver::STENCIL)
+	{
+		stencil_solver->ProjectBendConstraints(particles, dt, inv_mass);
+		return;
+	}
+
+	if (solver == Solver::TILED)
+	{
+		tiled_solver->ProjectBendConstraints(particles, dt, inv_mass);
+		return;
+	}
+
+	// bending is part of the energy these solvers minimise in the distance phase
+	if ((solver == Solver::BLOCK_DESCENT) || (solver == Solver::IMPLICIT_EULER) ||
+	    ((solver == Solver::PROJECTIVE_DYNAMICS) && !solver_fallback))
+	{
+		return;
+	}
 
 	for (auto &constraint : bend_constraints)
 	{
@@ -388,16 +673,303 @@ void Cloth::ProjectConstraints(float dt) noexcept
 
 //==============================================================================
 
+void Cloth::ProjectSelfCollision() noexcept
+{
+	self_collision->Project(particles, *topology);
+}
+
+//==============================================================================
+
+void Cloth::SolveCollisions(float dt) noexcept
+{
+	continuous_collision->Solve(particles, indices, *topology, dt, inv_mass);
+}
+
+//==============================================================================
+
+void Cloth::ProjectColliders(const std::vector<Collider*> &colliders) noexcept
+{
+	if (colliders.empty())
+	{
+		return;
+	}
+
+	// Particles are culled against each inflated collider box in blocks on the
+	// pool; each block compacts its contacts in place and projects them.
+	constexpr uint block = 4096;
+
+	const auto size = static_cast<uint>(particles.size());
+	const auto blocks = (size + block - 1) / block;
+	const auto thickness = self_collision->GetThickness();
+
+	collider_x.resize(size);
+	collider_y.resize(size);
+	collider_z.resize(size);
+	contact_x.resize(size);
+	contact_y.resize(size);
+	contact_z.resize(size);
+	contact_particles.resize(size);
+	collider_blocks.resize(blocks);
+	contact_counts.resize(blocks);
+
+	pool->ParallelFor(0, blocks, 1, [&](uint first, uint last)
+	{
+		for (auto b = first; b < last; b++)
+		{
+			AABB box;
+			for (auto i = b * block; i < std::min((b + 1) * block, size); i++)
+			{
+				const auto &P = particles[i]->GetPosition();
+
+				collider_x[i] = P.x;
+				collider_y[i] = P.y;
+				collider_z[i] = P.z;
+
+				box.Add(P);
+			}
+
+			box.Inflate(thickness);
+			collider_blocks[b] = box;
+		}
+	});
+
+	AABB bounds;
+	for (const auto &box : collider_blocks)
+	{
+		bounds.Add(box);
+	}
+
+	auto touched = false;
+	for (const auto collider : colliders)
+	{
+		if (!collider || !collider->GetBounds().Overlaps(bounds))
+		{
+			continue;
+		}
+
+		auto box = collider->GetBounds();
+		box.Inflate(thickness);
+
+		pool->ParallelFor(0, blocks, 1, [&](uint first, uint last)
+		{
+			for (auto b = first; b < last; b++)
+			{
+				contact_counts[b] = 0;
+				if (!collider->GetBounds().Overlaps(collider_blocks[b]))
+				{
+					continue;
+				}
+
+				const auto begin = b * block;
+
+				auto end = begin;
+				for (auto i = begin; i < std::min(begin + block, size); i++)
+				{
+					const glm::vec3 P(collider_x[i], collider_y[i], collider_z[i]);
+					if (box.Contains(P))
+					{
+						contact_x[end] = P.x;
+						contact_y[end] = P.y;
+						contact_z[end] = P.z;
+						contact_particles[end] = i;
+						end++;
+					}
+				}
+
+				if (end == begin)
+				{
+					continue;
+				}
+
+				collider->Project(&contact_x[begin], &contact_y[begin], &contact_z[begin], end - begin, thickness);
+
+				for (auto k = begin; k < end; k++)
+				{
+					const auto i = contact_particles[k];
+
+					collider_x[i] = contact_x[k];
+					collider_y[i] = contact_y[k];
+					collider_z[i] = contact_z[k];
+				}
+
+				contact_counts[b] = end - begin;
+			}
+		});
+
+		for (const auto count : contact_counts)
+		{
+			touched = touched || (count > 0);
+		}
+	}
+
+	if (!touched)
+	{
+		return;
+	}
+
+	pool->ParallelFor(0, size, 4096, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto particle = particles[i];
+			const auto translation = glm::vec3(collider_x[i], collider_y[i], collider_z[i]) - particle->GetPosition();
+
+			if (translation != glm::vec3(0.0f))
+			{
+				particle->Move(translation);
+			}
+		}
+	});
+}
+
+//==============================================================================
+
+void Cloth::CalculateStats(SolverStats &stats) noexcept
+{
+	constexpr uint block = 4096;
+
+	const auto distances = static_cast<uint>(distance_constraints.size());
+	const auto bends = static_cast<uint>(bend_constraints.size());
+	const auto size = static_cast<uint>(particles.size());
+
+	const auto blocks = (std::max(std::max(distances, bends), size) + block - 1) / block;
+
+	stats_partials.assign(blocks, { 0.0, 0.0, 0.0, 0.0f, 0.0f });
+
+	pool->ParallelFor(0, blocks, 1, [&](uint first, uint last)
+	{
+		for (auto b = first; b < last; b++)
+		{
+			auto &partial = stats_partials[b];
+
+			for (auto i = b * block; i < std::min((b + 1) * block, distances); i++)
+			{
+				const auto stretch = std::fabs(distance_constraints[i].GetStretch());
+
+				partial.stretch2 += stretch * stretch;
+				partial.max_stretch = std::max(partial.max_stretch, stretch);
+			}
+
+			for (auto i = b * block; i < std::min((b + 1) * block, bends); i++)
+			{
+				const auto error = bend_constraints[i].GetError();
+
+				partial.bend2 += error * error;
+				partial.max_bend = std::max(partial.max_bend, error);
+			}
+
+			for (auto i = b * block; i < std::min((b + 1) * block, size); i++)
+			{
+				if (!particles[i]->IsFixed())
+				{
+					const auto &v = particles[i]->GetVelocity();
+					partial.energy += glm::dot(v, v);
+				}
+			}
+		}
+	});
+
+	StatsPartial total = { 0.0, 0.0, 0.0, 0.0f, 0.0f };
+	for (const auto &partial : stats_partials)
+	{
+		total.stretch2 += partial.stretch2;
+		total.bend2 += partial.bend2;
+		total.energy += partial.energy;
+		total.max_stretch = std::max(total.max_stretch, partial.max_stretch);
+		total.max_bend = std::max(total.max_bend, partial.max_bend);
+	}
+
+	stats.max_stretch = total.max_stretch;
+	stats.rms_stretch = distances ? static_cast<float>(std::sqrt(total.stretch2 / distances)) : 0.0f;
+	stats.max_bend_error = total.max_bend;
+	stats.rms_bend_error = bends ? static_cast<float>(std::sqrt(total.bend2 / bends)) : 0.0f;
+	stats.kinetic_energy = static_cast<float>(0.5 * total.energy / inv_mass);
+	stats.fallback = solver_fallback;
+	stats.iterative = (solver == Solver::BLOCK_DESCENT) || (solver == Solver::IMPLICIT_EULER);
+	stats.iterations = solver_iterations;
+
+	solver_iterations = 0;
+}
+
+//==============================================================================
+
+void Cloth::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "particles", MemoryReport::GetBytes(particles) + particles.size() * sizeof(Particle));
+	report.Add(prefix + "indices", MemoryReport::GetBytes(indices));
+	report.Add(prefix + "normals", MemoryReport::GetBytes(normals));
+	report.Add(prefix + "uvs", MemoryReport::GetBytes(uvs));
+	report.Add(prefix + "distance_constraints", MemoryReport::GetBytes(distance_constraints));
+	report.Add(prefix + "bend_constraints", MemoryReport::GetBytes(bend_constraints));
+	report.Add(prefix + "triangle_boxes", MemoryReport::GetBytes(triangle_boxes));
+	report.Add(prefix + "stats_partials", MemoryReport::GetBytes(stats_partials));
+
+	const auto collider_bytes = MemoryReport::GetBytes(collider_x) + MemoryReport::GetBytes(collider_y) +
+	                            MemoryReport::GetBytes(collider_z) + MemoryReport::GetBytes(contact_x) +
+	                            MemoryReport::GetBytes(contact_y) + MemoryReport::GetBytes(contact_z) +
+	                            MemoryReport::GetBytes(contact_particles) + MemoryReport::GetBytes(collider_blocks) +
+	                            MemoryReport::GetBytes(contact_counts);
+
+	report.Add(prefix + "colliders", collider_bytes);
+
+	triangle_batch.GetMemoryUsage(report, prefix + "triangle_batch.");
+	topology->GetMemoryUsage(report, prefix + "topology.");
+	bvh->GetMemoryUsage(report, prefix + "bvh.");
+	self_collision->GetMemoryUsage(report, prefix + "self_collision.");
+	continuous_collision->GetMemoryUsage(report, prefix + "continuous_collision.");
+
+	if (stencil_solver)
+	{
+		stencil_solver->GetMemoryUsage(report, prefix + "stencil_solver.");
+	}
+
+	if (tiled_solver)
+	{
+		tiled_solver->GetMemoryUsage(report, prefix + "tiled_solver.");
+	}
+
+	if (block_descent_solver)
+	{
+		block_descent_solver->GetMemoryUsage(report, prefix + "block_descent_solver.");
+	}
+
+	if (projective_dynamics_solver)
+	{
+		projective_dynamics_solver->GetMemoryUsage(report, prefix + "projective_dynamics_solver.");
+	}
+
+	if (implicit_euler_solver)
+	{
+		implicit_euler_solver->GetMemoryUsage(report, prefix + "implicit_euler_solver.");
+	}
+}
+
+//==============================================================================
+
+const BVH &Cloth::GetBVH() const noexcept
+{
+	return *bvh;
+}
+
+//==============================================================================
+
+void Cloth::UpdateBVH() noexcept
+{
+	CalculateTriangleBoxes();
+	bvh->Update(triangle_boxes);
+}
+
+//==============================================================================
+
 bool Cloth::Raycast(const Ray &ray, uint &point, glm::vec3 &P) const noexcept
 {
 	auto find = false;
-	auto tmin = FLT_MAX;
 
-	for (uint i = 0; i < indices.size(); i += 3)
+	bvh->Raycast(ray, FLT_MAX, [&](uint triangle, float &tmin)
 	{
-		const auto ind1 = indices[i + 0];
-		const auto ind2 = indices[i + 1];
-		const auto ind3 = indices[i + 2];
+		const auto ind1 = indices[3 * triangle + 0];
+		const auto ind2 = indices[3 * triangle + 1];
+		const auto ind3 = indices[3 * triangle + 2];
 
 		const auto p1 = GetParticle(ind1);
 		const auto p2 = GetParticle(ind2);
@@ -432,13 +1004,35 @@ bool Cloth::Raycast(const Ray &ray, uint &point, glm::vec3 &P) const noexcept
 				P = w * A + u * B + v * C;
 			}
 		}
-	}
+	});
 
 	return find;
 }
 
 //==============================================================================
 
+void Cloth::Raycast(const std::vector<Ray> &rays, std::vector<RayHit> &hits) noexcept
+{
+	const auto triangles = static_cast<uint>(indices.size() / 3);
+	triangle_batch.Resize(triangles);
+
+	pool->ParallelFor(0, triangles, 4096, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto &A = particles[indices[3 * i + 0]]->GetPosition();
+			const auto &B = particles[indices[3 * i + 1]]->GetPosition();
+			const auto &C = particles[indices[3 * i + 2]]->GetPosition();
+
+			triangle_batch.Set(i, A, B, C);
+		}
+	});
+
+	triangle_batch.Intersect(rays, hits, *pool);
+}
+
+//==============================================================================
+
 void Cloth::FixParticle(uint index) noexcept
 {
 	if (index < particles.size())
@@ -3,18 +3,33 @@
 
 //==============================================================================
 
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
 
 #include "Constraint.h"
 #include "Ray.h"
+#include "Solver.h"
+#include "SolverStats.h"
+#include "TriangleBatch.h"
 
 //==============================================================================
 
 typedef unsigned int uint;
 
+class BVH;
+class Collider;
+class MemoryReport;
+class ContinuousCollision;
 class Particle;
+class SelfCollision;
+class BlockDescentSolver;
+class ImplicitEulerSolver;
+class ProjectiveDynamicsSolver;
+class StencilSolver;
+class ThreadPool;
+class TiledSolver;
 class Topology;
 
 //==============================================================================
@@ -22,17 +37,57 @@ class Topology;
 class Cloth
 {
 private:
+	struct StatsPartial
+	{
+		double stretch2;
+		double bend2;
+		double energy;
+		float max_stretch;
+		float max_bend;
+	};
+
+private:
+	ThreadPool *pool;
+
 	std::vector<Particle*> particles;
 	std::vector<uint> indices;
 	std::vector<glm::vec3> normals;
 	std::vector<glm::vec2> uvs;
 	float inv_mass;
 
+	Solver solver;
+	bool solver_fallback; // XPBD runs because the chosen solver failed
+	uint solver_iterations; // run by an iterative solver since the last CalculateStats
+	StencilSolver *stencil_solver; // grid cloths only
+	TiledSolver *tiled_solver;     // built on first use
+	BlockDescentSolver *block_descent_solver; // built on first use
+	uint block_descent_iterations;
+	ProjectiveDynamicsSolver *projective_dynamics_solver; // built on first use
+	ImplicitEulerSolver *implicit_euler_solver; // built on first use
+
 	Topology *topology;
+	BVH *bvh;
+	SelfCollision *self_collision;
+	ContinuousCollision *continuous_collision;
+
+	std::vector<AABB> triangle_boxes;
+	TriangleBatch triangle_batch;
+
+	std::vector<float> collider_x;
+	std::vector<float> collider_y;
+	std::vector<float> collider_z;
+	std::vector<float> contact_x;
+	std::vector<float> contact_y;
+	std::vector<float> contact_z;
+	std::vector<uint> contact_particles;
+	std::vector<AABB> collider_blocks; // bounds of each block of particles
+	std::vector<uint> contact_counts;  // contacts of each block, compacted at the start of the block
 
 	std::vector<DistanceConstraint> distance_constraints;
 	std::vector<BendConstraint> bend_constraints;
 
+	std::vector<StatsPartial> stats_partials;
+
 private:
 	void AddNoise(float value) noexcept;
 
@@ -40,9 +95,12 @@ private:
 	void GenerateDistanceConstraints() noexcept;
 	void GenerateBendConstraints()     noexcept;
 
+	void CalculateTriangleBoxes() noexcept;
+	float GetAverageEdgeLength() const noexcept;
+
 public:
-	Cloth(float width, float height, float step) noexcept;
-	Cloth(const std::vector<float> &vertices, const std::vector<uint> &indices) noexcept;
+	Cloth(float width, float height, float step, ThreadPool &pool) noexcept;
+	Cloth(const std::vector<float> &vertices, const std::vector<uint> &indices, ThreadPool &pool) noexcept;
 	~Cloth() noexcept;
 
 	std::vector<Particle*> &GetParticles();
@@ -51,11 +109,21 @@ public:
 	std::vector<float> GetVertices()      const noexcept;
 	std::vector<float> GetNormals()       const noexcept;
 	std::vector<float> GetUVs()           const noexcept;
+
+	void GetVertices (std::vector<float> &V)  const noexcept;
+	void GetNormals  (std::vector<float> &N)  const noexcept;
+	void GetUVs      (std::vector<float> &UV) const noexcept;
 	const std::vector<uint> &GetIndices() const noexcept;
 
 	void SetMass      (float value) noexcept;
 	void SetStiffness (float value) noexcept;
 	void SetBend      (float value) noexcept;
+	void SetThickness (float value) noexcept;
+
+	void SetSelfCollision(bool value) noexcept;
+	void SetContinuousCollision(bool value) noexcept;
+	bool SetSolver(Solver value) noexcept;
+	void SetBlockDescentIterations(uint value) noexcept;
 
 	void CalculateNormals()                 noexcept;
 	void ClearForces()                      noexcept;
@@ -66,8 +134,20 @@ public:
 	void UpdatePosition  ()                        noexcept;
 
 	void ProjectConstraints(float dt) noexcept;
+	void ProjectDistanceConstraints(float dt) noexcept;
+	void ProjectBendConstraints(float dt) noexcept;
+	void ProjectSelfCollision() noexcept;
+	void SolveCollisions(float dt) noexcept;
+	void ProjectColliders(const std::vector<Collider*> &colliders) noexcept;
+
+	void CalculateStats(SolverStats &stats) noexcept;
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+
+	const BVH &GetBVH() const noexcept;
+	void UpdateBVH() noexcept;
 
 	bool Raycast(const Ray &ray, uint &point, glm::vec3 &P) const noexcept;
+	void Raycast(const std::vector<Ray> &rays, std::vector<RayHit> &hits) noexcept;
 
 	void FixParticle       (uint index) noexcept;
 	void FreeParticle      (uint index) noexcept;
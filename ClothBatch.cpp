@@ -0,0 +1,360 @@
+
+#include "ClothBatch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Constraint.h"
+#include "ThreadPool.h"
+#include "Topology.h"
+
+//==============================================================================
+
+uint ClothBatch::GetIndex(uint instance, uint particle) const noexcept
+{
+	const auto block = instance / lanes;
+	const auto lane  = instance % lanes;
+
+	return (block * particles + particle) * lanes + lane;
+}
+
+//==============================================================================
+
+void ClothBatch::PredictPosition(uint block, float dt) noexcept
+{
+	const auto offset = block * particles * lanes;
+
+	for (uint i = 0; i < particles; i++)
+	{
+		if (movable[i] == 0.0f)
+		{
+			continue;
+		}
+
+		const auto base = offset + i * lanes;
+		for (uint l = base; l < base + lanes; l++)
+		{
+			x[l] = px[l] + (vx[l] + gravity.x * dt) * dt;
+			y[l] = py[l] + (vy[l] + gravity.y * dt) * dt;
+			z[l] = pz[l] + (vz[l] + gravity.z * dt) * dt;
+		}
+	}
+}
+
+//==============================================================================
+
+void ClothBatch::ProjectDistances(uint block, float dt) noexcept
+{
+	const auto offset = block * particles * lanes;
+	const auto inv_mass = &inv_masses[block * lanes];
+	const auto compliance = &distance_compliances[block * lanes];
+
+	const auto X = x.data() + offset;
+	const auto Y = y.data() + offset;
+	const auto Z = z.data() + offset;
+
+	for (const auto &distance : distances)
+	{
+		const auto i1 = distance.ind1 * lanes;
+		const auto i2 = distance.ind2 * lanes;
+		const auto m1 = movable[distance.ind1];
+		const auto m2 = movable[distance.ind2];
+
+		float dx[lanes], dy[lanes], dz[lanes];
+
+		for (uint l = 0; l < lanes; l++)
+		{
+			const auto dp = DistanceConstraint::GetCorrection(glm::vec3(X[i1 + l], Y[i1 + l], Z[i1 + l]),
+			                                                  glm::vec3(X[i2 + l], Y[i2 + l], Z[i2 + l]),
+			                                                  distance.length, compliance[l] / (dt * dt), inv_mass[l]);
+
+			dx[l] = dp.x;
+			dy[l] = dp.y;
+			dz[l] = dp.z;
+		}
+
+		for (uint l = 0; l < lanes; l++)
+		{
+			X[i1 + l] += m1 * dx[l];
+			Y[i1 + l] += m1 * dy[l];
+			Z[i1 + l] += m1 * dz[l];
+		}
+
+		for (uint l = 0; l < lanes; l++)
+		{
+			X[i2 + l] -= m2 * dx[l];
+			Y[i2 + l] -= m2 * dy[l];
+			Z[i2 + l] -= m2 * dz[l];
+		}
+	}
+}
+
+//==============================================================================
+
+void ClothBatch::ProjectBends(uint block, float dt) noexcept
+{
+	const auto offset = block * particles * lanes;
+
+	for (const auto &bend : bends)
+	{
+		const uint ind[4] = { bend.ind1, bend.ind2, bend.ind3, bend.ind4 };
+
+		for (uint l = 0; l < lanes; l++)
+		{
+			const auto inv_mass = inv_masses[block * lanes + l];
+			const auto compliance = bend_compliances[block * lanes + l];
+
+			glm::vec3 P[4];
+			for (uint k = 0; k < 4; k++)
+			{
+				const auto i = offset + ind[k] * lanes + l;
+				P[k] = glm::vec3(x[i], y[i], z[i]);
+			}
+
+			glm::vec3 dp[4];
+			if (!BendConstraint::GetCorrection(P[0], P[1], P[2], P[3], bend.angle, compliance / (dt * dt), inv_mass, dp))
+			{
+				continue;
+			}
+
+			for (uint k = 0; k < 4; k++)
+			{
+				if (movable[ind[k]] == 0.0f)
+				{
+					continue;
+				}
+
+				const auto i = offset + ind[k] * lanes + l;
+
+				x[i] += dp[k].x;
+				y[i] += dp[k].y;
+				z[i] += dp[k].z;
+			}
+		}
+	}
+}
+
+//==============================================================================
+
+void ClothBatch::UpdateVelocity(uint block, float dt, float damping) noexcept
+{
+	const auto first = block * particles * lanes;
+	const auto last  = first + particles * lanes;
+
+	for (auto i = first; i < last; i++)
+	{
+		vx[i] = damping * (x[i] - px[i]) / dt;
+		vy[i] = damping * (y[i] - py[i]) / dt;
+		vz[i] = damping * (z[i] - pz[i]) / dt;
+	}
+}
+
+//==============================================================================
+
+void ClothBatch::UpdatePosition(uint block) noexcept
+{
+	const auto first = block * particles * lanes;
+	const auto last  = first + particles * lanes;
+
+	std::copy(x.begin() + first, x.begin() + last, px.begin() + first);
+	std::copy(y.begin() + first, y.begin() + last, py.begin() + first);
+	std::copy(z.begin() + first, z.begin() + last, pz.begin() + first);
+}
+
+//==============================================================================
+
+ClothBatch::ClothBatch(const std::vector<float> &vertices,
+                       const std::vector<uint> &indices,
+                       const std::vector<Parameters> &parameters, ThreadPool &pool) noexcept :
+	pool(&pool),
+	time_step(0.001f),
+	gravity(0.0f, -9.8f, 0.0f),
+	indices(indices),
+	particles(static_cast<uint>(vertices.size() / 3)),
+	instances(static_cast<uint>(parameters.size())),
+	blocks((instances + lanes - 1) / lanes)
+{
+	topology = new Topology(particles, indices, pool);
+
+	const auto &edges = topology->GetEdges();
+	for (const auto &edge : edges)
+	{
+		const glm::vec3 A(vertices[3 * edge.ind1 + 0], vertices[3 * edge.ind1 + 1], vertices[3 * edge.ind1 + 2]);
+		const glm::vec3 B(vertices[3 * edge.ind2 + 0], vertices[3 * edge.ind2 + 1], vertices[3 * edge.ind2 + 2]);
+
+		const auto AB = B - A;
+		distances.push_back({ edge.ind1, edge.ind2, std::sqrt(glm::dot(AB, AB)) });
+	}
+
+	for (const auto &edge : edges)
+	{
+		if (!edge.boundary)
+		{
+			constexpr auto PI = 3.1415927f;
+			bends.push_back({ edge.ind1, edge.ind2, edge.ind3, edge.ind4, PI });
+		}
+	}
+
+	movable.assign(particles, 1.0f);
+
+	const auto size = blocks * particles * lanes;
+	x.resize(size);
+	y.resize(size);
+	z.resize(size);
+	vx.assign(size, 0.0f);
+	vy.assign(size, 0.0f);
+	vz.assign(size, 0.0f);
+
+	for (uint b = 0; b < blocks; b++)
+	{
+		for (uint i = 0; i < particles; i++)
+		{
+			const auto base = (b * particles + i) * lanes;
+			std::fill(x.begin() + base, x.begin() + base + lanes, vertices[3 * i + 0]);
+			std::fill(y.begin() + base, y.begin() + base + lanes, vertices[3 * i + 1]);
+			std::fill(z.begin() + base, z.begin() + base + lanes, vertices[3 * i + 2]);
+		}
+	}
+
+	px = x;
+	py = y;
+	pz = z;
+
+	inv_masses.resize(blocks * lanes);
+	distance_compliances.resize(blocks * lanes);
+	bend_compliances.resize(blocks * lanes);
+
+	for (uint i = 0; i < blocks * lanes; i++)
+	{
+		// padding lanes repeat the last instance so every lane stays finite
+		const auto &parameter = parameters[std::min(i, instances - 1)];
+
+		const auto mass = parameter.mass / static_cast<float>(particles);
+		inv_masses[i] = 1.0f / mass;
+		distance_compliances[i] = 1.0f / parameter.stiffness;
+		bend_compliances[i] = 1.0f / parameter.bend;
+	}
+}
+
+//==============================================================================
+
+ClothBatch::~ClothBatch() noexcept
+{
+	delete topology;
+}
+
+//==============================================================================
+
+uint ClothBatch::GetInstanceCount() const noexcept
+{
+	return instances;
+}
+
+//==============================================================================
+
+uint ClothBatch::GetParticleCount() const noexcept
+{
+	return particles;
+}
+
+//==============================================================================
+
+const Topology &ClothBatch::GetTopology() const noexcept
+{
+	return *topology;
+}
+
+//==============================================================================
+
+const std::vector<uint> &ClothBatch::GetIndices() const noexcept
+{
+	return indices;
+}
+
+//==============================================================================
+
+void ClothBatch::SetGravity(const glm::vec3 &value) noexcept
+{
+	gravity = value;
+}
+
+//==============================================================================
+
+void ClothBatch::SetTimeStep(float value) noexcept
+{
+	time_step = value;
+}
+
+//==============================================================================
+
+void ClothBatch::FixParticle(uint index) noexcept
+{
+	if (index < particles)
+	{
+		movable[index] = 0.0f;
+	}
+}
+
+//==============================================================================
+
+void ClothBatch::FreeParticle(uint index) noexcept
+{
+	if (index < particles)
+	{
+		movable[index] = 1.0f;
+	}
+}
+
+//==============================================================================
+
+void ClothBatch::Simulate(uint frames) noexcept
+{
+	const auto iterations = 5;
+	const auto dt = time_step / iterations;
+
+	pool->ParallelFor(0, blocks, 1, [&](uint first, uint last)
+	{
+		for (auto block = first; block < last; block++)
+		{
+			for (uint frame = 0; frame < frames; frame++)
+			{
+				for (uint i = 0; i < iterations; i++)
+				{
+					PredictPosition(block, dt);
+
+					ProjectDistances(block, dt);
+					ProjectBends(block, dt);
+
+					UpdateVelocity(block, dt, 0.999f);
+					UpdatePosition(block);
+				}
+			}
+		}
+	});
+}
+
+//==============================================================================
+
+std::vector<float> ClothBatch::GetVertices(uint instance) const noexcept
+{
+	std::vector<float> V;
+	if (instance >= instances)
+	{
+		return V;
+	}
+
+	V.reserve(3 * particles);
+
+	for (uint i = 0; i < particles; i++)
+	{
+		const auto index = GetIndex(instance, i);
+
+		V.push_back(x[index]);
+		V.push_back(y[index]);
+		V.push_back(z[index]);
+	}
+
+	return V;
+}
+
+//==============================================================================
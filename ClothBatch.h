@@ -0,0 +1,112 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class ThreadPool;
+class Topology;
+
+//==============================================================================
+
+class ClothBatch
+{
+public:
+	struct Parameters
+	{
+		float mass;
+		float stiffness;
+		float bend;
+
+		Parameters(float mass = 1.0f, float stiffness = 1.0e3f, float bend = 0.0005f) noexcept :
+			mass(mass),
+			stiffness(stiffness),
+			bend(bend)
+		{
+		}
+	};
+
+private:
+	struct Distance
+	{
+		uint ind1;
+		uint ind2;
+		float length;
+	};
+
+	struct Bend
+	{
+		uint ind1;
+		uint ind2;
+		uint ind3;
+		uint ind4;
+		float angle;
+	};
+
+	static constexpr uint lanes = 8;
+
+private:
+	ThreadPool *pool;
+
+	float time_step;
+	glm::vec3 gravity;
+
+	Topology *topology;
+	std::vector<uint> indices;
+	std::vector<Distance> distances;
+	std::vector<Bend> bends;
+	std::vector<float> movable;
+
+	uint particles;
+	uint instances;
+	uint blocks;
+
+	std::vector<float> inv_masses;
+	std::vector<float> distance_compliances;
+	std::vector<float> bend_compliances;
+
+	// instance state interleaved by lane: [(block * particles + particle) * lanes + lane]
+	std::vector<float> x, y, z;
+	std::vector<float> px, py, pz;
+	std::vector<float> vx, vy, vz;
+
+private:
+	uint GetIndex(uint instance, uint particle) const noexcept;
+
+	void PredictPosition    (uint block, float dt) noexcept;
+	void ProjectDistances   (uint block, float dt) noexcept;
+	void ProjectBends       (uint block, float dt) noexcept;
+	void UpdateVelocity     (uint block, float dt, float damping) noexcept;
+	void UpdatePosition     (uint block) noexcept;
+
+public:
+	ClothBatch(const std::vector<float> &vertices,
+	           const std::vector<uint> &indices,
+	           const std::vector<Parameters> &parameters, ThreadPool &pool) noexcept;
+	ClothBatch(const ClothBatch &) = delete;
+	~ClothBatch() noexcept;
+
+	uint GetInstanceCount() const noexcept;
+	uint GetParticleCount() const noexcept;
+	const Topology &GetTopology() const noexcept;
+	const std::vector<uint> &GetIndices() const noexcept;
+
+	void SetGravity(const glm::vec3 &value) noexcept;
+	void SetTimeStep(float value) noexcept;
+
+	void FixParticle  (uint index) noexcept;
+	void FreeParticle (uint index) noexcept;
+
+	void Simulate(uint frames) noexcept;
+
+	std::vector<float> GetVertices(uint instance) const noexcept;
+};
+
+//==============================================================================
@@ -0,0 +1,790 @@
+
+#include "Collider.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <unordered_map>
+
+#include "BVH.h"
+#include "MemoryReport.h"
+#include "ThreadPool.h"
+
+//==============================================================================
+
+namespace
+{
+	struct Frame
+	{
+		float r[3][3];
+		float t[3];
+		float q[3][3];
+		float s[3];
+
+		Frame(const glm::mat4 &transform, const glm::mat4 &inverse) noexcept
+		{
+			for (uint i = 0; i < 3; i++)
+			{
+				for (uint j = 0; j < 3; j++)
+				{
+					r[i][j] = transform[j][i];
+					q[i][j] = inverse[j][i];
+				}
+
+				t[i] = transform[3][i];
+				s[i] = inverse[3][i];
+			}
+		}
+	};
+
+	inline void ToLocal(const Frame &f, float x, float y, float z,
+	                    float &lx, float &ly, float &lz) noexcept
+	{
+		lx = f.q[0][0] * x + f.q[0][1] * y + f.q[0][2] * z + f.s[0];
+		ly = f.q[1][0] * x + f.q[1][1] * y + f.q[1][2] * z + f.s[1];
+		lz = f.q[2][0] * x + f.q[2][1] * y + f.q[2][2] * z + f.s[2];
+	}
+
+	inline void AddWorld(const Frame &f, float dx, float dy, float dz,
+	                     float &x, float &y, float &z) noexcept
+	{
+		x += f.r[0][0] * dx + f.r[0][1] * dy + f.r[0][2] * dz;
+		y += f.r[1][0] * dx + f.r[1][1] * dy + f.r[1][2] * dz;
+		z += f.r[2][0] * dx + f.r[2][1] * dy + f.r[2][2] * dz;
+	}
+
+	AABB TransformBox(const glm::mat4 &transform, const glm::vec3 &min, const glm::vec3 &max) noexcept
+	{
+		AABB box;
+
+		for (uint i = 0; i < 8; i++)
+		{
+			const glm::vec3 corner((i & 1) ? max.x : min.x,
+			                       (i & 2) ? max.y : min.y,
+			                       (i & 4) ? max.z : min.z);
+
+			box.Add(glm::vec3(transform * glm::vec4(corner, 1.0f)));
+		}
+
+		return box;
+	}
+
+	enum Feature : uint
+	{
+		VERTEX = 0, // + corner
+		EDGE   = 3, // + first corner
+		FACE   = 6
+	};
+
+	glm::vec3 GetClosestPoint(const glm::vec3 &P,
+	                          const glm::vec3 &A,
+	                          const glm::vec3 &B,
+	                          const glm::vec3 &C,
+	                          uint &feature) noexcept
+	{
+		const auto ab = B - A;
+		const auto ac = C - A;
+
+		const auto ap = P - A;
+		const auto d1 = glm::dot(ab, ap);
+		const auto d2 = glm::dot(ac, ap);
+		if ((d1 <= 0.0f) && (d2 <= 0.0f))
+		{
+			feature = VERTEX + 0;
+			return A;
+		}
+
+		const auto bp = P - B;
+		const auto d3 = glm::dot(ab, bp);
+		const auto d4 = glm::dot(ac, bp);
+		if ((d3 >= 0.0f) && (d4 <= d3))
+		{
+			feature = VERTEX + 1;
+			return B;
+		}
+
+		const auto vc = d1 * d4 - d3 * d2;
+		if ((vc <= 0.0f) && (d1 >= 0.0f) && (d3 <= 0.0f))
+		{
+			feature = EDGE + 0;
+			return A + (d1 / (d1 - d3)) * ab;
+		}
+
+		const auto cp = P - C;
+		const auto d5 = glm::dot(ab, cp);
+		const auto d6 = glm::dot(ac, cp);
+		if ((d6 >= 0.0f) && (d5 <= d6))
+		{
+			feature = VERTEX + 2;
+			return C;
+		}
+
+		const auto vb = d5 * d2 - d1 * d6;
+		if ((vb <= 0.0f) && (d2 >= 0.0f) && (d6 <= 0.0f))
+		{
+			feature = EDGE + 2;
+			return A + (d2 / (d2 - d6)) * ac;
+		}
+
+		const auto va = d3 * d6 - d5 * d4;
+		if ((va <= 0.0f) && ((d4 - d3) >= 0.0f) && ((d5 - d6) >= 0.0f))
+		{
+			feature = EDGE + 1;
+			return B + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (C - B);
+		}
+
+		feature = FACE;
+
+		const auto denom = 1.0f / (va + vb + vc);
+		return A + (vb * denom) * ab + (vc * denom) * ac;
+	}
+
+	unsigned long long GetEdgeKey(uint ind1, uint ind2) noexcept
+	{
+		const auto a = static_cast<unsigned long long>(std::min(ind1, ind2));
+		const auto b = static_cast<unsigned long long>(std::max(ind1, ind2));
+		return (a << 32) | b;
+	}
+
+	unsigned long long GetMeshHash(const std::vector<float> &vertices,
+	                               const std::vector<uint> &indices,
+	                               uint resolution) noexcept
+	{
+		auto hash = 14695981039346656037ull;
+
+		const auto add = [&hash](const void *data, size_t bytes)
+		{
+			const auto p = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < bytes; i++)
+			{
+				hash ^= p[i];
+				hash *= 1099511628211ull;
+			}
+		};
+
+		add(vertices.data(), vertices.size() * sizeof(float));
+		add(indices.data(), indices.size() * sizeof(uint));
+		add(&resolution, sizeof(resolution));
+
+		return hash;
+	}
+
+	constexpr uint sdf_magic = 0x31464453; // "SDF1"
+}
+
+//==============================================================================
+
+Collider::Collider() noexcept :
+	transform(1.0f),
+	inverse(1.0f)
+{
+}
+
+//==============================================================================
+
+Collider::~Collider() noexcept
+{
+}
+
+//==============================================================================
+
+const glm::mat4 &Collider::GetTransform() const noexcept
+{
+	return transform;
+}
+
+//==============================================================================
+
+const AABB &Collider::GetBounds() const noexcept
+{
+	return bounds;
+}
+
+//==============================================================================
+
+void Collider::SetTransform(const glm::mat4 &value) noexcept
+{
+	transform = value;
+	inverse = glm::inverse(value);
+	UpdateBounds();
+}
+
+//==============================================================================
+
+void Collider::GetMemoryUsage(MemoryReport &, const std::string &) const noexcept
+{
+}
+
+//==============================================================================
+
+SphereCollider::SphereCollider(float radius) noexcept :
+	radius(radius)
+{
+	UpdateBounds();
+}
+
+//==============================================================================
+
+void SphereCollider::UpdateBounds() noexcept
+{
+	bounds = TransformBox(transform, glm::vec3(-radius), glm::vec3(radius));
+}
+
+//==============================================================================
+
+void SphereCollider::Project(float *x, float *y, float *z, uint count, float thickness) const noexcept
+{
+	const Frame frame(transform, inverse);
+	const auto distance = radius + thickness;
+
+	for (uint i = 0; i < count; i++)
+	{
+		float lx, ly, lz;
+		ToLocal(frame, x[i], y[i], z[i], lx, ly, lz);
+
+		const auto length2 = lx * lx + ly * ly + lz * lz;
+		const auto inside = (length2 < distance * distance) && (length2 > 0.0f);
+		const auto scale = inside ? distance / std::sqrt(length2) - 1.0f : 0.0f;
+
+		AddWorld(frame, scale * lx, scale * ly, scale * lz, x[i], y[i], z[i]);
+	}
+}
+
+//==============================================================================
+
+CapsuleCollider::CapsuleCollider(float radius, float height) noexcept :
+	radius(radius),
+	half_height(0.5f * height)
+{
+	UpdateBounds();
+}
+
+//==============================================================================
+
+void CapsuleCollider::UpdateBounds() noexcept
+{
+	const glm::vec3 extent(radius, half_height + radius, radius);
+	bounds = TransformBox(transform, -extent, extent);
+}
+
+//==============================================================================
+
+void CapsuleCollider::Project(float *x, float *y, float *z, uint count, float thickness) const noexcept
+{
+	const Frame frame(transform, inverse);
+	const auto distance = radius + thickness;
+
+	for (uint i = 0; i < count; i++)
+	{
+		float lx, ly, lz;
+		ToLocal(frame, x[i], y[i], z[i], lx, ly, lz);
+
+		const auto dy = ly - std::min(std::max(ly, -half_height), half_height);
+
+		const auto length2 = lx * lx + dy * dy + lz * lz;
+		const auto inside = (length2 < distance * distance) && (length2 > 0.0f);
+		const auto scale = inside ? distance / std::sqrt(length2) - 1.0f : 0.0f;
+
+		AddWorld(frame, scale * lx, scale * dy, scale * lz, x[i], y[i], z[i]);
+	}
+}
+
+//==============================================================================
+
+BoxCollider::BoxCollider(const glm::vec3 &size) noexcept :
+	half_size(0.5f * size)
+{
+	UpdateBounds();
+}
+
+//==============================================================================
+
+void BoxCollider::UpdateBounds() noexcept
+{
+	bounds = TransformBox(transform, -half_size, half_size);
+}
+
+//==============================================================================
+
+void BoxCollider::Project(float *x, float *y, float *z, uint count, float thickness) const noexcept
+{
+	const Frame frame(transform, inverse);
+	const auto ex = half_size.x;
+	const auto ey = half_size.y;
+	const auto ez = half_size.z;
+
+	for (uint i = 0; i < count; i++)
+	{
+		float lx, ly, lz;
+		ToLocal(frame, x[i], y[i], z[i], lx, ly, lz);
+
+		const auto cx = std::min(std::max(lx, -ex), ex);
+		const auto cy = std::min(std::max(ly, -ey), ey);
+		const auto cz = std::min(std::max(lz, -ez), ez);
+
+		const auto ox = lx - cx;
+		const auto oy = ly - cy;
+		const auto oz = lz - cz;
+
+		const auto length2 = ox * ox + oy * oy + oz * oz;
+		const auto outside = (length2 < thickness * thickness) && (length2 > 0.0f);
+		const auto scale = outside ? thickness / std::sqrt(length2) - 1.0f : 0.0f;
+
+		auto dx = scale * ox;
+		auto dy = scale * oy;
+		auto dz = scale * oz;
+
+		const auto px = ex - std::abs(lx);
+		const auto py = ey - std::abs(ly);
+		const auto pz = ez - std::abs(lz);
+
+		const auto inside = (length2 == 0.0f);
+		const auto axis_x = inside && (px <= py) && (px <= pz);
+		const auto axis_y = inside && !axis_x && (py <= pz);
+		const auto axis_z = inside && !axis_x && !axis_y;
+
+		dx += axis_x ? std::copysign(ex + thickness, lx) - lx : 0.0f;
+		dy += axis_y ? std::copysign(ey + thickness, ly) - ly : 0.0f;
+		dz += axis_z ? std::copysign(ez + thickness, lz) - lz : 0.0f;
+
+		AddWorld(frame, dx, dy, dz, x[i], y[i], z[i]);
+	}
+}
+
+//==============================================================================
+
+PlaneCollider::PlaneCollider() noexcept
+{
+	UpdateBounds();
+}
+
+//==============================================================================
+
+void PlaneCollider::UpdateBounds() noexcept
+{
+	bounds.min = glm::vec3(-FLT_MAX);
+	bounds.max = glm::vec3( FLT_MAX);
+}
+
+//==============================================================================
+
+void PlaneCollider::Project(float *x, float *y, float *z, uint count, float thickness) const noexcept
+{
+	const Frame frame(transform, inverse);
+
+	for (uint i = 0; i < count; i++)
+	{
+		float lx, ly, lz;
+		ToLocal(frame, x[i], y[i], z[i], lx, ly, lz);
+
+		const auto dy = std::max(thickness - ly, 0.0f);
+
+		AddWorld(frame, 0.0f, dy, 0.0f, x[i], y[i], z[i]);
+	}
+}
+
+//==============================================================================
+
+MeshCollider::MeshCollider(const std::vector<float> &vertices,
+                           const std::vector<uint> &indices,
+                           ThreadPool &pool,
+                           uint resolution,
+                           const std::string &cache) noexcept :
+	origin(0.0f),
+	size(0),
+	cell(0.0f),
+	band(0.0f),
+	hash(GetMeshHash(vertices, indices, resolution))
+{
+	AABB box;
+	for (size_t i = 0; i + 2 < vertices.size(); i += 3)
+	{
+		box.Add(glm::vec3(vertices[i + 0], vertices[i + 1], vertices[i + 2]));
+	}
+
+	const auto extent = box.max - box.min;
+	const auto length = std::max(std::max(extent.x, extent.y), extent.z);
+	if (!(length > 0.0f) || (resolution == 0))
+	{
+		UpdateBounds();
+		return;
+	}
+
+	cell = length / static_cast<float>(resolution);
+	band = 4.0f * cell;
+
+	box.Inflate(band);
+	origin = box.min;
+	size = glm::uvec3(glm::ceil((box.max - box.min) / cell)) + glm::uvec3(1);
+
+	std::string path;
+	if (!cache.empty())
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.sdf", hash);
+		path = cache + "/" + name;
+	}
+
+	if (path.empty() || !Load(path))
+	{
+		Build(vertices, indices, pool);
+
+		if (!path.empty())
+		{
+			Save(path);
+		}
+	}
+
+	UpdateBounds();
+}
+
+//==============================================================================
+
+void MeshCollider::UpdateBounds() noexcept
+{
+	if (distances.empty())
+	{
+		bounds = AABB();
+		return;
+	}
+
+	const auto max = origin + cell * glm::vec3(size - glm::uvec3(1));
+	bounds = TransformBox(transform, origin, max);
+}
+
+//==============================================================================
+
+float MeshCollider::GetDistance(uint x, uint y, uint z) const noexcept
+{
+	return distances[(z * size.y + y) * size.x + x];
+}
+
+//==============================================================================
+
+void MeshCollider::Build(const std::vector<float> &vertices, const std::vector<uint> &indices, ThreadPool &pool) noexcept
+{
+	const auto triangles = static_cast<uint>(indices.size() / 3);
+
+	std::vector<glm::vec3> positions(vertices.size() / 3);
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		positions[i] = glm::vec3(vertices[3 * i + 0], vertices[3 * i + 1], vertices[3 * i + 2]);
+	}
+
+	std::vector<glm::vec3> face_normals(triangles);
+	std::vector<glm::vec3> edge_normals(3 * triangles);
+	std::vector<glm::vec3> vertex_normals(positions.size(), glm::vec3(0.0f));
+	std::vector<AABB> boxes(triangles);
+
+	std::unordered_map<unsigned long long, glm::vec3> edges;
+	edges.reserve(3 * triangles);
+
+	for (uint i = 0; i < triangles; i++)
+	{
+		const auto n = glm::cross(positions[indices[3 * i + 1]] - positions[indices[3 * i + 0]],
+		                          positions[indices[3 * i + 2]] - positions[indices[3 * i + 0]]);
+		const auto area = glm::length(n);
+		const auto normal = (area > 0.0f) ? n / area : glm::vec3(0.0f);
+
+		face_normals[i] = normal;
+
+		for (uint k = 0; k < 3; k++)
+		{
+			const auto ind1 = indices[3 * i + k];
+			const auto ind2 = indices[3 * i + (k + 1) % 3];
+			const auto ind3 = indices[3 * i + (k + 2) % 3];
+
+			const auto e1 = positions[ind2] - positions[ind1];
+			const auto e2 = positions[ind3] - positions[ind1];
+			const auto l1 = glm::length(e1);
+			const auto l2 = glm::length(e2);
+
+			if ((l1 > 0.0f) && (l2 > 0.0f))
+			{
+				const auto cosine = glm::clamp(glm::dot(e1, e2) / (l1 * l2), -1.0f, 1.0f);
+				vertex_normals[ind1] += std::acos(cosine) * normal;
+			}
+
+			edges[GetEdgeKey(ind1, ind2)] += normal;
+			boxes[i].Add(positions[ind1]);
+		}
+	}
+
+	for (uint i = 0; i < triangles; i++)
+	{
+		for (uint k = 0; k < 3; k++)
+		{
+			const auto ind1 = indices[3 * i + k];
+			const auto ind2 = indices[3 * i + (k + 1) % 3];
+
+			edge_normals[3 * i + k] = edges[GetEdgeKey(ind1, ind2)];
+		}
+	}
+
+	BVH tree;
+	tree.Build(boxes);
+
+	distances.assign(size.x * size.y * size.z, FLT_MAX);
+
+	pool.ParallelFor(0, size.y * size.z, 4, [&](uint first, uint last)
+	{
+		for (auto row = first; row < last; row++)
+		{
+			const auto y = row % size.y;
+			const auto z = row / size.y;
+
+			for (uint x = 0; x < size.x; x++)
+			{
+				const auto P = origin + cell * glm::vec3(x, y, z);
+				const AABB query(P - glm::vec3(band), P + glm::vec3(band));
+
+				auto distance2 = band * band;
+				auto sign = 0.0f;
+
+				tree.Query(query, [&](uint triangle)
+				{
+					const auto ind1 = indices[3 * triangle + 0];
+					const auto ind2 = indices[3 * triangle + 1];
+					const auto ind3 = indices[3 * triangle + 2];
+
+					uint feature;
+					const auto Q = GetClosestPoint(P, positions[ind1], positions[ind2], positions[ind3], feature);
+					const auto d = P - Q;
+					const auto length2 = glm::dot(d, d);
+
+					if (length2 < distance2)
+					{
+						glm::vec3 normal;
+						if (feature == FACE)
+						{
+							normal = face_normals[triangle];
+						}
+						else
+						if (feature >= EDGE)
+						{
+							normal = edge_normals[3 * triangle + feature - EDGE];
+						}
+						else
+						{
+							normal = vertex_normals[indices[3 * triangle + feature - VERTEX]];
+						}
+
+						distance2 = length2;
+						sign = (glm::dot(d, normal) < 0.0f) ? -1.0f : 1.0f;
+					}
+				});
+
+				if (sign != 0.0f)
+				{
+					distances[(z * size.y + y) * size.x + x] = sign * std::sqrt(distance2);
+				}
+			}
+		}
+	});
+
+	// nodes outside the band: flood the exterior from the grid boundary, the rest is interior
+
+	std::vector<uint> stack;
+	const auto visit = [&](uint x, uint y, uint z)
+	{
+		const auto index = (z * size.y + y) * size.x + x;
+		if (distances[index] == FLT_MAX)
+		{
+			distances[index] = band;
+			stack.push_back(index);
+		}
+	};
+
+	for (uint z = 0; z < size.z; z++)
+	{
+		for (uint y = 0; y < size.y; y++)
+		{
+			for (uint x = 0; x < size.x; x++)
+			{
+				if ((x == 0) || (y == 0) || (z == 0) || (x == size.x - 1) || (y == size.y - 1) || (z == size.z - 1))
+				{
+					visit(x, y, z);
+				}
+			}
+		}
+	}
+
+	while (!stack.empty())
+	{
+		const auto index = stack.back();
+		stack.pop_back();
+
+		const auto x = index % size.x;
+		const auto y = (index / size.x) % size.y;
+		const auto z = index / (size.x * size.y);
+
+		if (x > 0)          visit(x - 1, y, z);
+		if (x < size.x - 1) visit(x + 1, y, z);
+		if (y > 0)          visit(x, y - 1, z);
+		if (y < size.y - 1) visit(x, y + 1, z);
+		if (z > 0)          visit(x, y, z - 1);
+		if (z < size.z - 1) visit(x, y, z + 1);
+	}
+
+	for (auto &distance : distances)
+	{
+		if (distance == FLT_MAX)
+		{
+			distance = -band;
+		}
+	}
+}
+
+//==============================================================================
+
+bool MeshCollider::Load(const std::string &path) noexcept
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	uint magic = 0;
+	unsigned long long key = 0;
+	glm::uvec3 file_size;
+	glm::vec3 file_origin;
+	float file_cell, file_band;
+
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&key), sizeof(key));
+	file.read(reinterpret_cast<char*>(&file_size), sizeof(file_size));
+	file.read(reinterpret_cast<char*>(&file_origin), sizeof(file_origin));
+	file.read(reinterpret_cast<char*>(&file_cell), sizeof(file_cell));
+	file.read(reinterpret_cast<char*>(&file_band), sizeof(file_band));
+
+	if (!file || (magic != sdf_magic) || (key != hash) ||
+	    (file_size != size) || (file_origin != origin) || (file_cell != cell) || (file_band != band))
+	{
+		return false;
+	}
+
+	std::vector<float> data(size.x * size.y * size.z);
+	file.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(float));
+	if (!file)
+	{
+		return false;
+	}
+
+	distances.swap(data);
+	return true;
+}
+
+//==============================================================================
+
+bool MeshCollider::Save(const std::string &path) const noexcept
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&sdf_magic), sizeof(sdf_magic));
+	file.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+	file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	file.write(reinterpret_cast<const char*>(&origin), sizeof(origin));
+	file.write(reinterpret_cast<const char*>(&cell), sizeof(cell));
+	file.write(reinterpret_cast<const char*>(&band), sizeof(band));
+	file.write(reinterpret_cast<const char*>(distances.data()), distances.size() * sizeof(float));
+
+	return static_cast<bool>(file);
+}
+
+//==============================================================================
+
+unsigned long long MeshCollider::GetHash() const noexcept
+{
+	return hash;
+}
+
+//==============================================================================
+
+float MeshCollider::Sample(const glm::vec3 &position, glm::vec3 &gradient) const noexcept
+{
+	gradient = glm::vec3(0.0f);
+
+	if (distances.empty())
+	{
+		return FLT_MAX;
+	}
+
+	const auto g = (position - origin) / cell;
+	const auto last = glm::vec3(size - glm::uvec3(1));
+	if (glm::any(glm::lessThan(g, glm::vec3(0.0f))) || glm::any(glm::greaterThan(g, last)))
+	{
+		return FLT_MAX;
+	}
+
+	const auto x = std::min(static_cast<uint>(g.x), size.x - 2);
+	const auto y = std::min(static_cast<uint>(g.y), size.y - 2);
+	const auto z = std::min(static_cast<uint>(g.z), size.z - 2);
+
+	const auto fx = g.x - x;
+	const auto fy = g.y - y;
+	const auto fz = g.z - z;
+
+	const auto c000 = GetDistance(x + 0, y + 0, z + 0);
+	const auto c100 = GetDistance(x + 1, y + 0, z + 0);
+	const auto c010 = GetDistance(x + 0, y + 1, z + 0);
+	const auto c110 = GetDistance(x + 1, y + 1, z + 0);
+	const auto c001 = GetDistance(x + 0, y + 0, z + 1);
+	const auto c101 = GetDistance(x + 1, y + 0, z + 1);
+	const auto c011 = GetDistance(x + 0, y + 1, z + 1);
+	const auto c111 = GetDistance(x + 1, y + 1, z + 1);
+
+	const auto c00 = c000 + fx * (c100 - c000);
+	const auto c10 = c010 + fx * (c110 - c010);
+	const auto c01 = c001 + fx * (c101 - c001);
+	const auto c11 = c011 + fx * (c111 - c011);
+
+	const auto c0 = c00 + fy * (c10 - c00);
+	const auto c1 = c01 + fy * (c11 - c01);
+
+	const auto dx0 = (c100 - c000) + fy * ((c110 - c010) - (c100 - c000));
+	const auto dx1 = (c101 - c001) + fy * ((c111 - c011) - (c101 - c001));
+
+	gradient.x = (dx0 + fz * (dx1 - dx0)) / cell;
+	gradient.y = ((c10 - c00) + fz * ((c11 - c01) - (c10 - c00))) / cell;
+	gradient.z = (c1 - c0) / cell;
+
+	return c0 + fz * (c1 - c0);
+}
+
+//==============================================================================
+
+void MeshCollider::Project(float *x, float *y, float *z, uint count, float thickness) const noexcept
+{
+	const Frame frame(transform, inverse);
+
+	for (uint i = 0; i < count; i++)
+	{
+		float lx, ly, lz;
+		ToLocal(frame, x[i], y[i], z[i], lx, ly, lz);
+
+		glm::vec3 gradient;
+		const auto distance = Sample(glm::vec3(lx, ly, lz), gradient);
+		const auto length = glm::length(gradient);
+
+		if ((distance < thickness) && (length > 0.0f))
+		{
+			const auto scale = (thickness - distance) / length;
+			AddWorld(frame, scale * gradient.x, scale * gradient.y, scale * gradient.z, x[i], y[i], z[i]);
+		}
+	}
+}
+
+//==============================================================================
+
+void MeshCollider::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "distances", MemoryReport::GetBytes(distances));
+}
+
+//==============================================================================
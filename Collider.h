@@ -0,0 +1,147 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AABB.h"
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class MemoryReport;
+class ThreadPool;
+
+//==============================================================================
+
+class Collider
+{
+protected:
+	glm::mat4 transform;
+	glm::mat4 inverse;
+	AABB bounds;
+
+protected:
+	virtual void UpdateBounds() noexcept = 0;
+
+public:
+	Collider() noexcept;
+	Collider(const Collider &) = delete;
+	virtual ~Collider() noexcept;
+
+	const glm::mat4 &GetTransform() const noexcept;
+	const AABB &GetBounds() const noexcept;
+
+	void SetTransform(const glm::mat4 &value) noexcept;
+
+	virtual void Project(float *x, float *y, float *z, uint count, float thickness) const noexcept = 0;
+
+	virtual void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+};
+
+//==============================================================================
+
+class SphereCollider : public Collider
+{
+protected:
+	float radius;
+
+protected:
+	void UpdateBounds() noexcept override;
+
+public:
+	explicit SphereCollider(float radius) noexcept;
+
+	void Project(float *x, float *y, float *z, uint count, float thickness) const noexcept override;
+};
+
+//==============================================================================
+
+class CapsuleCollider : public Collider
+{
+protected:
+	float radius;
+	float half_height;
+
+protected:
+	void UpdateBounds() noexcept override;
+
+public:
+	CapsuleCollider(float radius, float height) noexcept;
+
+	void Project(float *x, float *y, float *z, uint count, float thickness) const noexcept override;
+};
+
+//==============================================================================
+
+class BoxCollider : public Collider
+{
+protected:
+	glm::vec3 half_size;
+
+protected:
+	void UpdateBounds() noexcept override;
+
+public:
+	explicit BoxCollider(const glm::vec3 &size) noexcept;
+
+	void Project(float *x, float *y, float *z, uint count, float thickness) const noexcept override;
+};
+
+//==============================================================================
+
+class PlaneCollider : public Collider
+{
+protected:
+	void UpdateBounds() noexcept override;
+
+public:
+	PlaneCollider() noexcept;
+
+	void Project(float *x, float *y, float *z, uint count, float thickness) const noexcept override;
+};
+
+//==============================================================================
+
+class MeshCollider : public Collider
+{
+private:
+	glm::vec3 origin;
+	glm::uvec3 size;
+	float cell;
+	float band;
+	unsigned long long hash;
+	std::vector<float> distances;
+
+private:
+	void UpdateBounds() noexcept override;
+
+	float GetDistance(uint x, uint y, uint z) const noexcept;
+
+	void Build(const std::vector<float> &vertices, const std::vector<uint> &indices, ThreadPool &pool) noexcept;
+
+	bool Load(const std::string &path) noexcept;
+	bool Save(const std::string &path) const noexcept;
+
+public:
+	MeshCollider(const std::vector<float> &vertices,
+	             const std::vector<uint> &indices,
+	             ThreadPool &pool,
+	             uint resolution = 64,
+	             const std::string &cache = "") noexcept;
+
+	unsigned long long GetHash() const noexcept;
+
+	float Sample(const glm::vec3 &position, glm::vec3 &gradient) const noexcept;
+
+	void Project(float *x, float *y, float *z, uint count, float thickness) const noexcept override;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept override;
+};
+
+//==============================================================================
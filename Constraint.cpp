@@ -1,6 +1,9 @@
 
 #include "Constraint.h"
 
+#include <cfloat>
+#include <cmath>
+
 //==============================================================================
 
 Constraint::Constraint(Particle *p1, Particle *p2, float stiffness) noexcept :
@@ -26,6 +29,13 @@ Particle *Constraint::GetParticle2() const noexcept
 
 //==============================================================================
 
+float Constraint::GetCompliance() const noexcept
+{
+	return compliance;
+}
+
+//==============================================================================
+
 void Constraint::SetStiffness(float value) noexcept
 {
 	compliance = 1.0f / value;
@@ -40,30 +50,50 @@ DistanceConstraint::DistanceConstraint(Particle *p1, Particle *p2, float stiffne
 	const auto &B = p2->GetPosition();
 
 	const auto AB = B - A;
-	distance = sqrt(glm::dot(AB, AB));
+	distance = std::sqrt(glm::dot(AB, AB));
 }
 
 //==============================================================================
 
-void DistanceConstraint::Project(float dt, float inv_mass) const noexcept
+float DistanceConstraint::GetDistance() const noexcept
+{
+	return distance;
+}
+
+//==============================================================================
+
+float DistanceConstraint::GetStretch() const noexcept
 {
-	const auto inv_mass_sum = inv_mass + inv_mass;
+	const auto L = particle1->GetPosition() - particle2->GetPosition();
+	const auto length = std::sqrt(glm::dot(L, L));
 
-	const auto &p1 = particle1->GetPosition();
-	const auto &p2 = particle2->GetPosition();
+	return (length - distance) / (distance + 1e-30f);
+}
 
-	const auto L = p1 - p2;
-	const auto length = sqrt(glm::dot(L, L));
-	const auto constraint = length - distance;
+//==============================================================================
 
+void DistanceConstraint::Project(float dt, float inv_mass) const noexcept
+{
 	const auto alpha = compliance / (dt * dt);
 
-	const auto delta_lambda = -constraint / (inv_mass_sum + alpha);
+	const auto dp = GetCorrection(particle1->GetPosition(), particle2->GetPosition(), distance, alpha, inv_mass);
+
+	particle1->Move(+dp);
+	particle2->Move(-dp);
+}
+
+//==============================================================================
+
+Particle *BendConstraint::GetParticle3() const noexcept
+{
+	return particle3;
+}
 
-	const auto dp = delta_lambda * L / (length + 1e-30f);
+//==============================================================================
 
-	particle1->Move(+inv_mass * dp);
-	particle2->Move(-inv_mass * dp);
+Particle *BendConstraint::GetParticle4() const noexcept
+{
+	return particle4;
 }
 
 //==============================================================================
@@ -82,19 +112,45 @@ void BendConstraint::SetAngle(float value) noexcept
 
 //==============================================================================
 
-void BendConstraint::Project(float dt, float inv_mass) const noexcept
+float BendConstraint::GetError() const noexcept
 {
 	const auto &P1 = particle1->GetPosition();
 	const auto &P2 = particle2->GetPosition();
 	const auto &P3 = particle3->GetPosition();
 	const auto &P4 = particle4->GetPosition();
 
+	const auto n1 = glm::cross(P1 - P3, P2 - P3);
+	const auto n2 = glm::cross(P2 - P4, P1 - P4);
+
+	const auto n1_length2 = glm::dot(n1, n1);
+	const auto n2_length2 = glm::dot(n2, n2);
+
+	if ((n1_length2 < 1e-10) ||
+		(n2_length2 < 1e-10))
+	{
+		return 0.0f;
+	}
+
+	auto dot = glm::dot(n1, n2) / std::sqrt(n1_length2 * n2_length2);
+	if (dot < -1.0f) dot = -1.0f;
+	if (dot >  1.0f) dot =  1.0f;
+
+	constexpr auto PI = 3.1415927f;
+
+	return std::fabs(std::acos(dot) - (PI - angle));
+}
+
+//==============================================================================
+
+bool BendConstraint::GetGradient(const glm::vec3 &P1, const glm::vec3 &P2, const glm::vec3 &P3, const glm::vec3 &P4,
+	float angle, float &constraint, glm::vec3 (&gradient)[4]) noexcept
+{
 	const auto e = P2 - P1;
-	const auto elen = sqrt(glm::dot(e, e));
+	const auto elen = std::sqrt(glm::dot(e, e));
 
 	if (elen < 1e-6)
 	{
-		return;
+		return false;
 	}
 
 	const auto inv_elen = 1.0f / elen;
@@ -108,16 +164,16 @@ void BendConstraint::Project(float dt, float inv_mass) const noexcept
 	if ((n1_length2 < 1e-10) ||
 		(n2_length2 < 1e-10))
 	{
-		return;
+		return false;
 	}
 
 	n1 /= n1_length2;
 	n2 /= n2_length2;
 
-	const auto d3 = elen * n1;
-	const auto d4 = elen * n2;
-	const auto d1 = (glm::dot(P3 - P2, e) * n1 + glm::dot(P4 - P2, e) * n2) * inv_elen;
-	const auto d2 = (glm::dot(P1 - P3, e) * n1 + glm::dot(P1 - P4, e) * n2) * inv_elen;
+	gradient[2] = elen * n1;
+	gradient[3] = elen * n2;
+	gradient[0] = (glm::dot(P3 - P2, e) * n1 + glm::dot(P4 - P2, e) * n2) * inv_elen;
+	gradient[1] = (glm::dot(P1 - P3, e) * n1 + glm::dot(P1 - P4, e) * n2) * inv_elen;
 
 	n1 = glm::normalize(n1);
 	n2 = glm::normalize(n2);
@@ -126,33 +182,110 @@ void BendConstraint::Project(float dt, float inv_mass) const noexcept
 	if (dot < -1.0f) dot = -1.0f;
 	if (dot >  1.0f) dot =  1.0f;
 
-	const auto phi = acos(dot);
+	const auto phi = std::acos(dot);
+
+	constexpr auto PI = 3.1415927f;
+	const auto a = PI - angle;
+
+	constraint = phi - a;
+
+	// the gradients above are those of the unsigned angle
+	if (((phi - std::fabs(a)) > 0.0f) && (glm::dot(glm::cross(n1, n2), e) > 0.0f))
+	{
+		constraint = -constraint;
+	}
+
+	return true;
+}
+
+//==============================================================================
+
+bool BendConstraint::GetCorrection(const glm::vec3 &P1, const glm::vec3 &P2, const glm::vec3 &P3, const glm::vec3 &P4,
+	float angle, float alpha, float inv_mass, glm::vec3 (&dp)[4]) noexcept
+{
+	float constraint;
+	glm::vec3 gradient[4];
 
-	const auto sum = inv_mass * (glm::dot(d1, d1) + glm::dot(d2, d2) + 
-		                         glm::dot(d3, d3) + glm::dot(d4, d4));
+	if (!GetGradient(P1, P2, P3, P4, angle, constraint, gradient))
+	{
+		return false;
+	}
+
+	const auto sum = inv_mass * (glm::dot(gradient[0], gradient[0]) + glm::dot(gradient[1], gradient[1]) + 
+		                         glm::dot(gradient[2], gradient[2]) + glm::dot(gradient[3], gradient[3]));
+
+	const auto delta_lambda = -constraint / (sum + alpha);
+
+	for (uint i = 0; i < 4; i++)
+	{
+		dp[i] = inv_mass * delta_lambda * gradient[i];
+	}
+
+	return true;
+}
 
+//==============================================================================
+
+void BendConstraint::Project(float dt, float inv_mass) const noexcept
+{
 	const auto alpha = compliance / (dt * dt);
 
-	constexpr auto PI = 3.1415927f;
-	const auto a = PI - angle;
+	glm::vec3 dp[4];
+	if (!GetCorrection(particle1->GetPosition(), particle2->GetPosition(),
+	                   particle3->GetPosition(), particle4->GetPosition(), angle, alpha, inv_mass, dp))
+	{
+		return;
+	}
+
+	particle1->Move(dp[0]);
+	particle2->Move(dp[1]);
+	particle3->Move(dp[2]);
+	particle4->Move(dp[3]);
+}
+
+//==============================================================================
+
+ContactConstraint::ContactConstraint(Particle *p1, Particle *p2, Particle *p3, Particle *p4,
+	const glm::vec4 &weights, const glm::vec3 &normal, float thickness) noexcept :
+	Constraint(p1, p2, FLT_MAX),
+	particle3(p3),
+	particle4(p4),
+	weights(weights),
+	normal(normal),
+	thickness(thickness)
+{
+}
+
+//==============================================================================
+
+void ContactConstraint::Project(float, float inv_mass) const noexcept
+{
+	Particle *particles[4] = { particle1, particle2, particle3, particle4 };
+
+	auto P = glm::vec3(0.0f, 0.0f, 0.0f);
+	auto sum = 0.0f;
+	float inv_masses[4];
 
-	const auto constraint = phi - a;
-	auto delta_lambda = -constraint / (sum + alpha);
+	for (uint i = 0; i < 4; i++)
+	{
+		inv_masses[i] = particles[i]->IsFixed() ? 0.0f : inv_mass;
+
+		P += weights[i] * particles[i]->GetPosition();
+		sum += inv_masses[i] * weights[i] * weights[i];
+	}
 
-	if (((phi - fabs(a)) > 0.0f) && (glm::dot(glm::cross(n1, n2), e) > 0.0f))
+	const auto constraint = glm::dot(P, normal) - thickness;
+	if ((constraint >= 0.0f) || (sum <= 0.0f))
 	{
-		delta_lambda = -delta_lambda;
+		return;
 	}
 
-	const auto dp1 = inv_mass * delta_lambda * d1;
-	const auto dp2 = inv_mass * delta_lambda * d2;
-	const auto dp3 = inv_mass * delta_lambda * d3;
-	const auto dp4 = inv_mass * delta_lambda * d4;
+	const auto delta_lambda = -constraint / sum;
 
-	particle1->Move(dp1);
-	particle2->Move(dp2);
-	particle3->Move(dp3);
-	particle4->Move(dp4);
+	for (uint i = 0; i < 4; i++)
+	{
+		particles[i]->Move(inv_masses[i] * weights[i] * delta_lambda * normal);
+	}
 }
 
 //==============================================================================
@@ -3,6 +3,8 @@
 
 //==============================================================================
 
+#include <cmath>
+
 #include "Particle.h"
 
 //==============================================================================
@@ -23,6 +25,7 @@ public:
 
 	Particle *GetParticle1() const noexcept;
 	Particle *GetParticle2() const noexcept;
+	float GetCompliance() const noexcept;
 
 	void SetStiffness(float value) noexcept;
 
@@ -39,11 +42,35 @@ protected:
 public:
 	DistanceConstraint(Particle *p1, Particle *p2, float stiffness) noexcept;
 
+	float GetDistance() const noexcept;
+	float GetStretch() const noexcept;
+
+	// correction of p1 (p2 moves by its negative) for alpha = compliance / dt^2
+	static glm::vec3 GetCorrection(const glm::vec3 &p1, const glm::vec3 &p2,
+		float distance, float alpha, float inv_mass) noexcept;
+
 	void Project(float dt, float inv_mass) const noexcept override;
 };
 
 //==============================================================================
 
+// inline so the lane loops of ClothBatch vectorize through it
+inline glm::vec3 DistanceConstraint::GetCorrection(const glm::vec3 &p1, const glm::vec3 &p2,
+	float distance, float alpha, float inv_mass) noexcept
+{
+	const auto inv_mass_sum = inv_mass + inv_mass;
+
+	const auto L = p1 - p2;
+	const auto length = std::sqrt(glm::dot(L, L));
+	const auto constraint = length - distance;
+
+	const auto delta_lambda = -constraint / (inv_mass_sum + alpha);
+
+	return inv_mass * (delta_lambda * L / (length + 1e-30f));
+}
+
+//==============================================================================
+
 class BendConstraint : public Constraint
 {
 protected:
@@ -61,10 +88,40 @@ public:
 	{
 	}
 
+	Particle *GetParticle3() const noexcept;
+	Particle *GetParticle4() const noexcept;
+
 	float GetAngle() const noexcept;
+	float GetError() const noexcept;
 
 	void SetAngle(float value) noexcept;
 
+	// signed constraint value and its gradient for the four particles, false if the stencil is degenerate
+	static bool GetGradient(const glm::vec3 &P1, const glm::vec3 &P2, const glm::vec3 &P3, const glm::vec3 &P4,
+		float angle, float &constraint, glm::vec3 (&gradient)[4]) noexcept;
+
+	// corrections of the four particles, false if the stencil is degenerate
+	static bool GetCorrection(const glm::vec3 &P1, const glm::vec3 &P2, const glm::vec3 &P3, const glm::vec3 &P4,
+		float angle, float alpha, float inv_mass, glm::vec3 (&dp)[4]) noexcept;
+
+	void Project(float dt, float inv_mass) const noexcept override;
+};
+
+//==============================================================================
+
+class ContactConstraint : public Constraint
+{
+protected:
+	Particle *particle3;
+	Particle *particle4;
+	glm::vec4 weights;
+	glm::vec3 normal;
+	float thickness;
+
+public:
+	ContactConstraint(Particle *p1, Particle *p2, Particle *p3, Particle *p4,
+		const glm::vec4 &weights, const glm::vec3 &normal, float thickness) noexcept;
+
 	void Project(float dt, float inv_mass) const noexcept override;
 };
 
@@ -0,0 +1,709 @@
+
+#include "ContinuousCollision.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "MemoryReport.h"
+#include "Particle.h"
+#include "ThreadPool.h"
+#include "Topology.h"
+
+//==============================================================================
+
+namespace
+{
+
+typedef glm::dvec3 dvec3;
+
+//==============================================================================
+
+void GetCoplanarity(const dvec3 &A0, const dvec3 &Av,
+                    const dvec3 &B0, const dvec3 &Bv,
+                    const dvec3 &C0, const dvec3 &Cv,
+                    double k[4]) noexcept
+{
+	const auto BC0 = glm::cross(B0, C0);
+	const auto BC1 = glm::cross(B0, Cv) + glm::cross(Bv, C0);
+	const auto BC2 = glm::cross(Bv, Cv);
+
+	k[0] = glm::dot(A0, BC0);
+	k[1] = glm::dot(Av, BC0) + glm::dot(A0, BC1);
+	k[2] = glm::dot(Av, BC1) + glm::dot(A0, BC2);
+	k[3] = glm::dot(Av, BC2);
+}
+
+//==============================================================================
+
+bool HasBernsteinRoot(const double k[4]) noexcept
+{
+	const double b[4] =
+	{
+		k[0],
+		k[0] + k[1] / 3.0,
+		k[0] + 2.0 * k[1] / 3.0 + k[2] / 3.0,
+		k[0] + k[1] + k[2] + k[3]
+	};
+
+	const auto all_positive = (b[0] > 0.0) && (b[1] > 0.0) && (b[2] > 0.0) && (b[3] > 0.0);
+	const auto all_negative = (b[0] < 0.0) && (b[1] < 0.0) && (b[2] < 0.0) && (b[3] < 0.0);
+
+	return !all_positive && !all_negative;
+}
+
+//==============================================================================
+
+double Evaluate(const double k[4], double t) noexcept
+{
+	return ((k[3] * t + k[2]) * t + k[1]) * t + k[0];
+}
+
+//==============================================================================
+
+uint SolveCubic(const double k[4], double roots[3]) noexcept
+{
+	double bounds[4] = { 0.0, 0.0, 0.0, 1.0 };
+	uint size = 1;
+
+	const auto a = 3.0 * k[3];
+	const auto b = 2.0 * k[2];
+	const auto c = k[1];
+
+	if (std::fabs(a) > 1e-30)
+	{
+		const auto discriminant = b * b - 4.0 * a * c;
+		if (discriminant >= 0.0)
+		{
+			const auto root = std::sqrt(discriminant);
+			const auto t1 = (-b - root) / (2.0 * a);
+			const auto t2 = (-b + root) / (2.0 * a);
+
+			for (const auto t : { std::min(t1, t2), std::max(t1, t2) })
+			{
+				if ((t > 0.0) && (t < 1.0))
+				{
+					bounds[size++] = t;
+				}
+			}
+		}
+	}
+	else
+	if (std::fabs(b) > 1e-30)
+	{
+		const auto t = -c / b;
+		if ((t > 0.0) && (t < 1.0))
+		{
+			bounds[size++] = t;
+		}
+	}
+
+	bounds[size++] = 1.0;
+
+	uint count = 0;
+	for (uint i = 0; i + 1 < size; i++)
+	{
+		auto lo = bounds[i];
+		auto hi = bounds[i + 1];
+
+		auto flo = Evaluate(k, lo);
+		const auto fhi = Evaluate(k, hi);
+
+		if (flo == 0.0)
+		{
+			if ((count == 0) || (roots[count - 1] != lo))
+			{
+				roots[count++] = lo;
+			}
+			continue;
+		}
+
+		if ((flo > 0.0) == (fhi > 0.0))
+		{
+			continue;
+		}
+
+		for (uint j = 0; j < 30; j++)
+		{
+			const auto mid = 0.5 * (lo + hi);
+			const auto fmid = Evaluate(k, mid);
+
+			if ((fmid > 0.0) == (flo > 0.0))
+			{
+				lo = mid;
+				flo = fmid;
+			}
+			else
+			{
+				hi = mid;
+			}
+		}
+
+		roots[count++] = hi;
+	}
+
+	return count;
+}
+
+//==============================================================================
+
+dvec3 Lerp(const dvec3 &x0, const dvec3 &x1, double t) noexcept
+{
+	return x0 + t * (x1 - x0);
+}
+
+//==============================================================================
+
+bool GetBarycentric(const dvec3 &P, const dvec3 &A, const dvec3 &B, const dvec3 &C, dvec3 &weights) noexcept
+{
+	const auto v0 = B - A;
+	const auto v1 = C - A;
+	const auto v2 = P - A;
+
+	const auto d00 = glm::dot(v0, v0);
+	const auto d01 = glm::dot(v0, v1);
+	const auto d11 = glm::dot(v1, v1);
+	const auto d20 = glm::dot(v2, v0);
+	const auto d21 = glm::dot(v2, v1);
+
+	const auto denominator = d00 * d11 - d01 * d01;
+	if (denominator < 1e-30)
+	{
+		return false;
+	}
+
+	const auto v = (d11 * d20 - d01 * d21) / denominator;
+	const auto w = (d00 * d21 - d01 * d20) / denominator;
+
+	weights = dvec3(1.0 - v - w, v, w);
+
+	return true;
+}
+
+//==============================================================================
+
+dvec3 GetClosestTrianglePoint(const dvec3 &P, const dvec3 &A, const dvec3 &B, const dvec3 &C) noexcept
+{
+	const auto AB = B - A;
+	const auto AC = C - A;
+	const auto AP = P - A;
+
+	const auto d1 = glm::dot(AB, AP);
+	const auto d2 = glm::dot(AC, AP);
+	if ((d1 <= 0.0) && (d2 <= 0.0))
+	{
+		return A;
+	}
+
+	const auto BP = P - B;
+	const auto d3 = glm::dot(AB, BP);
+	const auto d4 = glm::dot(AC, BP);
+	if ((d3 >= 0.0) && (d4 <= d3))
+	{
+		return B;
+	}
+
+	const auto vc = d1 * d4 - d3 * d2;
+	if ((vc <= 0.0) && (d1 >= 0.0) && (d3 <= 0.0))
+	{
+		return A + (d1 / (d1 - d3)) * AB;
+	}
+
+	const auto CP = P - C;
+	const auto d5 = glm::dot(AB, CP);
+	const auto d6 = glm::dot(AC, CP);
+	if ((d6 >= 0.0) && (d5 <= d6))
+	{
+		return C;
+	}
+
+	const auto vb = d5 * d2 - d1 * d6;
+	if ((vb <= 0.0) && (d2 >= 0.0) && (d6 <= 0.0))
+	{
+		return A + (d2 / (d2 - d6)) * AC;
+	}
+
+	const auto va = d3 * d6 - d5 * d4;
+	if ((va <= 0.0) && ((d4 - d3) >= 0.0) && ((d5 - d6) >= 0.0))
+	{
+		return B + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (C - B);
+	}
+
+	const auto denominator = 1.0 / (va + vb + vc);
+	return A + AB * (vb * denominator) + AC * (vc * denominator);
+}
+
+//==============================================================================
+
+void GetClosestSegmentPoints(const dvec3 &P1, const dvec3 &Q1,
+                             const dvec3 &P2, const dvec3 &Q2,
+                             double &s, double &u) noexcept
+{
+	const auto d1 = Q1 - P1;
+	const auto d2 = Q2 - P2;
+	const auto r  = P1 - P2;
+
+	const auto a = glm::dot(d1, d1);
+	const auto e = glm::dot(d2, d2);
+	const auto f = glm::dot(d2, r);
+	const auto c = glm::dot(d1, r);
+	const auto b = glm::dot(d1, d2);
+
+	const auto denominator = a * e - b * b;
+
+	s = (denominator > 1e-30) ? glm::clamp((b * f - c * e) / denominator, 0.0, 1.0) : 0.0;
+	u = (e > 1e-30) ? (b * s + f) / e : 0.0;
+
+	if (u < 0.0)
+	{
+		u = 0.0;
+		s = (a > 1e-30) ? glm::clamp(-c / a, 0.0, 1.0) : 0.0;
+	}
+	else
+	if (u > 1.0)
+	{
+		u = 1.0;
+		s = (a > 1e-30) ? glm::clamp((b - c) / a, 0.0, 1.0) : 0.0;
+	}
+}
+
+}
+
+//==============================================================================
+
+void ContinuousCollision::CalculateBoxes(const std::vector<Particle*> &particles,
+                                         const std::vector<uint> &indices,
+                                         const Topology &topology) noexcept
+{
+	const auto &edges = topology.GetEdges();
+
+	const auto triangles = static_cast<uint>(indices.size() / 3);
+	const auto edges_size = static_cast<uint>(edges.size());
+
+	triangle_boxes.resize(triangles);
+	edge_boxes.resize(edges_size);
+
+	const auto sweep = [&](AABB &box, uint index)
+	{
+		const auto particle = particles[index];
+		box.Add(particle->GetPreviousPosition());
+		box.Add(particle->GetPosition());
+	};
+
+	pool->ParallelFor(0, triangles, 1024, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			AABB box;
+			sweep(box, indices[3 * i + 0]);
+			sweep(box, indices[3 * i + 1]);
+			sweep(box, indices[3 * i + 2]);
+			box.Inflate(thickness);
+
+			triangle_boxes[i] = box;
+		}
+	});
+
+	pool->ParallelFor(0, edges_size, 1024, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			AABB box;
+			sweep(box, edges[i].ind1);
+			sweep(box, edges[i].ind2);
+			box.Inflate(0.5f * thickness);
+
+			edge_boxes[i] = box;
+		}
+	});
+}
+
+//==============================================================================
+
+void ContinuousCollision::DetectVertexTriangle(const std::vector<Particle*> &particles,
+                                               const std::vector<uint> &indices) noexcept
+{
+	const auto size = static_cast<uint>(particles.size());
+
+	const auto chunks = 16 * pool->GetThreadCount();
+	const auto grain = std::max((size + chunks - 1) / chunks, 1u);
+
+	ClearChunks(chunks);
+
+	pool->ParallelFor(0, size, grain, [&](uint first, uint last)
+	{
+		auto &impacts = chunk_impacts[first / grain];
+
+		for (auto i = first; i < last; i++)
+		{
+			const auto particle = particles[i];
+
+			const dvec3 p0 = particle->GetPreviousPosition();
+			const dvec3 p1 = particle->GetPosition();
+
+			AABB box;
+			box.Add(particle->GetPreviousPosition());
+			box.Add(particle->GetPosition());
+
+			triangle_tree.Query(box, [&](uint triangle)
+			{
+				const auto ia = indices[3 * triangle + 0];
+				const auto ib = indices[3 * triangle + 1];
+				const auto ic = indices[3 * triangle + 2];
+
+				if ((ia == i) || (ib == i) || (ic == i))
+				{
+					return;
+				}
+
+				if (!triangle_boxes[triangle].Overlaps(box))
+				{
+					return;
+				}
+
+				const dvec3 a0 = particles[ia]->GetPreviousPosition();
+				const dvec3 b0 = particles[ib]->GetPreviousPosition();
+				const dvec3 c0 = particles[ic]->GetPreviousPosition();
+				const dvec3 a1 = particles[ia]->GetPosition();
+				const dvec3 b1 = particles[ib]->GetPosition();
+				const dvec3 c1 = particles[ic]->GetPosition();
+
+				double k[4];
+				GetCoplanarity(a0 - p0, (a1 - p1) - (a0 - p0),
+				               b0 - p0, (b1 - p1) - (b0 - p0),
+				               c0 - p0, (c1 - p1) - (c0 - p0), k);
+
+				if (!HasBernsteinRoot(k))
+				{
+					return;
+				}
+
+				const auto motion = glm::length(p1 - p0) + std::max(std::max(
+					glm::length(a1 - a0), glm::length(b1 - b0)), glm::length(c1 - c0));
+
+				if (glm::length(p0 - GetClosestTrianglePoint(p0, a0, b0, c0)) > thickness + motion)
+				{
+					return;
+				}
+
+				double roots[3];
+				const auto count = SolveCubic(k, roots);
+
+				for (uint r = 0; r < count; r++)
+				{
+					const auto t = roots[r];
+
+					const auto P = Lerp(p0, p1, t);
+					const auto A = Lerp(a0, a1, t);
+					const auto B = Lerp(b0, b1, t);
+					const auto C = Lerp(c0, c1, t);
+
+					dvec3 weights;
+					if (!GetBarycentric(P, A, B, C, weights))
+					{
+						continue;
+					}
+
+					const auto tolerance = -1e-6;
+					if ((weights.x < tolerance) || (weights.y < tolerance) || (weights.z < tolerance))
+					{
+						continue;
+					}
+
+					const auto Q = weights.x * A + weights.y * B + weights.z * C;
+					if (glm::length(P - Q) > thickness)
+					{
+						continue;
+					}
+
+					auto normal = glm::cross(b0 - a0, c0 - a0);
+					const auto length = glm::length(normal);
+					if (length < 1e-20)
+					{
+						break;
+					}
+
+					normal /= length;
+					if (glm::dot(normal, p0 - a0) < 0.0)
+					{
+						normal = -normal;
+					}
+
+					const glm::vec4 w(1.0f, -weights.x, -weights.y, -weights.z);
+					const auto key = (static_cast<unsigned long long>(i) << 32) | triangle;
+
+					impacts.push_back({ key, ContactConstraint(particle, particles[ia], particles[ib], particles[ic],
+						w, glm::vec3(normal), thickness) });
+					break;
+				}
+			});
+		}
+
+	});
+
+	MergeChunks(chunks);
+}
+
+//==============================================================================
+
+void ContinuousCollision::DetectEdgeEdge(const std::vector<Particle*> &particles,
+                                         const Topology &topology) noexcept
+{
+	const auto &edges = topology.GetEdges();
+
+	edge_tree.GetSelfQueryTasks(16 * pool->GetThreadCount(), tasks);
+
+	const auto size = static_cast<uint>(tasks.size());
+
+	ClearChunks(size);
+
+	pool->ParallelFor(0, size, 1, [&](uint first, uint last)
+	{
+		auto &impacts = chunk_impacts[first];
+
+		for (auto task = first; task < last; task++)
+		{
+			edge_tree.SelfQuery(tasks[task].first, tasks[task].second, [&](uint i, uint j)
+			{
+				if (i > j)
+				{
+					std::swap(i, j);
+				}
+
+				const auto &edge1 = edges[i];
+				const auto &edge2 = edges[j];
+
+				if ((edge2.ind1 == edge1.ind1) || (edge2.ind1 == edge1.ind2) ||
+				    (edge2.ind2 == edge1.ind1) || (edge2.ind2 == edge1.ind2))
+				{
+					return;
+				}
+
+				if (!edge_boxes[j].Overlaps(edge_boxes[i]))
+				{
+					return;
+				}
+
+				const auto particle1 = particles[edge1.ind1];
+				const auto particle2 = particles[edge1.ind2];
+				const auto particle3 = particles[edge2.ind1];
+				const auto particle4 = particles[edge2.ind2];
+
+				const dvec3 p0 = particle1->GetPreviousPosition();
+				const dvec3 q0 = particle2->GetPreviousPosition();
+				const dvec3 r0 = particle3->GetPreviousPosition();
+				const dvec3 s0 = particle4->GetPreviousPosition();
+
+				const dvec3 p1 = particle1->GetPosition();
+				const dvec3 q1 = particle2->GetPosition();
+				const dvec3 r1 = particle3->GetPosition();
+				const dvec3 s1 = particle4->GetPosition();
+
+				double k[4];
+				GetCoplanarity(r0 - p0, (r1 - p1) - (r0 - p0),
+				               q0 - p0, (q1 - p1) - (q0 - p0),
+				               s0 - r0, (s1 - r1) - (s0 - r0), k);
+
+				if (!HasBernsteinRoot(k))
+				{
+					return;
+				}
+
+				const auto motion =
+					std::max(glm::length(p1 - p0), glm::length(q1 - q0)) +
+					std::max(glm::length(r1 - r0), glm::length(s1 - s0));
+
+				double a, b;
+				GetClosestSegmentPoints(p0, q0, r0, s0, a, b);
+
+				if (glm::length((p0 + a * (q0 - p0)) - (r0 + b * (s0 - r0))) > thickness + motion)
+				{
+					return;
+				}
+
+				double roots[3];
+				const auto count = SolveCubic(k, roots);
+
+				for (uint r = 0; r < count; r++)
+				{
+					const auto t = roots[r];
+
+					const auto P = Lerp(p0, p1, t);
+					const auto Q = Lerp(q0, q1, t);
+					const auto R = Lerp(r0, r1, t);
+					const auto S = Lerp(s0, s1, t);
+
+					GetClosestSegmentPoints(P, Q, R, S, a, b);
+
+					if (glm::length((P + a * (Q - P)) - (R + b * (S - R))) > thickness)
+					{
+						continue;
+					}
+
+					auto normal = (p0 + a * (q0 - p0)) - (r0 + b * (s0 - r0));
+					auto length = glm::length(normal);
+
+					if (length < 1e-12)
+					{
+						normal = glm::cross(q0 - p0, s0 - r0);
+						length = glm::length(normal);
+					}
+
+					if (length < 1e-20)
+					{
+						break;
+					}
+
+					normal /= length;
+
+					const glm::vec4 w(1.0 - a, a, -(1.0 - b), -b);
+					const auto key = (1ull << 63) | (static_cast<unsigned long long>(i) << 32) | j;
+
+					impacts.push_back({ key, ContactConstraint(particle1, particle2, particle3, particle4,
+						w, glm::vec3(normal), thickness) });
+					break;
+				}
+			});
+		}
+
+	});
+
+	MergeChunks(size);
+}
+
+//==============================================================================
+
+void ContinuousCollision::ClearChunks(uint count) noexcept
+{
+	if (chunk_impacts.size() < count)
+	{
+		chunk_impacts.resize(count);
+	}
+
+	for (uint k = 0; k < count; k++)
+	{
+		chunk_impacts[k].clear();
+	}
+}
+
+//==============================================================================
+
+void ContinuousCollision::MergeChunks(uint count) noexcept
+{
+	for (uint k = 0; k < count; k++)
+	{
+		impacts.insert(impacts.end(), chunk_impacts[k].begin(), chunk_impacts[k].end());
+	}
+}
+
+//==============================================================================
+
+ContinuousCollision::ContinuousCollision(ThreadPool &pool) noexcept :
+	pool(&pool),
+	enabled(false),
+	thickness(0.0f),
+	iterations(4)
+{
+}
+
+//==============================================================================
+
+bool ContinuousCollision::IsEnabled() const noexcept
+{
+	return enabled;
+}
+
+//==============================================================================
+
+void ContinuousCollision::SetEnabled(bool value) noexcept
+{
+	enabled = value;
+}
+
+//==============================================================================
+
+float ContinuousCollision::GetThickness() const noexcept
+{
+	return thickness;
+}
+
+//==============================================================================
+
+void ContinuousCollision::SetThickness(float value) noexcept
+{
+	thickness = value;
+}
+
+//==============================================================================
+
+void ContinuousCollision::SetIterations(uint value) noexcept
+{
+	iterations = value;
+}
+
+//==============================================================================
+
+const std::vector<ContactConstraint> &ContinuousCollision::GetContacts() const noexcept
+{
+	return contacts;
+}
+
+//==============================================================================
+
+void ContinuousCollision::Solve(const std::vector<Particle*> &particles,
+                                const std::vector<uint> &indices,
+                                const Topology &topology,
+                                float dt,
+                                float inv_mass) noexcept
+{
+	contacts.clear();
+
+	if (!enabled)
+	{
+		return;
+	}
+
+	CalculateBoxes(particles, indices, topology);
+
+	triangle_tree.Update(triangle_boxes);
+	edge_tree.Update(edge_boxes);
+
+	impacts.clear();
+
+	DetectVertexTriangle(particles, indices);
+	DetectEdgeEdge(particles, topology);
+
+	std::sort(impacts.begin(), impacts.end(), [](const Impact &a, const Impact &b)
+	{
+		return a.key < b.key;
+	});
+
+	contacts.reserve(impacts.size());
+	for (const auto &impact : impacts)
+	{
+		contacts.push_back(impact.constraint);
+	}
+
+	for (uint i = 0; i < iterations; i++)
+	{
+		for (const auto &contact : contacts)
+		{
+			contact.Project(dt, inv_mass);
+		}
+	}
+}
+
+//==============================================================================
+
+void ContinuousCollision::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	triangle_tree.GetMemoryUsage(report, prefix + "triangle_tree.");
+	edge_tree.GetMemoryUsage(report, prefix + "edge_tree.");
+
+	report.Add(prefix + "triangle_boxes", MemoryReport::GetBytes(triangle_boxes));
+	report.Add(prefix + "edge_boxes", MemoryReport::GetBytes(edge_boxes));
+	report.Add(prefix + "impacts", MemoryReport::GetBytes(impacts) + MemoryReport::GetBytes(chunk_impacts));
+	report.Add(prefix + "tasks", MemoryReport::GetBytes(tasks));
+	report.Add(prefix + "contacts", MemoryReport::GetBytes(contacts));
+}
+
+//==============================================================================
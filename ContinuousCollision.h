@@ -0,0 +1,94 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "BVH.h"
+#include "Constraint.h"
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class MemoryReport;
+class Particle;
+class ThreadPool;
+class Topology;
+
+//==============================================================================
+
+// Vertex-triangle and edge-edge impacts along the motion of a substep, from the
+// previous positions to the projected ones. They are found after the distance
+// and bend constraints are solved and resolved by their own rounds of contact
+// projections, not fed back into the constraint solve, so a larger time step
+// is only as safe as those rounds. Off by default: on a sheet the detection
+// costs several times the whole constraint solve.
+class ContinuousCollision
+{
+private:
+	ThreadPool *pool;
+	struct Impact
+	{
+		unsigned long long key;
+		ContactConstraint constraint;
+	};
+
+private:
+	bool enabled;
+	float thickness;
+	uint iterations;
+
+	BVH triangle_tree;
+	BVH edge_tree;
+
+	std::vector<AABB> triangle_boxes;
+	std::vector<AABB> edge_boxes;
+
+	std::vector<std::pair<uint, uint>> tasks; // self query tasks of the edge tree
+	std::vector<std::vector<Impact>> chunk_impacts; // per chunk of a detection pass, kept for their capacity
+	std::vector<Impact> impacts;
+	std::vector<ContactConstraint> contacts;
+
+private:
+	void CalculateBoxes(const std::vector<Particle*> &particles,
+	                    const std::vector<uint> &indices,
+	                    const Topology &topology) noexcept;
+
+	void DetectVertexTriangle(const std::vector<Particle*> &particles,
+	                          const std::vector<uint> &indices) noexcept;
+
+	void DetectEdgeEdge(const std::vector<Particle*> &particles,
+	                    const Topology &topology) noexcept;
+
+	// clears the buffers of chunks [0, count) and, once they are filled, appends them to impacts
+	void ClearChunks(uint count) noexcept;
+	void MergeChunks(uint count) noexcept;
+
+public:
+	explicit ContinuousCollision(ThreadPool &pool) noexcept;
+
+	bool IsEnabled() const noexcept;
+	void SetEnabled(bool value) noexcept;
+
+	float GetThickness() const noexcept;
+	void SetThickness(float value) noexcept;
+	void SetIterations(uint value) noexcept;
+
+	const std::vector<ContactConstraint> &GetContacts() const noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+
+	void Solve(const std::vector<Particle*> &particles,
+	           const std::vector<uint> &indices,
+	           const Topology &topology,
+	           float dt,
+	           float inv_mass) noexcept;
+};
+
+//==============================================================================
@@ -3,6 +3,9 @@
 
 #include "GLAD/glad.h"
 
+#include "MemoryReport.h"
+#include "Trace.h"
+
 //==============================================================================
 
 Drawable::Drawable() noexcept :
@@ -10,6 +13,8 @@ Drawable::Drawable() noexcept :
 	VBO(0),
 	EBO(0),
 	count(0),
+	vertex_buffer_size(0),
+	index_buffer_size(0),
 	model(1.0f)
 {
 	glGenVertexArrays(1, &VAO);
@@ -67,6 +72,9 @@ void Drawable::SetBuffers(const std::vector<float> &vertices,
 	const auto uvs_size      = uvs.size()      * sizeof(float);
 	const auto indices_size  = indices.size()  * sizeof(uint);
 
+	vertex_buffer_size = vertices_size + normals_size + uvs_size;
+	index_buffer_size = indices_size;
+
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &EBO);
@@ -101,6 +109,8 @@ void Drawable::UpdateBuffers(const std::vector<float> &vertices,
 	                         const std::vector<float> &normals,
 	                         const std::vector<float> &uvs) noexcept
 {
+	TRACE_SCOPE("drawable.update_buffers");
+
 	const auto vertices_size = vertices.size() * sizeof(GLfloat);
 	const auto normals_size  = normals.size()  * sizeof(GLfloat);
 	const auto uvs_size      = uvs.size()      * sizeof(GLfloat);
@@ -142,7 +152,17 @@ void Drawable::Clear() noexcept
 		EBO = 0;
 
 		count = 0;
+		vertex_buffer_size = 0;
+		index_buffer_size = 0;
 	}
 }
 
 //==============================================================================
+
+void Drawable::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "vertex_buffer", vertex_buffer_size);
+	report.Add(prefix + "index_buffer", index_buffer_size);
+}
+
+//==============================================================================
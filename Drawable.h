@@ -3,6 +3,7 @@
 
 //==============================================================================
 
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -11,6 +12,8 @@
 
 typedef unsigned int uint;
 
+class MemoryReport;
+
 //==============================================================================
 
 class Drawable
@@ -20,6 +23,8 @@ protected:
 	unsigned int VBO;
 	unsigned int EBO;
 	unsigned int count;
+	size_t vertex_buffer_size;
+	size_t index_buffer_size;
 	glm::mat4 model;
 
 public:
@@ -42,6 +47,8 @@ public:
 		               const std::vector<float> &uvs)  noexcept;
 
 	void Clear() noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
 };
 
 //==============================================================================
@@ -0,0 +1,368 @@
+
+#include "ImplicitEulerSolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+#include "Constraint.h"
+#include "MemoryReport.h"
+#include "Particle.h"
+#include "ThreadPool.h"
+#include "Topology.h"
+
+//==============================================================================
+
+ImplicitEulerSolver::ImplicitEulerSolver(const Topology &topology, uint particles_size, ThreadPool &pool) noexcept :
+	pool(&pool),
+	iterations(0)
+{
+	// bend constraints follow the interior edges in order, see Cloth::GenerateBendConstraints
+
+	const auto &edges = topology.GetEdges();
+
+	bend_offsets.assign(particles_size + 1, 0);
+
+	for (const auto &edge : edges)
+	{
+		if (!edge.boundary)
+		{
+			for (const auto ind : { edge.ind1, edge.ind2, edge.ind3, edge.ind4 })
+			{
+				bends.push_back(ind);
+				bend_offsets[ind + 1]++;
+			}
+		}
+	}
+
+	for (uint i = 0; i < particles_size; i++)
+	{
+		bend_offsets[i + 1] += bend_offsets[i];
+	}
+
+	bend_roles.resize(bends.size());
+
+	auto next = bend_offsets;
+	for (uint k = 0; k < static_cast<uint>(bends.size()); k++)
+	{
+		bend_roles[next[bends[k]]++] = k;
+	}
+
+	edge_hessians.resize(edges.size());
+	edge_forces.resize(edges.size());
+	bend_gradients.resize(bends.size());
+	bend_values.resize(bends.size() / 4);
+	bend_products.resize(bends.size() / 4);
+
+	preconditioner.resize(particles_size);
+
+	velocities.resize(particles_size);
+	rhs.resize(particles_size);
+	residual.resize(particles_size);
+	direction.resize(particles_size);
+	product.resize(particles_size);
+	preconditioned.resize(particles_size);
+
+	partials.resize((particles_size + grain - 1) / grain);
+}
+
+//==============================================================================
+
+uint ImplicitEulerSolver::GetIterations() const noexcept
+{
+	return iterations;
+}
+
+//==============================================================================
+
+void ImplicitEulerSolver::Linearize(const std::vector<Particle*> &particles, const Topology &topology,
+                                    const std::vector<DistanceConstraint> &distance_constraints,
+                                    const std::vector<BendConstraint> &bend_constraints,
+                                    float dt, float mass) noexcept
+{
+	const auto &edges = topology.GetEdges();
+
+	pool->ParallelFor(0, static_cast<uint>(edges.size()), grain, [&](uint first, uint last)
+	{
+		for (auto e = first; e < last; e++)
+		{
+			const auto &constraint = distance_constraints[e];
+			const auto stiffness = dt * dt / constraint.GetCompliance();
+
+			const auto L = particles[edges[e].ind1]->GetPosition() - particles[edges[e].ind2]->GetPosition();
+			const auto length = std::sqrt(glm::dot(L, L));
+			if (length < 1e-12f)
+			{
+				edge_hessians[e] = glm::mat3(0.0f);
+				edge_forces[e] = glm::vec3(0.0f);
+				continue;
+			}
+
+			const auto u = L / length;
+			const auto stretch = length - constraint.GetDistance();
+
+			const auto uu = glm::outerProduct(u, u);
+			const auto transverse = std::max(stretch / length, 0.0f);
+
+			edge_hessians[e] = stiffness * (uu + transverse * (glm::mat3(1.0f) - uu));
+			edge_forces[e] = (stiffness / dt) * stretch * u;
+		}
+	});
+
+	pool->ParallelFor(0, static_cast<uint>(bend_values.size()), grain, [&](uint first, uint last)
+	{
+		for (auto b = first; b < last; b++)
+		{
+			const auto &constraint = bend_constraints[b];
+			const auto ind = &bends[4 * b];
+			const auto gradients = &bend_gradients[4 * b];
+
+			float value;
+			glm::vec3 gradient[4];
+
+			if (!BendConstraint::GetGradient(particles[ind[0]]->GetPosition(), particles[ind[1]]->GetPosition(),
+			                                 particles[ind[2]]->GetPosition(), particles[ind[3]]->GetPosition(),
+			                                 constraint.GetAngle(), value, gradient))
+			{
+				std::fill(gradients, gradients + 4, glm::vec3(0.0f));
+				bend_values[b] = 0.0f;
+				continue;
+			}
+
+			const auto root = std::sqrt(1.0f / constraint.GetCompliance());
+
+			for (uint i = 0; i < 4; i++)
+			{
+				gradients[i] = dt * root * gradient[i];
+			}
+
+			bend_values[b] = root * value;
+		}
+	});
+
+	pool->ParallelFor(0, static_cast<uint>(particles.size()), grain, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			if (particles[i]->IsFixed())
+			{
+				preconditioner[i] = glm::mat3(0.0f);
+				continue;
+			}
+
+			auto block = glm::mat3(mass);
+			for (const auto e : topology.GetVertexEdges(i))
+			{
+				block += edge_hessians[e];
+			}
+
+			for (auto k = bend_offsets[i]; k < bend_offsets[i + 1]; k++)
+			{
+				const auto &g = bend_gradients[bend_roles[k]];
+				block += glm::outerProduct(g, g);
+			}
+
+			preconditioner[i] = glm::inverse(block);
+		}
+	});
+}
+
+//==============================================================================
+
+void ImplicitEulerSolver::Multiply(const Topology &topology, const std::vector<glm::vec3> &vector, float mass,
+                                   std::vector<glm::vec3> &result) noexcept
+{
+	pool->ParallelFor(0, static_cast<uint>(bend_products.size()), grain, [&](uint first, uint last)
+	{
+		for (auto b = first; b < last; b++)
+		{
+			const auto ind = &bends[4 * b];
+			const auto gradients = &bend_gradients[4 * b];
+
+			bend_products[b] = glm::dot(gradients[0], vector[ind[0]]) + glm::dot(gradients[1], vector[ind[1]]) +
+			                   glm::dot(gradients[2], vector[ind[2]]) + glm::dot(gradients[3], vector[ind[3]]);
+		}
+	});
+
+	const auto &edges = topology.GetEdges();
+
+	pool->ParallelFor(0, static_cast<uint>(vector.size()), grain, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			auto value = mass * vector[i];
+
+			for (const auto e : topology.GetVertexEdges(i))
+			{
+				const auto other = (edges[e].ind1 == i) ? edges[e].ind2 : edges[e].ind1;
+				value += edge_hessians[e] * (vector[i] - vector[other]);
+			}
+
+			for (auto k = bend_offsets[i]; k < bend_offsets[i + 1]; k++)
+			{
+				value += bend_products[bend_roles[k] / 4] * bend_gradients[bend_roles[k]];
+			}
+
+			result[i] = value;
+		}
+	});
+}
+
+//==============================================================================
+
+double ImplicitEulerSolver::Dot(const std::vector<glm::vec3> &a, const std::vector<glm::vec3> &b) noexcept
+{
+	// fixed blocks, so the sum does not depend on the thread count
+
+	const auto size = static_cast<uint>(a.size());
+
+	pool->ParallelFor(0, size, grain, [&](uint first, uint last)
+	{
+		for (auto block = first; block < last; block += grain)
+		{
+			auto sum = 0.0;
+			for (auto i = block; i < std::min(block + grain, last); i++)
+			{
+				sum += glm::dot(a[i], b[i]);
+			}
+
+			partials[block / grain] = sum;
+		}
+	});
+
+	auto sum = 0.0;
+	for (const auto partial : partials)
+	{
+		sum += partial;
+	}
+
+	return sum;
+}
+
+//==============================================================================
+
+void ImplicitEulerSolver::Project(const std::vector<Particle*> &particles, const Topology &topology,
+                                  const std::vector<DistanceConstraint> &distance_constraints,
+                                  const std::vector<BendConstraint> &bend_constraints,
+                                  float dt, float inv_mass) noexcept
+{
+	const auto size = static_cast<uint>(particles.size());
+	const auto mass = 1.0f / inv_mass;
+
+	Linearize(particles, topology, distance_constraints, bend_constraints, dt, mass);
+
+	// rhs = A v* - dt grad E, with fixed particles keeping the velocity of their predicted motion
+
+	pool->ParallelFor(0, size, grain, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto particle = particles[i];
+			velocities[i] = (particle->GetPosition() - particle->GetPreviousPosition()) / dt;
+		}
+	});
+
+	Multiply(topology, velocities, mass, rhs);
+
+	const auto &edges = topology.GetEdges();
+
+	pool->ParallelFor(0, size, grain, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			for (const auto e : topology.GetVertexEdges(i))
+			{
+				rhs[i] += (edges[e].ind1 == i) ? -edge_forces[e] : edge_forces[e];
+			}
+
+			for (auto k = bend_offsets[i]; k < bend_offsets[i + 1]; k++)
+			{
+				rhs[i] -= bend_values[bend_roles[k] / 4] * bend_gradients[bend_roles[k]];
+			}
+
+			if (!particles[i]->IsFixed())
+			{
+				velocities[i] = particles[i]->GetVelocity();
+			}
+		}
+	});
+
+	// preconditioned conjugate gradients, zero preconditioner rows keep the fixed particles
+
+	Multiply(topology, velocities, mass, product);
+
+	pool->ParallelFor(0, size, grain, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			residual[i] = rhs[i] - product[i];
+			preconditioned[i] = preconditioner[i] * residual[i];
+			direction[i] = preconditioned[i];
+		}
+	});
+
+	auto rz = Dot(residual, preconditioned);
+	const auto threshold = tolerance * tolerance * rz;
+
+	for (iterations = 0; (iterations < max_iterations) && (rz > threshold) && (rz > 0.0); iterations++)
+	{
+		Multiply(topology, direction, mass, product);
+
+		const auto curvature = Dot(direction, product);
+		if (curvature <= 0.0)
+		{
+			break;
+		}
+
+		const auto alpha = static_cast<float>(rz / curvature);
+
+		pool->ParallelFor(0, size, grain, [&](uint first, uint last)
+		{
+			for (auto i = first; i < last; i++)
+			{
+				velocities[i] += alpha * direction[i];
+				residual[i] -= alpha * product[i];
+				preconditioned[i] = preconditioner[i] * residual[i];
+			}
+		});
+
+		const auto previous = rz;
+		rz = Dot(residual, preconditioned);
+
+		const auto beta = static_cast<float>(rz / previous);
+
+		pool->ParallelFor(0, size, grain, [&](uint first, uint last)
+		{
+			for (auto i = first; i < last; i++)
+			{
+				direction[i] = preconditioned[i] + beta * direction[i];
+			}
+		});
+	}
+
+	pool->ParallelFor(0, size, grain, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto particle = particles[i];
+			particle->Move(particle->GetPreviousPosition() + dt * velocities[i] - particle->GetPosition());
+		}
+	});
+}
+
+//==============================================================================
+
+void ImplicitEulerSolver::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "bends", MemoryReport::GetBytes(bends) + MemoryReport::GetBytes(bend_offsets) +
+	                             MemoryReport::GetBytes(bend_roles));
+	report.Add(prefix + "hessian", MemoryReport::GetBytes(edge_hessians) + MemoryReport::GetBytes(edge_forces) +
+	                               MemoryReport::GetBytes(bend_gradients) + MemoryReport::GetBytes(bend_values) +
+	                               MemoryReport::GetBytes(bend_products) + MemoryReport::GetBytes(preconditioner));
+	report.Add(prefix + "vectors", MemoryReport::GetBytes(velocities) + MemoryReport::GetBytes(rhs) +
+	                               MemoryReport::GetBytes(residual) + MemoryReport::GetBytes(direction) +
+	                               MemoryReport::GetBytes(product) + MemoryReport::GetBytes(preconditioned) +
+	                               MemoryReport::GetBytes(partials));
+}
+
+//==============================================================================
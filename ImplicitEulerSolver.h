@@ -0,0 +1,89 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class BendConstraint;
+class DistanceConstraint;
+class MemoryReport;
+class Particle;
+class ThreadPool;
+class Topology;
+
+//==============================================================================
+
+// Linearly implicit Euler on the substep: the velocities solve
+//   (M + dt^2 H) v = M v* + dt^2 H v* - dt grad E
+// where v* is the velocity of the predicted positions and H the Hessian of
+// the distance and bend energies at them (stretch clamped under compression,
+// Gauss-Newton for bending). The system is never assembled: conjugate
+// gradients apply H as per edge 3x3 blocks and per bend gradient products,
+// gathered per particle, preconditioned by the inverse 3x3 diagonal blocks
+// and started from the velocity of the previous step.
+class ImplicitEulerSolver
+{
+public:
+	static constexpr uint max_iterations = 32;
+	static constexpr float tolerance = 1e-3f; // of the preconditioned residual, relative
+	static constexpr uint grain = 4096;
+
+private:
+	ThreadPool *pool;
+
+	uint iterations; // conjugate gradient steps of the last Project
+
+	std::vector<uint> bends;        // 4 particles per bend constraint
+	std::vector<uint> bend_offsets; // per particle, into bend_roles
+	std::vector<uint> bend_roles;   // 4 * bend + corner
+
+	std::vector<glm::mat3> edge_hessians; // dt^2 k (u u^T + max(0, C / l) (I - u u^T))
+	std::vector<glm::vec3> edge_forces;   // dt k C u, pulls ind1 towards ind2
+	std::vector<glm::vec3> bend_gradients; // dt sqrt(k) grad C, 4 per bend
+	std::vector<float> bend_values;        // sqrt(k) C
+	std::vector<float> bend_products;      // gradients . vector, per bend
+
+	std::vector<glm::mat3> preconditioner; // inverse diagonal blocks, 0 for fixed particles
+
+	std::vector<glm::vec3> velocities;
+	std::vector<glm::vec3> rhs;
+	std::vector<glm::vec3> residual;
+	std::vector<glm::vec3> direction;
+	std::vector<glm::vec3> product;
+	std::vector<glm::vec3> preconditioned;
+
+	std::vector<double> partials; // per grain block of a dot product
+
+private:
+	void Linearize(const std::vector<Particle*> &particles, const Topology &topology,
+	               const std::vector<DistanceConstraint> &distance_constraints,
+	               const std::vector<BendConstraint> &bend_constraints,
+	               float dt, float mass) noexcept;
+
+	void Multiply(const Topology &topology, const std::vector<glm::vec3> &vector, float mass,
+	              std::vector<glm::vec3> &result) noexcept;
+
+	double Dot(const std::vector<glm::vec3> &a, const std::vector<glm::vec3> &b) noexcept;
+
+public:
+	ImplicitEulerSolver(const Topology &topology, uint particles_size, ThreadPool &pool) noexcept;
+
+	uint GetIterations() const noexcept;
+
+	void Project(const std::vector<Particle*> &particles, const Topology &topology,
+	             const std::vector<DistanceConstraint> &distance_constraints,
+	             const std::vector<BendConstraint> &bend_constraints,
+	             float dt, float inv_mass) noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+};
+
+//==============================================================================
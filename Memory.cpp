@@ -0,0 +1,192 @@
+
+#include "Memory.h"
+
+#ifdef CLOTH_MEMORY
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#define ALLOCATION_SIZE(pointer) _msize(pointer)
+#else
+#include <malloc.h>
+#define ALLOCATION_SIZE(pointer) malloc_usable_size(pointer)
+#endif
+#endif
+
+//==============================================================================
+
+#ifdef CLOTH_MEMORY
+namespace
+{
+	std::atomic<size_t> live_bytes(0);
+	std::atomic<size_t> peak_bytes(0);
+	std::atomic<unsigned long long> allocations(0);
+	std::atomic<unsigned long long> allocated_bytes(0);
+
+	thread_local unsigned long long thread_allocations = 0;
+	thread_local unsigned long long thread_bytes = 0;
+
+	void *Allocate(size_t size) noexcept
+	{
+		const auto pointer = malloc(size ? size : 1);
+		if (!pointer)
+		{
+			return nullptr;
+		}
+
+		const auto bytes = ALLOCATION_SIZE(pointer);
+		const auto live = live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+		thread_allocations++;
+		thread_bytes += bytes;
+
+		auto peak = peak_bytes.load(std::memory_order_relaxed);
+		while ((live > peak) && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		{
+		}
+
+		return pointer;
+	}
+
+	void Free(void *pointer) noexcept
+	{
+		if (pointer)
+		{
+			live_bytes.fetch_sub(ALLOCATION_SIZE(pointer), std::memory_order_relaxed);
+			free(pointer);
+		}
+	}
+}
+
+//==============================================================================
+
+void *operator new(size_t size)
+{
+	if (const auto pointer = Allocate(size))
+	{
+		return pointer;
+	}
+
+	throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+	if (const auto pointer = Allocate(size))
+	{
+		return pointer;
+	}
+
+	throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	return Allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+	return Allocate(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+	Free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+	Free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+	Free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+	Free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept
+{
+	Free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept
+{
+	Free(pointer);
+}
+#endif
+
+//==============================================================================
+
+bool Memory::IsTracking() noexcept
+{
+#ifdef CLOTH_MEMORY
+	return true;
+#else
+	return false;
+#endif
+}
+
+//==============================================================================
+
+Memory::Counts Memory::GetCounts() noexcept
+{
+#ifdef CLOTH_MEMORY
+	return { allocations.load(std::memory_order_relaxed), allocated_bytes.load(std::memory_order_relaxed) };
+#else
+	return { 0, 0 };
+#endif
+}
+
+//==============================================================================
+
+Memory::Counts Memory::GetThreadCounts() noexcept
+{
+#ifdef CLOTH_MEMORY
+	return { thread_allocations, thread_bytes };
+#else
+	return { 0, 0 };
+#endif
+}
+
+//==============================================================================
+
+size_t Memory::GetLiveBytes() noexcept
+{
+#ifdef CLOTH_MEMORY
+	return live_bytes.load(std::memory_order_relaxed);
+#else
+	return 0;
+#endif
+}
+
+//==============================================================================
+
+size_t Memory::GetPeakBytes() noexcept
+{
+#ifdef CLOTH_MEMORY
+	return peak_bytes.load(std::memory_order_relaxed);
+#else
+	return 0;
+#endif
+}
+
+//==============================================================================
+
+void Memory::ResetPeak() noexcept
+{
+#ifdef CLOTH_MEMORY
+	peak_bytes.store(live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+#endif
+}
+
+//==============================================================================
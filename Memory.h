@@ -0,0 +1,50 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <cstddef>
+
+//==============================================================================
+
+class Memory
+{
+public:
+	struct Counts
+	{
+		unsigned long long allocations;
+		unsigned long long bytes;
+	};
+
+public:
+	static bool IsTracking() noexcept;
+
+	static Counts GetCounts() noexcept;       // all threads since startup
+	static Counts GetThreadCounts() noexcept; // calling thread only
+
+	static size_t GetLiveBytes() noexcept;
+	static size_t GetPeakBytes() noexcept;
+	static void ResetPeak() noexcept;
+};
+
+//==============================================================================
+
+class AllocationCounter
+{
+private:
+	Memory::Counts start;
+
+public:
+	AllocationCounter() noexcept :
+		start(Memory::GetCounts())
+	{
+	}
+
+	Memory::Counts Get() const noexcept
+	{
+		const auto counts = Memory::GetCounts();
+		return { counts.allocations - start.allocations, counts.bytes - start.bytes };
+	}
+};
+
+//==============================================================================
@@ -0,0 +1,75 @@
+
+#include "MemoryReport.h"
+
+#include <iomanip>
+
+//==============================================================================
+
+void MemoryReport::Add(const std::string &name, size_t bytes) noexcept
+{
+	entries.push_back({ name, bytes });
+}
+
+//==============================================================================
+
+const std::vector<MemoryReport::Entry> &MemoryReport::GetEntries() const noexcept
+{
+	return entries;
+}
+
+//==============================================================================
+
+size_t MemoryReport::GetTotal() const noexcept
+{
+	size_t total = 0;
+	for (const auto &entry : entries)
+	{
+		total += entry.bytes;
+	}
+
+	return total;
+}
+
+//==============================================================================
+
+size_t MemoryReport::GetTotal(const std::string &prefix) const noexcept
+{
+	size_t total = 0;
+	for (const auto &entry : entries)
+	{
+		if (entry.name.compare(0, prefix.size(), prefix) == 0)
+		{
+			total += entry.bytes;
+		}
+	}
+
+	return total;
+}
+
+//==============================================================================
+
+void MemoryReport::Clear() noexcept
+{
+	entries.clear();
+}
+
+//==============================================================================
+
+void MemoryReport::Dump(std::ostream &stream) const noexcept
+{
+	const auto flags = stream.flags();
+	stream << std::fixed << std::setprecision(2);
+
+	for (const auto &entry : entries)
+	{
+		stream << std::left << std::setw(40) << entry.name << std::right
+		       << std::setw(12) << entry.bytes / 1024.0 << " KB\n";
+	}
+
+	stream << std::left << std::setw(40) << "total" << std::right
+	       << std::setw(12) << GetTotal() / 1024.0 << " KB\n";
+
+	stream.flags(flags);
+}
+
+//==============================================================================
@@ -0,0 +1,79 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+//==============================================================================
+
+class MemoryReport
+{
+public:
+	struct Entry
+	{
+		std::string name;
+		size_t bytes;
+	};
+
+private:
+	std::vector<Entry> entries;
+
+public:
+	void Add(const std::string &name, size_t bytes) noexcept;
+
+	const std::vector<Entry> &GetEntries() const noexcept;
+	size_t GetTotal() const noexcept;
+	size_t GetTotal(const std::string &prefix) const noexcept;
+
+	void Clear() noexcept;
+	void Dump(std::ostream &stream) const noexcept;
+
+	template <typename T>
+	static size_t GetBytes(const std::vector<T> &values) noexcept
+	{
+		return values.capacity() * sizeof(T);
+	}
+
+	template <typename T>
+	static size_t GetBytes(const std::vector<std::vector<T>> &values) noexcept
+	{
+		auto bytes = values.capacity() * sizeof(std::vector<T>);
+		for (const auto &value : values)
+		{
+			bytes += GetBytes(value);
+		}
+
+		return bytes;
+	}
+
+	// node-based, so this is an estimate: one next pointer per node plus the bucket array
+	template <typename K, typename V>
+	static size_t GetBytes(const std::unordered_map<K, V> &values) noexcept
+	{
+		typedef typename std::unordered_map<K, V>::value_type Value;
+		return values.size() * (sizeof(void*) + sizeof(Value)) + values.bucket_count() * sizeof(void*);
+	}
+
+	template <typename K, typename V>
+	static size_t GetBytes(const std::vector<std::unordered_map<K, V>> &values) noexcept
+	{
+		auto bytes = values.capacity() * sizeof(std::unordered_map<K, V>);
+		for (const auto &value : values)
+		{
+			bytes += GetBytes(value);
+		}
+
+		return bytes;
+	}
+};
+
+//==============================================================================
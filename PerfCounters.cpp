@@ -0,0 +1,287 @@
+
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//==============================================================================
+
+#ifdef __linux__
+namespace
+{
+	struct Group
+	{
+		bool opened;
+		int leader;
+		int fds[PerfCounters::COUNT];
+		int slots[PerfCounters::COUNT]; // position in the group read, -1 if not opened
+		uint size;
+
+		Group() noexcept :
+			opened(false),
+			leader(-1),
+			size(0)
+		{
+			for (uint i = 0; i < PerfCounters::COUNT; i++)
+			{
+				fds[i] = -1;
+				slots[i] = -1;
+			}
+		}
+
+		~Group() noexcept
+		{
+			for (const auto fd : fds)
+			{
+				if (fd >= 0)
+				{
+					close(fd);
+				}
+			}
+		}
+
+		void Open() noexcept
+		{
+			opened = true;
+
+			const unsigned long long l1 = PERF_COUNT_HW_CACHE_L1D |
+			                              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+			const struct { uint type; unsigned long long config; } events[PerfCounters::COUNT] =
+			{
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+				{ PERF_TYPE_HW_CACHE, l1 },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+			};
+
+			for (uint i = 0; i < PerfCounters::COUNT; i++)
+			{
+				perf_event_attr attr;
+				memset(&attr, 0, sizeof(attr));
+
+				attr.size = sizeof(attr);
+				attr.type = events[i].type;
+				attr.config = events[i].config;
+				attr.disabled = (leader < 0) ? 1 : 0;
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP;
+
+				const auto fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0));
+				if (fd < 0)
+				{
+					continue;
+				}
+
+				if (leader < 0)
+				{
+					leader = fd;
+				}
+
+				fds[i] = fd;
+				slots[i] = static_cast<int>(size++);
+			}
+
+			if (leader >= 0)
+			{
+				ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+				ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+			}
+		}
+
+		bool Read(PerfCounters::Values &values) const noexcept
+		{
+			unsigned long long data[1 + PerfCounters::COUNT];
+			if (read(leader, data, sizeof(data)) < static_cast<ssize_t>(sizeof(unsigned long long)))
+			{
+				return false;
+			}
+
+			for (uint i = 0; i < PerfCounters::COUNT; i++)
+			{
+				const auto slot = slots[i];
+				values.valid[i] = (slot >= 0) && (static_cast<unsigned long long>(slot) < data[0]);
+				values.counts[i] = values.valid[i] ? data[1 + slot] : 0;
+			}
+
+			return true;
+		}
+	};
+
+	thread_local Group group;
+	thread_local PerfCounters::Scope *current_scope = nullptr;
+
+	Group &GetGroup() noexcept
+	{
+		if (!group.opened)
+		{
+			group.Open();
+		}
+
+		return group;
+	}
+}
+#endif
+
+//==============================================================================
+
+const char *PerfCounters::GetName(uint counter) noexcept
+{
+	static const char *names[COUNT] =
+	{
+		"cycles",
+		"instructions",
+		"l1_misses",
+		"llc_misses",
+		"branch_misses"
+	};
+
+	return (counter < COUNT) ? names[counter] : "";
+}
+
+//==============================================================================
+
+bool PerfCounters::IsAvailable() noexcept
+{
+#ifdef __linux__
+	return GetGroup().leader >= 0;
+#else
+	return false;
+#endif
+}
+
+//==============================================================================
+
+bool PerfCounters::Read(Values &values) noexcept
+{
+#ifdef __linux__
+	const auto &group = GetGroup();
+	return (group.leader >= 0) && group.Read(values);
+#else
+	(void)values;
+	return false;
+#endif
+}
+
+//==============================================================================
+
+PerfCounters::Scope *PerfCounters::GetScope() noexcept
+{
+#ifdef __linux__
+	return current_scope;
+#else
+	return nullptr;
+#endif
+}
+
+//==============================================================================
+
+void PerfCounters::Enter(Scope &scope) noexcept
+{
+#ifdef __linux__
+	for (auto &count : scope.counts)
+	{
+		count.store(0, std::memory_order_relaxed);
+	}
+
+	scope.parent = current_scope;
+	current_scope = &scope;
+#else
+	(void)scope;
+#endif
+}
+
+//==============================================================================
+
+void PerfCounters::Leave(Scope &scope) noexcept
+{
+#ifdef __linux__
+	// the thread of the parent did not see what others ran for this scope
+	current_scope = scope.parent;
+
+	if (scope.parent)
+	{
+		for (uint i = 0; i < COUNT; i++)
+		{
+			scope.parent->counts[i].fetch_add(scope.counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+	}
+#else
+	(void)scope;
+#endif
+}
+
+//==============================================================================
+
+PerfCounters::Task::Task(Scope *scope) noexcept :
+	scope(scope),
+	previous(GetScope()),
+	switched(scope != previous),
+	measured(false)
+{
+#ifdef __linux__
+	if (switched)
+	{
+		measured = Read(start);
+		current_scope = scope;
+	}
+#endif
+}
+
+//==============================================================================
+
+PerfCounters::Task::~Task() noexcept
+{
+#ifdef __linux__
+	if (!switched)
+	{
+		return;
+	}
+
+	current_scope = previous;
+
+	Values finish;
+	if (!measured || !Read(finish))
+	{
+		return;
+	}
+
+	for (uint i = 0; i < COUNT; i++)
+	{
+		if (start.valid[i] && finish.valid[i])
+		{
+			const auto delta = static_cast<long long>(finish.counts[i] - start.counts[i]);
+
+			if (scope)
+			{
+				scope->counts[i].fetch_add(delta, std::memory_order_relaxed);
+			}
+
+			if (previous)
+			{
+				previous->counts[i].fetch_sub(delta, std::memory_order_relaxed);
+			}
+		}
+	}
+#endif
+}
+
+//==============================================================================
+
+void PerfCounters::AttachThread() noexcept
+{
+#ifdef __linux__
+	GetGroup();
+#endif
+}
+
+//==============================================================================
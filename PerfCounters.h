@@ -0,0 +1,86 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <atomic>
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+//==============================================================================
+
+// Counters are opened per thread and Read only reads the calling thread.
+// A pool job that runs outside the scope that queued it is measured by the
+// thread that runs it, added to that scope and taken out of the scope the
+// thread was in, so a phase counts the work it hands to the pool and not
+// the work of phases running at the same time.
+class PerfCounters
+{
+public:
+	enum Counter : uint
+	{
+		CYCLES,
+		INSTRUCTIONS,
+		L1_MISSES,
+		LLC_MISSES,
+		BRANCH_MISSES,
+		COUNT
+	};
+
+	struct Values
+	{
+		unsigned long long counts[COUNT];
+		bool valid[COUNT];
+	};
+
+	// counts run for a scope by other threads, less those it ran for others
+	struct Scope
+	{
+		std::atomic<long long> counts[COUNT];
+		Scope *parent;
+	};
+
+	// charges a pool job to the scope that queued it, for as long as it lives
+	class Task
+	{
+	private:
+		Scope *scope;
+		Scope *previous;
+		Values start;
+		bool switched;
+		bool measured;
+
+	public:
+		explicit Task(Scope *scope) noexcept;
+		Task(const Task &) = delete;
+		~Task() noexcept;
+	};
+
+public:
+	static const char *GetName(uint counter) noexcept;
+
+	static bool IsAvailable() noexcept;
+	static bool Read(Values &values) noexcept;
+
+	// the innermost scope of the calling thread, nullptr outside any
+	static Scope *GetScope() noexcept;
+	static void Enter(Scope &scope) noexcept;
+	static void Leave(Scope &scope) noexcept;
+
+	// opens the counters of the calling thread ahead of its first Read
+	static void AttachThread() noexcept;
+};
+
+//==============================================================================
+
+#ifdef CLOTH_PERF
+#define PERF_THREAD() PerfCounters::AttachThread()
+#define PERF_TASK(scope) const PerfCounters::Task perf_task(scope)
+#else
+#define PERF_THREAD() ((void)0)
+#define PERF_TASK(scope) ((void)0)
+#endif
+
+//==============================================================================
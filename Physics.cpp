@@ -1,15 +1,108 @@
 
 #include "Physics.h"
 
+#include "BlockDescentSolver.h"
 #include "Cloth.h"
+#include "Collider.h"
+#include "Memory.h"
+#include "MemoryReport.h"
 #include "Particle.h"
+#include "ThreadPool.h"
+
+//==============================================================================
+
+Cloth *Physics::FindCloth(uint handle) const noexcept
+{
+	if (handle < cloths.size())
+	{
+		return cloths[handle];
+	}
+
+	return nullptr;
+}
+
+//==============================================================================
+
+void Physics::Step(Cloth *cloth, SolverStats &stats) noexcept
+{
+	{
+		PROFILE_SCOPE(profiler, "physics.forces");
+		cloth->ClearForces();
+		cloth->AddGravity(gravity);
+	}
+
+	const auto iterations = 5;
+	const auto dt = time_step / iterations;
+
+	for (uint i = 0; i < iterations; i++)
+	{
+		{
+			PROFILE_SCOPE(profiler, "physics.predict");
+			cloth->PredictPosition(dt);
+		}
+
+		{
+			PROFILE_SCOPE(profiler, "physics.distance");
+			cloth->ProjectDistanceConstraints(dt);
+		}
+
+		{
+			PROFILE_SCOPE(profiler, "physics.bend");
+			cloth->ProjectBendConstraints(dt);
+		}
+
+		{
+			PROFILE_SCOPE(profiler, "physics.self_collision");
+			cloth->ProjectSelfCollision();
+		}
+
+		{
+			PROFILE_SCOPE(profiler, "physics.colliders");
+			cloth->ProjectColliders(colliders);
+		}
+
+		{
+			PROFILE_SCOPE(profiler, "physics.collisions");
+			cloth->SolveCollisions(dt);
+		}
+
+		{
+			PROFILE_SCOPE(profiler, "physics.integrate");
+			cloth->UpdateVelocity(dt, 0.999f);
+			cloth->UpdatePosition();
+		}
+	}
+
+	{
+		PROFILE_SCOPE(profiler, "physics.normals");
+		cloth->CalculateNormals();
+	}
+
+	{
+		PROFILE_SCOPE(profiler, "physics.bvh");
+		cloth->UpdateBVH();
+	}
+
+	if (telemetry)
+	{
+		PROFILE_SCOPE(profiler, "physics.telemetry");
+		cloth->CalculateStats(stats);
+	}
+}
 
 //==============================================================================
 
 Physics::Physics() noexcept :
 	time_step(0.001f),
 	gravity(0.0f, -9.8f, 0.0f),
-	cloth(nullptr)
+	self_collision(true),
+	continuous_collision(false),
+	solver(Solver::XPBD),
+	block_descent_iterations(BlockDescentSolver::default_iterations),
+	telemetry(false),
+	frame(0),
+	telemetry_file(nullptr),
+	frame_allocations{ 0, 0 }
 {
 }
 
@@ -17,7 +110,20 @@ Physics::Physics() noexcept :
 
 Physics::~Physics() noexcept
 {
-	delete cloth;
+	for (const auto cloth : cloths)
+	{
+		delete cloth;
+	}
+
+	for (const auto collider : colliders)
+	{
+		delete collider;
+	}
+
+	if (telemetry_file)
+	{
+		fclose(telemetry_file);
+	}
 }
 
 //==============================================================================
@@ -29,96 +135,453 @@ void Physics::SetGravity(const glm::vec3 &value) noexcept
 
 //==============================================================================
 
-void Physics::GetCloth(std::vector<float> &vertices,
+void Physics::SetTimeStep(float value) noexcept
+{
+	time_step = value;
+}
+
+//==============================================================================
+
+void Physics::SetSelfCollision(bool value) noexcept
+{
+	self_collision = value;
+
+	for (const auto cloth : cloths)
+	{
+		if (cloth)
+		{
+			cloth->SetSelfCollision(value);
+		}
+	}
+}
+
+//==============================================================================
+
+void Physics::SetContinuousCollision(bool value) noexcept
+{
+	continuous_collision = value;
+
+	for (const auto cloth : cloths)
+	{
+		if (cloth)
+		{
+			cloth->SetContinuousCollision(value);
+		}
+	}
+}
+
+//==============================================================================
+
+// cloths that cannot use the requested solver keep the default one
+void Physics::SetSolver(Solver value) noexcept
+{
+	solver = value;
+
+	for (const auto cloth : cloths)
+	{
+		if (cloth)
+		{
+			cloth->SetSolver(value);
+		}
+	}
+}
+
+//==============================================================================
+
+void Physics::SetBlockDescentIterations(uint value) noexcept
+{
+	block_descent_iterations = value;
+
+	for (const auto cloth : cloths)
+	{
+		if (cloth)
+		{
+			cloth->SetBlockDescentIterations(value);
+		}
+	}
+}
+
+//==============================================================================
+
+void Physics::SetThreads(uint count, bool pinned) noexcept
+{
+	pool.Start(count, pinned);
+}
+
+//==============================================================================
+
+ThreadPool &Physics::GetThreadPool() noexcept
+{
+	return pool;
+}
+
+//==============================================================================
+
+void Physics::GetCloth(uint cloth,
+	                   std::vector<float> &vertices,
 	                   std::vector<float> &normals,
 	                   std::vector<float> &uvs,
 	                   std::vector<uint>  &indices) const noexcept
 {
-	vertices = cloth->GetVertices();
-	normals  = cloth->GetNormals();
-	uvs      = cloth->GetUVs();
-	indices  = cloth->GetIndices();
+	const auto object = FindCloth(cloth);
+	if (!object)
+	{
+		return;
+	}
+
+	object->GetVertices(vertices);
+	object->GetNormals(normals);
+	object->GetUVs(uvs);
+	indices = object->GetIndices();
+}
+
+//==============================================================================
+
+uint Physics::InsertCloth(Cloth *cloth, size_t live) noexcept
+{
+	cloth->SetSelfCollision(self_collision);
+	cloth->SetContinuousCollision(continuous_collision);
+	cloth->SetBlockDescentIterations(block_descent_iterations);
+	cloth->SetSolver(solver);
+
+	cloths.push_back(cloth);
+	solver_stats.emplace_back();
+	construction_peaks.push_back(Memory::GetPeakBytes() - live);
+	return static_cast<uint>(cloths.size() - 1);
+}
+
+//==============================================================================
+
+uint Physics::AddCloth(float width, float height, float step)
+{
+	const auto live = Memory::GetLiveBytes();
+	Memory::ResetPeak();
+
+	return InsertCloth(new Cloth(width, height, step, pool), live);
 }
 
 //==============================================================================
 
-void Physics::AddCloth(float width, float height, float step)
+uint Physics::AddCloth(const std::vector<float> &vertices, const std::vector<uint> &indices)
 {
-	if (cloth)
+	const auto live = Memory::GetLiveBytes();
+	Memory::ResetPeak();
+
+	return InsertCloth(new Cloth(vertices, indices, pool), live);
+}
+
+//==============================================================================
+
+void Physics::RemoveCloth(uint cloth) noexcept
+{
+	if (cloth < cloths.size())
 	{
-		delete cloth;
+		delete cloths[cloth];
+		cloths[cloth] = nullptr;
+		solver_stats[cloth] = SolverStats();
 	}
+}
 
-	cloth = new Cloth(width, height, step);
+//==============================================================================
+
+uint Physics::AddCollider(Collider *collider) noexcept
+{
+	colliders.push_back(collider);
+	return static_cast<uint>(colliders.size() - 1);
 }
 
 //==============================================================================
 
-bool Physics::Raycast(const Ray &ray, uint &point, glm::vec3 &P) const noexcept
+void Physics::RemoveCollider(uint handle) noexcept
 {
-	if (cloth)
+	if (handle < colliders.size())
 	{
-		return cloth->Raycast(ray, point, P);
+		delete colliders[handle];
+		colliders[handle] = nullptr;
 	}
+}
 
-	return false;
+//==============================================================================
+
+Collider *Physics::GetCollider(uint handle) const noexcept
+{
+	if (handle < colliders.size())
+	{
+		return colliders[handle];
+	}
+
+	return nullptr;
 }
 
 //==============================================================================
 
-void Physics::FixClothPoint(uint index) const noexcept
+void Physics::SetColliderTransform(uint handle, const glm::mat4 &transform) noexcept
 {
-	if (cloth)
+	if (const auto collider = GetCollider(handle))
 	{
-		cloth->FixParticle(index);
+		collider->SetTransform(transform);
 	}
 }
 
 //==============================================================================
 
-void Physics::FreeClothPoint(uint index) const noexcept
+bool Physics::Raycast(const Ray &ray, uint &cloth, uint &point, glm::vec3 &P) const noexcept
 {
-	if (cloth)
+	auto find = false;
+	auto distance = 0.0f;
+
+	for (uint i = 0; i < cloths.size(); i++)
 	{
-		cloth->FreeParticle(index);
+		uint index;
+		glm::vec3 Q;
+		if (cloths[i] && cloths[i]->Raycast(ray, index, Q))
+		{
+			const auto d = glm::length(Q - ray.GetOrigin());
+			if (!find || (d < distance))
+			{
+				find = true;
+				distance = d;
+
+				cloth = i;
+				point = index;
+				P = Q;
+			}
+		}
 	}
+
+	return find;
 }
 
 //==============================================================================
 
-void Physics::MoveClothPoint(uint index, const glm::vec3 &translation) noexcept
+bool Physics::Raycast(uint cloth, const Ray &ray, uint &point, glm::vec3 &P) const noexcept
 {
-	if (cloth)
+	if (const auto object = FindCloth(cloth))
 	{
-		cloth->MoveFixedParticle(index, translation);
+		return object->Raycast(ray, point, P);
 	}
+
+	return false;
 }
 
 //==============================================================================
 
-void Physics::Simulate() noexcept
+void Physics::Raycast(uint cloth, const std::vector<Ray> &rays, std::vector<RayHit> &hits) noexcept
 {
-	if (!cloth)
+	if (const auto object = FindCloth(cloth))
 	{
+		object->Raycast(rays, hits);
 		return;
 	}
 
-	cloth->ClearForces();
-	cloth->AddGravity(gravity);
+	hits.assign(rays.size(), RayHit());
+}
 
-	const auto iterations = 5;
-	const auto dt = time_step / iterations;
-	for (uint i = 0; i < iterations; i++)
+//==============================================================================
+
+void Physics::FixClothPoint(uint cloth, uint index) const noexcept
+{
+	if (const auto object = FindCloth(cloth))
+	{
+		object->FixParticle(index);
+	}
+}
+
+//==============================================================================
+
+void Physics::FreeClothPoint(uint cloth, uint index) const noexcept
+{
+	if (const auto object = FindCloth(cloth))
+	{
+		object->FreeParticle(index);
+	}
+}
+
+//==============================================================================
+
+void Physics::MoveClothPoint(uint cloth, uint index, const glm::vec3 &translation) noexcept
+{
+	if (const auto object = FindCloth(cloth))
+	{
+		object->MoveFixedParticle(index, translation);
+	}
+}
+
+//==============================================================================
+
+Profiler &Physics::GetProfiler() noexcept
+{
+	return profiler;
+}
+
+//==============================================================================
+
+bool Physics::GetTimerStats(const std::string &name, Profiler::Stats &stats) const noexcept
+{
+	return profiler.GetStats(name, stats);
+}
+
+//==============================================================================
+
+void Physics::SetProfileLogInterval(float seconds) noexcept
+{
+	profiler.SetLogInterval(seconds);
+}
+
+//==============================================================================
+
+bool Physics::SetProfileLogOutput(const std::string &path) noexcept
+{
+	return profiler.SetLogOutput(path);
+}
+
+//==============================================================================
+
+void Physics::SetTelemetry(bool value) noexcept
+{
+	telemetry = value;
+}
+
+//==============================================================================
+
+bool Physics::SetTelemetryOutput(const std::string &path) noexcept
+{
+	if (telemetry_file)
+	{
+		fclose(telemetry_file);
+		telemetry_file = nullptr;
+	}
+
+	if (path.empty())
+	{
+		return true;
+	}
+
+	telemetry_file = fopen(path.c_str(), "w");
+	if (!telemetry_file)
+	{
+		return false;
+	}
+
+	fprintf(telemetry_file, "frame,cloth,iterations,max_stretch,rms_stretch,max_bend_error,rms_bend_error,kinetic_energy,fallback\n");
+
+	telemetry = true;
+	return true;
+}
+
+//==============================================================================
+
+bool Physics::GetSolverStats(uint cloth, SolverStats &stats) const noexcept
+{
+	if (!telemetry || !FindCloth(cloth))
+	{
+		return false;
+	}
+
+	stats = solver_stats[cloth];
+	return true;
+}
+
+//==============================================================================
+
+void Physics::GetMemoryUsage(MemoryReport &report) const noexcept
+{
+	for (uint i = 0; i < cloths.size(); i++)
+	{
+		if (cloths[i])
+		{
+			cloths[i]->GetMemoryUsage(report, "cloth" + std::to_string(i) + ".");
+		}
+	}
+
+	for (uint i = 0; i < colliders.size(); i++)
+	{
+		if (colliders[i])
+		{
+			colliders[i]->GetMemoryUsage(report, "collider" + std::to_string(i) + ".");
+		}
+	}
+}
+
+//==============================================================================
+
+size_t Physics::GetConstructionPeak(uint cloth) const noexcept
+{
+	return FindCloth(cloth) ? construction_peaks[cloth] : 0;
+}
+
+//==============================================================================
+
+const Memory::Counts &Physics::GetFrameAllocations() const noexcept
+{
+	return frame_allocations;
+}
+
+//==============================================================================
+
+void Physics::WriteTelemetry() noexcept
+{
+	for (uint i = 0; i < cloths.size(); i++)
 	{
-		cloth->PredictPosition(dt);
+		if (!cloths[i])
+		{
+			continue;
+		}
+
+		const auto &stats = solver_stats[i];
 
-		cloth->ProjectConstraints(dt);
+		// left empty for the solvers that do not iterate
+		char iterations[16] = "";
+		if (stats.iterative)
+		{
+			snprintf(iterations, sizeof(iterations), "%u", stats.iterations);
+		}
 
-		cloth->UpdateVelocity(dt, 0.999f);
-		cloth->UpdatePosition();
+		fprintf(telemetry_file, "%u,%u,%s,%.9g,%.9g,%.9g,%.9g,%.9g,%u\n", frame, i, iterations,
+		        stats.max_stretch, stats.rms_stretch, stats.max_bend_error, stats.rms_bend_error, stats.kinetic_energy,
+		        stats.fallback ? 1u : 0u);
 	}
+}
+
+//==============================================================================
+
+void Physics::Simulate() noexcept
+{
+	const AllocationCounter allocations;
+
+	{
+		PROFILE_SCOPE(profiler, "physics.simulate");
+
+		const auto size = static_cast<uint>(cloths.size());
+
+		pool.ParallelFor(0, size, 1, [this](uint first, uint last)
+		{
+			for (auto i = first; i < last; i++)
+			{
+				if (cloths[i])
+				{
+					Step(cloths[i], solver_stats[i]);
+				}
+			}
+		});
+	}
+
+	if (telemetry_file)
+	{
+		WriteTelemetry();
+	}
+
+	frame++;
+
+#if defined(CLOTH_PERF) || defined(CLOTH_MEMORY)
+	profiler.Commit();
+#endif
+
+	frame_allocations = allocations.Get();
 
-	cloth->CalculateNormals();
+#ifdef CLOTH_PROFILE
+	profiler.Update();
+#endif
 }
 
 //==============================================================================
@@ -3,15 +3,25 @@
 
 //==============================================================================
 
+#include <cstdio>
+#include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+#include "Memory.h"
+#include "Profiler.h"
 #include "Ray.h"
+#include "Solver.h"
+#include "SolverStats.h"
+#include "ThreadPool.h"
+#include "TriangleBatch.h"
 
 //==============================================================================
 
 class Cloth;
+class Collider;
+class MemoryReport;
 
 typedef unsigned int uint;
 
@@ -20,28 +30,83 @@ typedef unsigned int uint;
 class Physics
 {
 private:
+	ThreadPool pool; // shared by every cloth and stage
+
 	float time_step;
 	glm::vec3 gravity;
-	Cloth *cloth;
+	bool self_collision;
+	bool continuous_collision;
+	Solver solver;
+	uint block_descent_iterations;
+	std::vector<Cloth*> cloths;
+	std::vector<Collider*> colliders;
+	Profiler profiler;
+
+	bool telemetry;
+	uint frame;
+	std::vector<SolverStats> solver_stats;
+	std::vector<size_t> construction_peaks;
+	FILE *telemetry_file;
+	Memory::Counts frame_allocations;
+
+private:
+	Cloth *FindCloth(uint handle) const noexcept;
+
+	void Step(Cloth *cloth, SolverStats &stats) noexcept;
+	void WriteTelemetry() noexcept;
+
+	uint InsertCloth(Cloth *cloth, size_t live) noexcept;
 
 public:
 	Physics() noexcept;
 	~Physics() noexcept;
 
 	void SetGravity(const glm::vec3 &value) noexcept;
-
-	void GetCloth(std::vector<float> &vertices,
+	void SetTimeStep(float value) noexcept;
+	void SetSelfCollision(bool value) noexcept;
+	void SetContinuousCollision(bool value) noexcept;
+	void SetSolver(Solver value) noexcept;
+	void SetBlockDescentIterations(uint value) noexcept;
+
+	// 0 threads for one per hardware thread
+	void SetThreads(uint count, bool pinned = false) noexcept;
+	ThreadPool &GetThreadPool() noexcept;
+
+	void GetCloth(uint cloth,
+		      std::vector<float> &vertices,
 		      std::vector<float> &normals,
 		      std::vector<float> &uvs,
 		      std::vector<uint>  &indices) const noexcept;
 
-	void AddCloth(float width, float height, float step);
+	uint AddCloth(float width, float height, float step);
+	uint AddCloth(const std::vector<float> &vertices, const std::vector<uint> &indices);
+	void RemoveCloth(uint cloth) noexcept;
+
+	uint AddCollider(Collider *collider) noexcept;
+	void RemoveCollider(uint handle) noexcept;
+	Collider *GetCollider(uint handle) const noexcept;
+	void SetColliderTransform(uint handle, const glm::mat4 &transform) noexcept;
+
+	bool Raycast(const Ray &ray, uint &cloth, uint &point, glm::vec3 &P) const noexcept;
+	bool Raycast(uint cloth, const Ray &ray, uint &point, glm::vec3 &P) const noexcept;
+	void Raycast(uint cloth, const std::vector<Ray> &rays, std::vector<RayHit> &hits) noexcept;
+
+	void FixClothPoint  (uint cloth, uint index) const noexcept;
+	void FreeClothPoint (uint cloth, uint index) const noexcept;
+	void MoveClothPoint (uint cloth, uint index, const glm::vec3 &translation) noexcept;
+
+	Profiler &GetProfiler() noexcept;
+	bool GetTimerStats(const std::string &name, Profiler::Stats &stats) const noexcept;
+	void SetProfileLogInterval(float seconds) noexcept;
+	bool SetProfileLogOutput(const std::string &path) noexcept;
 
-	bool Raycast(const Ray &ray, uint &point, glm::vec3 &P) const noexcept;
+	void SetTelemetry(bool value) noexcept;
+	bool SetTelemetryOutput(const std::string &path) noexcept;
+	bool GetSolverStats(uint cloth, SolverStats &stats) const noexcept;
 
-	void FixClothPoint  (uint index) const noexcept;
-	void FreeClothPoint (uint index) const noexcept;
-	void MoveClothPoint (uint index, const glm::vec3 &translation) noexcept;
+	void GetMemoryUsage(MemoryReport &report) const noexcept;
+	size_t GetConstructionPeak(uint cloth) const noexcept;
+	const Memory::Counts &GetFrameAllocations() const noexcept;
 
 	void Simulate() noexcept;
 };
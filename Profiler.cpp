@@ -0,0 +1,340 @@
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+//==============================================================================
+
+namespace
+{
+	std::atomic<uint> next_id(1);
+
+	// the buffer of the calling thread in the profiler it last recorded to
+	thread_local uint thread_profiler = 0;
+	thread_local void *thread_buffer = nullptr;
+}
+
+//==============================================================================
+
+Profiler::Profiler(uint window) noexcept :
+	id(next_id++),
+	window(std::max(window, 1u)),
+	log_interval(0.0f),
+	last_log(std::chrono::steady_clock::now())
+{
+}
+
+//==============================================================================
+
+void Profiler::SetWindow(uint value) noexcept
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Merge();
+	window = std::max(value, 1u);
+	timers.clear();
+}
+
+//==============================================================================
+
+void Profiler::SetLogInterval(float seconds) noexcept
+{
+	log_interval = seconds;
+	last_log = std::chrono::steady_clock::now();
+}
+
+//==============================================================================
+
+bool Profiler::SetLogOutput(const std::string &path) noexcept
+{
+	if (log_file.is_open())
+	{
+		log_file.close();
+	}
+
+	if (path.empty())
+	{
+		return true;
+	}
+
+	log_file.open(path);
+	return log_file.is_open();
+}
+
+//==============================================================================
+
+Profiler::Timer &Profiler::FindTimer(const char *name, const char *unit) const noexcept
+{
+	auto timer = timers.find(name);
+	if (timer == timers.end())
+	{
+		timer = timers.emplace(name, Timer()).first;
+		timer->second.samples.reserve(window);
+		timer->second.next = 0;
+		timer->second.unit = unit;
+	}
+
+	return timer->second;
+}
+
+//==============================================================================
+
+void Profiler::Push(Timer &timer, double value) const noexcept
+{
+	if (timer.samples.size() < window)
+	{
+		timer.samples.push_back(static_cast<float>(value));
+		return;
+	}
+
+	timer.samples[timer.next] = static_cast<float>(value);
+	timer.next = (timer.next + 1) % window;
+}
+
+//==============================================================================
+
+Profiler::Buffer &Profiler::GetBuffer() noexcept
+{
+	if ((thread_profiler == id) && thread_buffer)
+	{
+		return *static_cast<Buffer*>(thread_buffer);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const auto thread = std::this_thread::get_id();
+
+	auto found = std::find_if(buffers.begin(), buffers.end(), [&](const std::unique_ptr<Buffer> &buffer)
+	{
+		return buffer->thread == thread;
+	});
+
+	if (found == buffers.end())
+	{
+		buffers.emplace_back(new Buffer());
+		buffers.back()->thread = thread;
+		buffers.back()->head.store(0, std::memory_order_relaxed);
+		buffers.back()->tail.store(0, std::memory_order_relaxed);
+		found = buffers.end() - 1;
+	}
+
+	thread_profiler = id;
+	thread_buffer = found->get();
+
+	return **found;
+}
+
+//==============================================================================
+
+void Profiler::Add(const Entry &entry) noexcept
+{
+	auto &buffer = GetBuffer();
+
+	const auto tail = buffer.tail.load(std::memory_order_relaxed);
+	if (tail - buffer.head.load(std::memory_order_acquire) == buffer_size)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Merge(buffer);
+	}
+
+	buffer.entries[tail % buffer_size] = entry;
+	buffer.tail.store(tail + 1, std::memory_order_release);
+}
+
+//==============================================================================
+
+void Profiler::Merge(Buffer &buffer) const noexcept
+{
+	const auto head = buffer.head.load(std::memory_order_relaxed);
+	const auto tail = buffer.tail.load(std::memory_order_acquire);
+
+	for (auto i = head; i != tail; i++)
+	{
+		const auto &entry = buffer.entries[i % buffer_size];
+
+		if (!entry.counter)
+		{
+			Push(FindTimer(entry.name, entry.unit), entry.value);
+			continue;
+		}
+
+		auto sum = sums.find(std::make_pair(entry.name, entry.counter));
+		if (sum == sums.end())
+		{
+			const auto key = std::make_pair(entry.name, entry.counter);
+			sum = sums.emplace(key, Sum{ std::string(entry.name) + "." + entry.counter, entry.unit, 0.0, false }).first;
+		}
+
+		sum->second.value += entry.value;
+		sum->second.dirty = true;
+	}
+
+	buffer.head.store(tail, std::memory_order_release);
+}
+
+//==============================================================================
+
+void Profiler::Merge() const noexcept
+{
+	for (const auto &buffer : buffers)
+	{
+		Merge(*buffer);
+	}
+}
+
+//==============================================================================
+
+void Profiler::Record(const char *name, double microseconds) noexcept
+{
+	Add({ name, nullptr, "us", microseconds });
+}
+
+//==============================================================================
+
+void Profiler::Accumulate(const char *name, const char *counter, const char *unit, double value) noexcept
+{
+	Add({ name, counter, unit, value });
+}
+
+//==============================================================================
+
+void Profiler::Commit() noexcept
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Merge();
+
+	for (auto &entry : sums)
+	{
+		auto &sum = entry.second;
+		if (sum.dirty)
+		{
+			Push(FindTimer(sum.name.c_str(), sum.unit), sum.value);
+
+			sum.value = 0.0;
+			sum.dirty = false;
+		}
+	}
+}
+
+//==============================================================================
+
+void Profiler::Clear() noexcept
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Merge();
+	timers.clear();
+	sums.clear();
+}
+
+//==============================================================================
+
+std::vector<std::string> Profiler::GetNames() const noexcept
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Merge();
+
+	std::vector<std::string> names;
+	names.reserve(timers.size());
+
+	for (const auto &timer : timers)
+	{
+		names.push_back(timer.first);
+	}
+
+	return names;
+}
+
+//==============================================================================
+
+bool Profiler::GetStats(const std::string &name, Stats &stats) const noexcept
+{
+	std::vector<float> samples;
+	const char *unit;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Merge();
+
+		const auto timer = timers.find(name);
+		if ((timer == timers.end()) || timer->second.samples.empty())
+		{
+			return false;
+		}
+
+		samples = timer->second.samples;
+		unit = timer->second.unit;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	auto sum = 0.0;
+	for (const auto sample : samples)
+	{
+		sum += sample;
+	}
+
+	const auto count = samples.size();
+
+	stats.count = static_cast<uint>(count);
+	stats.unit = unit;
+	stats.mean = sum / count;
+	stats.p50 = samples[(count - 1) / 2];
+	stats.p99 = samples[std::min(count - 1, (99 * count) / 100)];
+	stats.max = samples.back();
+
+	return true;
+}
+
+//==============================================================================
+
+void Profiler::Dump(std::ostream &stream) const noexcept
+{
+	const auto flags = stream.flags();
+	stream << std::fixed << std::setprecision(1);
+
+	for (const auto &name : GetNames())
+	{
+		Stats stats;
+		if (GetStats(name, stats))
+		{
+			stream << std::left << std::setw(24) << name << std::right
+			       << " mean " << std::setw(9) << stats.mean
+			       << " p50 "  << std::setw(9) << stats.p50
+			       << " p99 "  << std::setw(9) << stats.p99
+			       << " max "  << std::setw(9) << stats.max << " " << stats.unit << "\n";
+		}
+	}
+
+	stream.flags(flags);
+}
+
+//==============================================================================
+
+void Profiler::Update() noexcept
+{
+	if (log_interval <= 0.0f)
+	{
+		return;
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+	if (std::chrono::duration<float>(now - last_log).count() < log_interval)
+	{
+		return;
+	}
+
+	last_log = now;
+
+	auto &stream = log_file.is_open() ? static_cast<std::ostream&>(log_file) : std::cout;
+
+	Dump(stream);
+	stream << std::endl;
+}
+
+//==============================================================================
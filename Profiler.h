@@ -0,0 +1,244 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Memory.h"
+#include "PerfCounters.h"
+#include "Trace.h"
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+//==============================================================================
+
+// Scopes record into a buffer of their own thread; the buffers are merged
+// into the statistics under the mutex when they are queried or committed,
+// or by a thread whose buffer is full.
+class Profiler
+{
+public:
+	static constexpr uint buffer_size = 4096;
+
+	struct Stats
+	{
+		uint count;
+		const char *unit; // "us" for timers, "count" or "bytes" for accumulated series
+		double mean;
+		double p50;
+		double p99;
+		double max;
+	};
+
+private:
+	struct Timer
+	{
+		std::vector<float> samples;
+		uint next;
+		const char *unit;
+	};
+
+	struct Sum
+	{
+		std::string name;
+		const char *unit;
+		double value;
+		bool dirty;
+	};
+
+	struct Entry
+	{
+		const char *name;
+		const char *counter; // nullptr for a timer sample
+		const char *unit;
+		double value;
+	};
+
+	// written by its thread only; tail is published after the entry
+	struct Buffer
+	{
+		std::thread::id thread;
+		Entry entries[buffer_size];
+		std::atomic<uint> head;
+		std::atomic<uint> tail;
+	};
+
+private:
+	uint id;
+	uint window;
+	float log_interval;
+	std::chrono::steady_clock::time_point last_log;
+	std::ofstream log_file; // standard output when not open
+
+	// transparent lookup and persistent entries keep steady-state merging allocation-free
+	mutable std::map<std::string, Timer, std::less<>> timers;
+	mutable std::map<std::pair<const char*, const char*>, Sum> sums;
+	std::vector<std::unique_ptr<Buffer>> buffers;
+	mutable std::mutex mutex;
+
+private:
+	Timer &FindTimer(const char *name, const char *unit) const noexcept;
+	void Push(Timer &timer, double value) const noexcept;
+
+	Buffer &GetBuffer() noexcept;
+	void Add(const Entry &entry) noexcept;
+	void Merge(Buffer &buffer) const noexcept;
+	void Merge() const noexcept;
+
+public:
+	explicit Profiler(uint window = 256) noexcept;
+	Profiler(const Profiler &) = delete;
+
+	void SetWindow(uint value) noexcept;
+	void SetLogInterval(float seconds) noexcept;
+	bool SetLogOutput(const std::string &path) noexcept; // empty for standard output
+
+	void Record(const char *name, double microseconds) noexcept;
+	void Accumulate(const char *name, const char *counter, const char *unit, double value) noexcept;
+	void Commit() noexcept;
+	void Clear() noexcept;
+
+	std::vector<std::string> GetNames() const noexcept;
+	bool GetStats(const std::string &name, Stats &stats) const noexcept;
+
+	void Dump(std::ostream &stream) const noexcept;
+	void Update() noexcept;
+};
+
+//==============================================================================
+
+class ScopedTimer
+{
+private:
+	Profiler &profiler;
+	const char *name;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	ScopedTimer(Profiler &profiler, const char *name) noexcept :
+		profiler(profiler),
+		name(name),
+		start(std::chrono::steady_clock::now())
+	{
+	}
+
+	ScopedTimer(const ScopedTimer &) = delete;
+
+	~ScopedTimer() noexcept
+	{
+		const auto finish = std::chrono::steady_clock::now();
+		profiler.Record(name, std::chrono::duration<double, std::micro>(finish - start).count());
+	}
+};
+
+//==============================================================================
+
+class ScopedCounters
+{
+private:
+	Profiler &profiler;
+	const char *name;
+	PerfCounters::Values start;
+	PerfCounters::Scope scope;
+	bool valid;
+
+public:
+	ScopedCounters(Profiler &profiler, const char *name) noexcept :
+		profiler(profiler),
+		name(name),
+		valid(PerfCounters::Read(start))
+	{
+		PerfCounters::Enter(scope);
+	}
+
+	ScopedCounters(const ScopedCounters &) = delete;
+
+	~ScopedCounters() noexcept
+	{
+		PerfCounters::Leave(scope);
+
+		PerfCounters::Values finish;
+		if (!valid || !PerfCounters::Read(finish))
+		{
+			return;
+		}
+
+		for (uint i = 0; i < PerfCounters::COUNT; i++)
+		{
+			if (start.valid[i] && finish.valid[i])
+			{
+				const auto others = scope.counts[i].load(std::memory_order_relaxed);
+				const auto delta = static_cast<double>(finish.counts[i] - start.counts[i]) + static_cast<double>(others);
+				profiler.Accumulate(name, PerfCounters::GetName(i), "count", delta);
+			}
+		}
+	}
+};
+
+//==============================================================================
+
+class ScopedAllocations
+{
+private:
+	Profiler &profiler;
+	const char *name;
+	Memory::Counts start;
+
+public:
+	ScopedAllocations(Profiler &profiler, const char *name) noexcept :
+		profiler(profiler),
+		name(name),
+		start(Memory::GetThreadCounts())
+	{
+	}
+
+	ScopedAllocations(const ScopedAllocations &) = delete;
+
+	~ScopedAllocations() noexcept
+	{
+		const auto finish = Memory::GetThreadCounts();
+
+		profiler.Accumulate(name, "allocations", "count", static_cast<double>(finish.allocations - start.allocations));
+		profiler.Accumulate(name, "allocated_bytes", "bytes", static_cast<double>(finish.bytes - start.bytes));
+	}
+};
+
+//==============================================================================
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef CLOTH_PROFILE
+#define PROFILE_TIMER(profiler, name) ScopedTimer PROFILE_CONCAT(scoped_timer_, __LINE__)(profiler, name)
+#else
+#define PROFILE_TIMER(profiler, name) ((void)0)
+#endif
+
+#ifdef CLOTH_PERF
+#define PROFILE_COUNTERS(profiler, name) ScopedCounters PROFILE_CONCAT(scoped_counters_, __LINE__)(profiler, name)
+#else
+#define PROFILE_COUNTERS(profiler, name) ((void)0)
+#endif
+
+#ifdef CLOTH_MEMORY
+#define PROFILE_ALLOCATIONS(profiler, name) ScopedAllocations PROFILE_CONCAT(scoped_allocations_, __LINE__)(profiler, name)
+#else
+#define PROFILE_ALLOCATIONS(profiler, name) ((void)0)
+#endif
+
+#define PROFILE_SCOPE(profiler, name) PROFILE_TIMER(profiler, name); PROFILE_COUNTERS(profiler, name); PROFILE_ALLOCATIONS(profiler, name); TRACE_SCOPE(name)
+
+//==============================================================================
@@ -0,0 +1,408 @@
+
+#include "ProjectiveDynamicsSolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Constraint.h"
+#include "MemoryReport.h"
+#include "Particle.h"
+#include "ThreadPool.h"
+#include "Topology.h"
+
+//==============================================================================
+
+namespace
+{
+	float GetCotangent(const glm::vec3 &u, const glm::vec3 &v) noexcept
+	{
+		const auto sine = glm::length(glm::cross(u, v));
+		return (sine > 1e-30f) ? glm::dot(u, v) / sine : 0.0f;
+	}
+
+	// quadratic bending of Bergou et al. for the hinge P1-P2 with the wings P3 and P4,
+	// scaled so that |A x|^2 is the bending energy of the stencil
+	glm::vec4 GetBendWeights(const glm::vec3 &P1, const glm::vec3 &P2, const glm::vec3 &P3, const glm::vec3 &P4) noexcept
+	{
+		const auto e0 = P2 - P1;
+		const auto e1 = P3 - P1;
+		const auto e2 = P4 - P1;
+		const auto e3 = P3 - P2;
+		const auto e4 = P4 - P2;
+
+		const auto area = 0.5f * (glm::length(glm::cross(e0, e1)) + glm::length(glm::cross(e0, e2)));
+		if (area < 1e-30f)
+		{
+			return glm::vec4(0.0f);
+		}
+
+		const auto c01 = GetCotangent( e0, e1);
+		const auto c02 = GetCotangent( e0, e2);
+		const auto c03 = GetCotangent(-e0, e3);
+		const auto c04 = GetCotangent(-e0, e4);
+
+		return std::sqrt(3.0f / area) * glm::vec4(c03 + c04, c01 + c02, -c01 - c03, -c02 - c04);
+	}
+}
+
+//==============================================================================
+
+ProjectiveDynamicsSolver::ProjectiveDynamicsSolver(const std::vector<Particle*> &particles, const Topology &topology, ThreadPool &pool) noexcept :
+	pool(&pool),
+	factored(false),
+	failed(false),
+	factored_dt(0.0f),
+	factored_inv_mass(0.0f)
+{
+	const auto size = static_cast<uint>(particles.size());
+
+	positions.resize(size);
+	for (uint i = 0; i < size; i++)
+	{
+		positions[i] = particles[i]->GetPosition();
+	}
+
+	// bend constraints follow the interior edges in order, see Cloth::GenerateBendConstraints
+
+	const auto &edges = topology.GetEdges();
+
+	std::vector<unsigned long long> keys;
+	keys.reserve(size + 2 * edges.size());
+
+	const auto AddEntry = [&keys](uint row, uint column)
+	{
+		keys.push_back((static_cast<unsigned long long>(row) << 32) | column);
+	};
+
+	for (uint i = 0; i < size; i++)
+	{
+		AddEntry(i, i);
+	}
+
+	for (const auto &edge : edges)
+	{
+		AddEntry(edge.ind1, edge.ind2);
+		AddEntry(edge.ind2, edge.ind1);
+
+		if (!edge.boundary)
+		{
+			const uint ind[4] = { edge.ind1, edge.ind2, edge.ind3, edge.ind4 };
+
+			bends.insert(bends.end(), ind, ind + 4);
+			bend_weights.push_back(GetBendWeights(positions[ind[0]], positions[ind[1]], positions[ind[2]], positions[ind[3]]));
+
+			for (const auto row : ind)
+			{
+				for (const auto column : ind)
+				{
+					AddEntry(row, column);
+				}
+			}
+		}
+	}
+
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	offsets.assign(size + 1, 0);
+	columns.resize(keys.size());
+
+	for (size_t k = 0; k < keys.size(); k++)
+	{
+		offsets[(keys[k] >> 32) + 1]++;
+		columns[k] = static_cast<uint>(keys[k]);
+	}
+
+	for (uint i = 0; i < size; i++)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	matrix.resize(columns.size());
+
+	ordering.resize(size);
+	for (uint i = 0; i < size; i++)
+	{
+		ordering[i] = i;
+	}
+
+	std::vector<uint> sides(size, 0);
+	uint side = 0;
+
+	auto first = ordering.data();
+	Dissect(first, first + size, sides, side);
+
+	inertia.resize(size);
+	projections.resize(edges.size());
+	rhs.resize(size);
+	factored_fixed.resize(size);
+}
+
+//==============================================================================
+
+void ProjectiveDynamicsSolver::Dissect(uint *first, uint *last, std::vector<uint> &sides, uint &side) noexcept
+{
+	// orders [first, last) in place: the two halves along the longest axis, then the particles
+	// of the second half that touch the first, which separate them in the matrix
+
+	const auto size = static_cast<uint>(last - first);
+	if (size <= 64)
+	{
+		return;
+	}
+
+	auto min = positions[*first];
+	auto max = positions[*first];
+
+	for (auto p = first; p < last; p++)
+	{
+		min = glm::min(min, positions[*p]);
+		max = glm::max(max, positions[*p]);
+	}
+
+	const auto extent = max - min;
+	const auto axis = (extent.x >= extent.y) ? ((extent.x >= extent.z) ? 0 : 2) : ((extent.y >= extent.z) ? 1 : 2);
+
+	const auto middle = first + size / 2;
+	std::nth_element(first, middle, last, [&](uint i, uint j)
+	{
+		return positions[i][axis] < positions[j][axis];
+	});
+
+	const auto current = ++side;
+	for (auto p = first; p < middle; p++)
+	{
+		sides[*p] = current;
+	}
+
+	const auto separator = std::partition(middle, last, [&](uint i)
+	{
+		for (auto k = offsets[i]; k < offsets[i + 1]; k++)
+		{
+			if (sides[columns[k]] == current)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	});
+
+	Dissect(first, middle, sides, side);
+	Dissect(middle, separator, sides, side);
+}
+
+//==============================================================================
+
+uint ProjectiveDynamicsSolver::FindEntry(uint row, uint column) const noexcept
+{
+	const auto first = columns.begin() + offsets[row];
+	const auto last  = columns.begin() + offsets[row + 1];
+
+	return static_cast<uint>(std::lower_bound(first, last, column) - columns.begin());
+}
+
+//==============================================================================
+
+bool ProjectiveDynamicsSolver::Factor(const std::vector<Particle*> &particles, const Topology &topology,
+                                      const std::vector<DistanceConstraint> &distance_constraints,
+                                      const std::vector<BendConstraint> &bend_constraints,
+                                      float dt, float inv_mass) noexcept
+{
+	const auto size = static_cast<uint>(particles.size());
+
+	factored_dt = dt;
+	factored_inv_mass = inv_mass;
+
+	for (uint i = 0; i < size; i++)
+	{
+		factored_fixed[i] = particles[i]->IsFixed() ? 1 : 0;
+	}
+
+	std::fill(matrix.begin(), matrix.end(), 0.0f);
+
+	const auto &edges = topology.GetEdges();
+	for (uint e = 0; e < static_cast<uint>(edges.size()); e++)
+	{
+		const auto ind1 = edges[e].ind1;
+		const auto ind2 = edges[e].ind2;
+		const auto weight = 1.0f / distance_constraints[e].GetCompliance();
+
+		matrix[FindEntry(ind1, ind1)] += weight;
+		matrix[FindEntry(ind2, ind2)] += weight;
+		matrix[FindEntry(ind1, ind2)] -= weight;
+		matrix[FindEntry(ind2, ind1)] -= weight;
+	}
+
+	for (uint b = 0; b < static_cast<uint>(bend_constraints.size()); b++)
+	{
+		const auto ind = &bends[4 * b];
+		const auto &weights = bend_weights[b];
+		const auto weight = 1.0f / bend_constraints[b].GetCompliance();
+
+		for (uint i = 0; i < 4; i++)
+		{
+			for (uint j = 0; j < 4; j++)
+			{
+				matrix[FindEntry(ind[i], ind[j])] += weight * weights[i] * weights[j];
+			}
+		}
+	}
+
+	// fixed particles keep their position: their rows become identity and
+	// their columns move to the right hand side of the free rows
+
+	const auto inertia_weight = 1.0f / (inv_mass * dt * dt);
+
+	couplings.clear();
+
+	for (uint i = 0; i < size; i++)
+	{
+		for (auto k = offsets[i]; k < offsets[i + 1]; k++)
+		{
+			const auto j = columns[k];
+
+			if (factored_fixed[i])
+			{
+				matrix[k] = (i == j) ? 1.0f : 0.0f;
+			}
+			else
+			if (i == j)
+			{
+				matrix[k] += inertia_weight;
+			}
+			else
+			if (factored_fixed[j])
+			{
+				couplings.emplace_back(i, k);
+			}
+		}
+	}
+
+	std::vector<float> system(matrix);
+	for (const auto &coupling : couplings)
+	{
+		system[coupling.second] = 0.0f;
+	}
+
+	factored = cholesky.Factor(offsets, columns, system, ordering);
+	failed = !factored;
+	return factored;
+}
+
+//==============================================================================
+
+void ProjectiveDynamicsSolver::Invalidate() noexcept
+{
+	factored = false;
+	failed = false;
+}
+
+//==============================================================================
+
+bool ProjectiveDynamicsSolver::Project(const std::vector<Particle*> &particles, const Topology &topology,
+                                       const std::vector<DistanceConstraint> &distance_constraints,
+                                       const std::vector<BendConstraint> &bend_constraints,
+                                       float dt, float inv_mass) noexcept
+{
+	const auto size = static_cast<uint>(particles.size());
+
+	// a failed factorization is not retried until its inputs change
+	auto refactor = (!factored && !failed) || (dt != factored_dt) || (inv_mass != factored_inv_mass);
+	for (uint i = 0; (i < size) && !refactor; i++)
+	{
+		refactor = (particles[i]->IsFixed() != (factored_fixed[i] != 0));
+	}
+
+	if (refactor)
+	{
+		Factor(particles, topology, distance_constraints, bend_constraints, dt, inv_mass);
+	}
+
+	if (!factored)
+	{
+		return false;
+	}
+
+	pool->ParallelFor(0, size, 4096, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			positions[i] = particles[i]->GetPosition();
+			inertia[i] = positions[i];
+		}
+	});
+
+	const auto &edges = topology.GetEdges();
+	const auto inertia_weight = 1.0f / (inv_mass * dt * dt);
+
+	for (uint iteration = 0; iteration < iterations; iteration++)
+	{
+		pool->ParallelFor(0, static_cast<uint>(edges.size()), 4096, [&](uint first, uint last)
+		{
+			for (auto e = first; e < last; e++)
+			{
+				const auto &constraint = distance_constraints[e];
+
+				const auto L = positions[edges[e].ind1] - positions[edges[e].ind2];
+				const auto length = std::sqrt(glm::dot(L, L));
+
+				projections[e] = (constraint.GetDistance() / (length + 1e-30f)) * L / constraint.GetCompliance();
+			}
+		});
+
+		pool->ParallelFor(0, size, 4096, [&](uint first, uint last)
+		{
+			for (auto i = first; i < last; i++)
+			{
+				if (factored_fixed[i])
+				{
+					rhs[i] = positions[i];
+					continue;
+				}
+
+				auto b = inertia_weight * inertia[i];
+				for (const auto e : topology.GetVertexEdges(i))
+				{
+					b += (edges[e].ind1 == i) ? projections[e] : -projections[e];
+				}
+
+				rhs[i] = b;
+			}
+		});
+
+		for (const auto &coupling : couplings)
+		{
+			rhs[coupling.first] -= matrix[coupling.second] * positions[columns[coupling.second]];
+		}
+
+		cholesky.Solve(rhs);
+		positions.swap(rhs);
+	}
+
+	pool->ParallelFor(0, size, 4096, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			particles[i]->Move(positions[i] - inertia[i]);
+		}
+	});
+
+	return true;
+}
+
+//==============================================================================
+
+void ProjectiveDynamicsSolver::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "bends", MemoryReport::GetBytes(bends) + MemoryReport::GetBytes(bend_weights));
+	report.Add(prefix + "matrix", MemoryReport::GetBytes(offsets) + MemoryReport::GetBytes(columns) +
+	                              MemoryReport::GetBytes(matrix) + MemoryReport::GetBytes(ordering) +
+	                              MemoryReport::GetBytes(factored_fixed) + MemoryReport::GetBytes(couplings));
+	report.Add(prefix + "positions", MemoryReport::GetBytes(positions) + MemoryReport::GetBytes(inertia) +
+	                                 MemoryReport::GetBytes(projections) + MemoryReport::GetBytes(rhs));
+
+	cholesky.GetMemoryUsage(report, prefix + "cholesky.");
+}
+
+//==============================================================================
@@ -0,0 +1,88 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "SparseCholesky.h"
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class BendConstraint;
+class DistanceConstraint;
+class MemoryReport;
+class Particle;
+class ThreadPool;
+class Topology;
+
+//==============================================================================
+
+// Projective dynamics: every distance constraint projects its edge onto the
+// rest length (local step, in parallel) and the positions minimising
+//   m / (2 dt^2) |x - y|^2 + sum w / 2 |A x - p|^2
+// are found with one solve of a constant matrix (global step). Bending uses
+// the quadratic model around the flat rest shape, so it only enters the
+// matrix. The matrix is factored once and again only when the time step,
+// mass, stiffness or the set of fixed particles changes.
+class ProjectiveDynamicsSolver
+{
+public:
+	static constexpr uint iterations = 4;
+
+private:
+	ThreadPool *pool;
+
+	std::vector<uint> bends;             // 4 particles per bend constraint
+	std::vector<glm::vec4> bend_weights; // per bend, A x = sum weight * particle
+
+	std::vector<uint> offsets; // full compressed rows of the system
+	std::vector<uint> columns;
+	std::vector<float> matrix;
+	std::vector<uint> ordering; // nested dissection of the rest shape
+
+	SparseCholesky cholesky;
+
+	bool factored;
+	bool failed; // the last factorization found the matrix not positive definite
+	float factored_dt;
+	float factored_inv_mass;
+	std::vector<char> factored_fixed;
+	std::vector<std::pair<uint, uint>> couplings; // (row, entry) of free rows to fixed columns
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> inertia; // y, the positions the substep predicted
+	std::vector<glm::vec3> projections; // per distance constraint
+	std::vector<glm::vec3> rhs;
+
+private:
+	uint FindEntry(uint row, uint column) const noexcept;
+	void Dissect(uint *first, uint *last, std::vector<uint> &sides, uint &side) noexcept;
+
+	bool Factor(const std::vector<Particle*> &particles, const Topology &topology,
+	            const std::vector<DistanceConstraint> &distance_constraints,
+	            const std::vector<BendConstraint> &bend_constraints,
+	            float dt, float inv_mass) noexcept;
+
+public:
+	ProjectiveDynamicsSolver(const std::vector<Particle*> &particles, const Topology &topology, ThreadPool &pool) noexcept;
+
+	// the stiffness of the constraints changed
+	void Invalidate() noexcept;
+
+	// false if the system cannot be factored, nothing is projected then
+	bool Project(const std::vector<Particle*> &particles, const Topology &topology,
+	             const std::vector<DistanceConstraint> &distance_constraints,
+	             const std::vector<BendConstraint> &bend_constraints,
+	             float dt, float inv_mass) noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+};
+
+//==============================================================================
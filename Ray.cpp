@@ -5,7 +5,8 @@
 
 Ray::Ray(const glm::vec3 &origin, const glm::vec3 &end) noexcept :
 	origin(origin),
-	end(end)
+	end(end),
+	inv_direction(1.0f / (end - origin))
 {
 }
 
@@ -143,3 +144,21 @@ bool Ray::PlaneIntersection(const glm::vec3 &M, const glm::vec3 &N, glm::vec3 &P
 }
 
 //==============================================================================
+
+bool Ray::BoxIntersection(const AABB &box, float tmax, float &t) const noexcept
+{
+	const auto t1 = (box.min - origin) * inv_direction;
+	const auto t2 = (box.max - origin) * inv_direction;
+
+	const auto near = glm::min(t1, t2);
+	const auto far  = glm::max(t1, t2);
+
+	const auto tnear = glm::max(glm::max(near.x, near.y), glm::max(near.z, 0.0f));
+	const auto tfar  = glm::min(glm::min(far.x, far.y), glm::min(far.z, tmax));
+
+	t = tnear;
+
+	return tnear <= tfar;
+}
+
+//==============================================================================
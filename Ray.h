@@ -5,6 +5,8 @@
 
 #include <glm/glm.hpp>
 
+#include "AABB.h"
+
 //==============================================================================
 
 class Ray
@@ -12,6 +14,7 @@ class Ray
 private:
 	glm::vec3 origin;
 	glm::vec3 end;
+	glm::vec3 inv_direction;
 
 public:
 	Ray(const glm::vec3 &origin, const glm::vec3 &end) noexcept;
@@ -27,6 +30,8 @@ public:
 		                      float &t) const;
 
 	bool PlaneIntersection(const glm::vec3 &M, const glm::vec3 &N, glm::vec3 &P) const noexcept;
+
+	bool BoxIntersection(const AABB &box, float tmax, float &t) const noexcept;
 };
 
 //==============================================================================
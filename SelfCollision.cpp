@@ -0,0 +1,271 @@
+
+#include "SelfCollision.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "MemoryReport.h"
+#include "Particle.h"
+#include "ThreadPool.h"
+#include "Topology.h"
+
+//==============================================================================
+
+glm::ivec3 SelfCollision::GetCell(const glm::vec3 &position) const noexcept
+{
+	return glm::ivec3(glm::floor(position / (2.0f * thickness)));
+}
+
+//==============================================================================
+
+uint SelfCollision::GetHash(const glm::ivec3 &cell) const noexcept
+{
+	// linear in x, so the cells a query visits along x are neighbouring slots
+	// of the table and of cell_particles, instead of one cache miss each
+	const auto x = static_cast<uint>(cell.x);
+	const auto y = static_cast<uint>(cell.y) * 2053u;
+	const auto z = static_cast<uint>(cell.z) * 4194319u;
+
+	return (x + y + z) & (table_size - 1);
+}
+
+//==============================================================================
+
+void SelfCollision::BuildGrid(const std::vector<Particle*> &particles) noexcept
+{
+	const auto size = static_cast<uint>(particles.size());
+
+	uint table = 1;
+	while (table < 2 * size)
+	{
+		table <<= 1;
+	}
+
+	if (table != table_size)
+	{
+		table_size = table;
+		cell_counts.reset(new std::atomic<uint>[table_size]);
+		cell_start.resize(table_size + 1);
+	}
+
+	positions.resize(size);
+	particle_cells.resize(size);
+	particle_hashes.resize(size);
+	cell_particles.resize(size);
+
+	pool->ParallelFor(0, table_size, 4096, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			cell_counts[i].store(0, std::memory_order_relaxed);
+		}
+	});
+
+	pool->ParallelFor(0, size, 1024, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto &position = particles[i]->GetPosition();
+			const auto cell = GetCell(position);
+			const auto hash = GetHash(cell);
+
+			positions[i] = position;
+			particle_cells[i] = cell;
+			particle_hashes[i] = hash;
+			cell_counts[hash].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	constexpr uint block = 4096;
+	const auto blocks = (table_size + block - 1) / block;
+
+	block_sums.assign(blocks + 1, 0);
+
+	pool->ParallelFor(0, blocks, 1, [&](uint first, uint last)
+	{
+		for (auto b = first; b < last; b++)
+		{
+			uint sum = 0;
+			for (auto i = b * block; i < std::min((b + 1) * block, table_size); i++)
+			{
+				sum += cell_counts[i].load(std::memory_order_relaxed);
+			}
+
+			block_sums[b + 1] = sum;
+		}
+	});
+
+	for (uint b = 0; b < blocks; b++)
+	{
+		block_sums[b + 1] += block_sums[b];
+	}
+
+	pool->ParallelFor(0, blocks, 1, [&](uint first, uint last)
+	{
+		for (auto b = first; b < last; b++)
+		{
+			auto offset = block_sums[b];
+			for (auto i = b * block; i < std::min((b + 1) * block, table_size); i++)
+			{
+				const auto count = cell_counts[i].load(std::memory_order_relaxed);
+
+				cell_start[i] = offset;
+				cell_counts[i].store(offset, std::memory_order_relaxed);
+				offset += count;
+			}
+		}
+	});
+
+	cell_start[table_size] = size;
+
+	pool->ParallelFor(0, size, 1024, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto slot = cell_counts[particle_hashes[i]].fetch_add(1, std::memory_order_relaxed);
+			cell_particles[slot] = i;
+		}
+	});
+
+	pool->ParallelFor(0, table_size, 4096, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			if (cell_start[i + 1] - cell_start[i] > 1)
+			{
+				std::sort(cell_particles.begin() + cell_start[i], cell_particles.begin() + cell_start[i + 1]);
+			}
+		}
+	});
+}
+
+//==============================================================================
+
+SelfCollision::SelfCollision(ThreadPool &pool) noexcept :
+	pool(&pool),
+	enabled(true),
+	thickness(0.0f),
+	table_size(0)
+{
+}
+
+//==============================================================================
+
+bool SelfCollision::IsEnabled() const noexcept
+{
+	return enabled;
+}
+
+//==============================================================================
+
+void SelfCollision::SetEnabled(bool value) noexcept
+{
+	enabled = value;
+}
+
+//==============================================================================
+
+float SelfCollision::GetThickness() const noexcept
+{
+	return thickness;
+}
+
+//==============================================================================
+
+void SelfCollision::SetThickness(float value) noexcept
+{
+	thickness = value;
+}
+
+//==============================================================================
+
+void SelfCollision::Project(const std::vector<Particle*> &particles, const Topology &topology) noexcept
+{
+	if (!enabled || (thickness <= 0.0f) || particles.empty())
+	{
+		return;
+	}
+
+	BuildGrid(particles);
+
+	const auto size = static_cast<uint>(particles.size());
+	const auto thickness2 = thickness * thickness;
+
+	corrections.resize(size);
+
+	pool->ParallelFor(0, size, 256, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			auto &correction = corrections[i];
+			correction = glm::vec3(0.0f, 0.0f, 0.0f);
+
+			if (particles[i]->IsFixed())
+			{
+				continue;
+			}
+
+			const auto &P = positions[i];
+			const auto cell = GetCell(P - glm::vec3(thickness));
+
+			for (auto dx = 0; dx <= 1; dx++)
+			for (auto dy = 0; dy <= 1; dy++)
+			for (auto dz = 0; dz <= 1; dz++)
+			{
+				const auto neighbour = cell + glm::ivec3(dx, dy, dz);
+				const auto hash = GetHash(neighbour);
+
+				for (auto k = cell_start[hash]; k < cell_start[hash + 1]; k++)
+				{
+					const auto j = cell_particles[k];
+					if ((j == i) || (particle_cells[j] != neighbour))
+					{
+						continue;
+					}
+
+					const auto d = P - positions[j];
+					const auto distance2 = glm::dot(d, d);
+
+					if ((distance2 >= thickness2) || (distance2 < 1e-12f))
+					{
+						continue;
+					}
+
+					if (topology.IsAdjacent(i, j))
+					{
+						continue;
+					}
+
+					const auto distance = std::sqrt(distance2);
+					const auto weight = particles[j]->IsFixed() ? 1.0f : 0.5f;
+
+					correction += weight * (thickness - distance) / distance * d;
+				}
+			}
+		}
+	});
+
+	pool->ParallelFor(0, size, 1024, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			particles[i]->Move(corrections[i]);
+		}
+	});
+}
+
+//==============================================================================
+
+void SelfCollision::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "positions", MemoryReport::GetBytes(positions));
+	report.Add(prefix + "corrections", MemoryReport::GetBytes(corrections));
+	report.Add(prefix + "particle_cells", MemoryReport::GetBytes(particle_cells));
+	report.Add(prefix + "particle_hashes", MemoryReport::GetBytes(particle_hashes));
+	report.Add(prefix + "cell_start", MemoryReport::GetBytes(cell_start));
+	report.Add(prefix + "cell_particles", MemoryReport::GetBytes(cell_particles));
+	report.Add(prefix + "block_sums", MemoryReport::GetBytes(block_sums));
+	report.Add(prefix + "cell_counts", cell_counts ? table_size * sizeof(std::atomic<uint>) : 0);
+}
+
+//==============================================================================
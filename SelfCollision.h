@@ -0,0 +1,63 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class MemoryReport;
+class Particle;
+class ThreadPool;
+class Topology;
+
+//==============================================================================
+
+class SelfCollision
+{
+private:
+	ThreadPool *pool;
+
+	bool enabled;
+	float thickness;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> corrections;
+
+	std::vector<glm::ivec3> particle_cells;
+	std::vector<uint> particle_hashes;
+	std::vector<uint> cell_start;
+	std::vector<uint> cell_particles;
+	std::vector<uint> block_sums;
+	std::unique_ptr<std::atomic<uint>[]> cell_counts;
+	uint table_size;
+
+private:
+	glm::ivec3 GetCell(const glm::vec3 &position) const noexcept;
+	uint GetHash(const glm::ivec3 &cell) const noexcept;
+
+	void BuildGrid(const std::vector<Particle*> &particles) noexcept;
+
+public:
+	explicit SelfCollision(ThreadPool &pool) noexcept;
+
+	bool IsEnabled() const noexcept;
+	void SetEnabled(bool value) noexcept;
+
+	float GetThickness() const noexcept;
+	void SetThickness(float value) noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+
+	void Project(const std::vector<Particle*> &particles, const Topology &topology) noexcept;
+};
+
+//==============================================================================
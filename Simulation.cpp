@@ -9,10 +9,14 @@
 #include "Camera.h"
 #include "Cloth.h"
 #include "Drawable.h"
+#include "Memory.h"
+#include "MemoryReport.h"
 #include "Physics.h"
+#include "Profiler.h"
 #include "Ray.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "Trace.h"
 
 #include "GLFW/glfw3.h"
 
@@ -38,6 +42,7 @@ const auto height = 720u;
 
 bool wireframe = false;
 
+uint cloth;
 uint point;
 glm::vec3 POINT;
 
@@ -47,6 +52,11 @@ Texture *texture   = nullptr;
 Drawable *drawable = nullptr;
 Physics *physics   = nullptr;
 
+std::vector<float> vertices;
+std::vector<float> normals;
+std::vector<float> uvs;
+std::vector<uint>  indices;
+
 //==============================================================================
 
 int main()
@@ -73,14 +83,37 @@ int main()
 	glDepthFunc(GL_LESS);
 	glViewport(0, 0, width, height);
 
+#ifdef CLOTH_TRACE
+	TRACE_THREAD("main");
+	Trace::SetOutput("trace.json");
+#endif
+
+	uint frame = 0;
+
 	while (!glfwWindowShouldClose(window))
 	{
+		TRACE_SCOPE("frame");
+
+#ifdef CLOTH_MEMORY
+		const AllocationCounter allocations;
+#endif
+
 		ProcessInput(window);
 
 		physics->Simulate();
 
 		Render();
 
+#ifdef CLOTH_MEMORY
+		const auto counts = allocations.Get();
+		if ((frame > 10) && counts.allocations)
+		{
+			std::cout << "frame " << frame << ": " << counts.allocations << " allocations, " << counts.bytes << " bytes" << std::endl;
+		}
+#endif
+
+		frame++;
+
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
@@ -123,18 +156,18 @@ void OnMouseButton(GLFWwindow *window, int button, int action, int mods)
 
 			uint index;
 			glm::vec3 P;
-			if (physics->Raycast(ray, index, P))
+			if (physics->Raycast(ray, cloth, index, P))
 			{
 				point = index;
 				POINT = P;
 
-				physics->FixClothPoint(index);
+				physics->FixClothPoint(cloth, index);
 			}
 		}
 		else
 		if (action == GLFW_RELEASE)
 		{
-			physics->FreeClothPoint(point);
+			physics->FreeClothPoint(cloth, point);
 		}
 	}
 }
@@ -179,7 +212,7 @@ void OnMouseMotion(GLFWwindow *window, double x, double y)
 
 		const auto translation = glm::dot(dP, ex) * ex + glm::dot(dP, ey) * ey;
 
-		physics->MoveClothPoint(point, translation);
+		physics->MoveClothPoint(cloth, point, translation);
 	}
 	else
 	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
@@ -211,6 +244,19 @@ void OnKey(GLFWwindow *window, int key, int scancode, int action, int mods)
 			wireframe = !wireframe;
 		}
 	}
+
+	if (key == GLFW_KEY_M)
+	{
+		if (action == GLFW_PRESS)
+		{
+			MemoryReport report;
+			physics->GetMemoryUsage(report);
+			drawable->GetMemoryUsage(report, "drawable.");
+			report.Dump(std::cout);
+
+			std::cout << "construction peak " << physics->GetConstructionPeak(cloth) / 1024.0 << " KB" << std::endl;
+		}
+	}
 }
 
 //==============================================================================
@@ -317,22 +363,17 @@ void Prepare() noexcept
 	const auto h = 1.0f;
 	const auto s = 0.02f;
 
-	physics->AddCloth(w, h, s);
+	cloth = physics->AddCloth(w, h, s);
 
 	const auto nx = static_cast<uint>(w / s);
 	const auto ny = static_cast<uint>(h / s);
 
-	physics->FixClothPoint((ny + 1) - 1);
-	physics->FixClothPoint((ny + 1) * (nx + 1) - 1);
+	physics->FixClothPoint(cloth, (ny + 1) - 1);
+	physics->FixClothPoint(cloth, (ny + 1) * (nx + 1) - 1);
 
 	texture->Load("textures\\cloth.png");;
 
-	std::vector<float> vertices;
-	std::vector<float> normals;
-	std::vector<float> uvs;
-	std::vector<uint>  indices;
-
-	physics->GetCloth(vertices, normals, uvs, indices);
+	physics->GetCloth(cloth, vertices, normals, uvs, indices);
 	drawable->SetBuffers(vertices, normals, uvs, indices);
 }
 
@@ -349,13 +390,17 @@ void Render()
 	const auto view = camera->GetView();
 	const auto projection = camera->GetProjection(aspect);
 
-	std::vector<float> vertices;
-	std::vector<float> normals;
-	std::vector<float> uvs;
-	std::vector<uint>  indices;
+	{
+		PROFILE_SCOPE(physics->GetProfiler(), "render.fetch");
+		physics->GetCloth(cloth, vertices, normals, uvs, indices);
+	}
+
+	{
+		PROFILE_SCOPE(physics->GetProfiler(), "render.upload");
+		drawable->UpdateBuffers(vertices, normals, uvs);
+	}
 
-	physics->GetCloth(vertices, normals, uvs, indices);
-	drawable->UpdateBuffers(vertices, normals, uvs);
+	PROFILE_SCOPE(physics->GetProfiler(), "render.draw");
 
 	shader->Use();
 	shader->SetMat4("model", model);
@@ -0,0 +1,17 @@
+
+#pragma once
+
+//==============================================================================
+
+// how Cloth projects its distance and bend constraints
+enum class Solver
+{
+	XPBD,                // Gauss-Seidel over the constraint lists
+	STENCIL,             // colored row sweeps over a regular grid, see StencilSolver
+	TILED,               // cache-sized tiles swept locally in parallel, see TiledSolver
+	BLOCK_DESCENT,       // per particle Newton steps in colored batches, see BlockDescentSolver
+	PROJECTIVE_DYNAMICS, // local projections and a prefactored global solve, see ProjectiveDynamicsSolver
+	IMPLICIT_EULER       // velocities from a preconditioned conjugate gradient solve, see ImplicitEulerSolver
+};
+
+//==============================================================================
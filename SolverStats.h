@@ -0,0 +1,34 @@
+
+#pragma once
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+//==============================================================================
+
+struct SolverStats
+{
+	uint iterations;      // of the solver, summed over the substeps since the last stats
+	bool iterative;       // the solver reports iterations, block descent and implicit Euler
+	float max_stretch;    // relative, (length - rest) / rest
+	float rms_stretch;
+	float max_bend_error; // radians
+	float rms_bend_error;
+	float kinetic_energy;
+	bool fallback;        // the chosen solver could not run, XPBD projected instead
+
+	SolverStats() noexcept :
+		iterations(0),
+		iterative(false),
+		max_stretch(0.0f),
+		rms_stretch(0.0f),
+		max_bend_error(0.0f),
+		rms_bend_error(0.0f),
+		kinetic_energy(0.0f),
+		fallback(false)
+	{
+	}
+};
+
+//==============================================================================
@@ -0,0 +1,220 @@
+
+#include "SparseCholesky.h"
+
+#include <cmath>
+
+#include "MemoryReport.h"
+
+//==============================================================================
+
+SparseCholesky::SparseCholesky() noexcept :
+	size(0)
+{
+}
+
+//==============================================================================
+
+uint SparseCholesky::GetRowPattern(uint row, const std::vector<uint> &offsets, const std::vector<uint> &columns) noexcept
+{
+	// columns of L in row k: the tree paths from the entries of A below the diagonal, in topological order
+
+	auto top = size;
+	marks[row] = row;
+
+	const auto source = order[row];
+	for (auto k = offsets[source]; k < offsets[source + 1]; k++)
+	{
+		auto column = inverse[columns[k]];
+		if (column > row)
+		{
+			continue;
+		}
+
+		uint length = 0;
+		for (; marks[column] != row; column = parents[column])
+		{
+			pattern[length++] = column;
+			marks[column] = row;
+		}
+
+		while (length > 0)
+		{
+			pattern[--top] = pattern[--length];
+		}
+	}
+
+	return top;
+}
+
+//==============================================================================
+
+bool SparseCholesky::Factor(const std::vector<uint> &offsets, const std::vector<uint> &columns, const std::vector<float> &matrix,
+                            const std::vector<uint> &ordering) noexcept
+{
+	size = static_cast<uint>(ordering.size());
+	order = ordering;
+
+	inverse.resize(size);
+	for (uint i = 0; i < size; i++)
+	{
+		inverse[order[i]] = i;
+	}
+
+	// elimination tree, with path compression through ancestors
+
+	parents.assign(size, size);
+	marks.assign(size, size);
+
+	for (uint row = 0; row < size; row++)
+	{
+		const auto source = order[row];
+		for (auto k = offsets[source]; k < offsets[source + 1]; k++)
+		{
+			auto column = inverse[columns[k]];
+
+			while ((column != size) && (column < row))
+			{
+				const auto next = marks[column];
+				marks[column] = row;
+
+				if (next == size)
+				{
+					parents[column] = row;
+				}
+
+				column = next;
+			}
+		}
+	}
+
+	// column counts
+
+	pattern.resize(size);
+	marks.assign(size, size);
+	column_offsets.assign(size + 1, 0);
+
+	for (uint row = 0; row < size; row++)
+	{
+		for (auto k = GetRowPattern(row, offsets, columns); k < size; k++)
+		{
+			column_offsets[pattern[k] + 1]++;
+		}
+
+		column_offsets[row + 1]++;
+	}
+
+	for (uint i = 0; i < size; i++)
+	{
+		column_offsets[i + 1] += column_offsets[i];
+	}
+
+	rows.resize(column_offsets[size]);
+	values.resize(column_offsets[size]);
+
+	// up-looking numeric factorization, one row of L at a time
+
+	std::vector<uint> next(column_offsets.begin(), column_offsets.end() - 1);
+
+	work.assign(size, 0.0);
+	marks.assign(size, size);
+
+	for (uint row = 0; row < size; row++)
+	{
+		const auto top = GetRowPattern(row, offsets, columns);
+
+		const auto source = order[row];
+		for (auto k = offsets[source]; k < offsets[source + 1]; k++)
+		{
+			const auto column = inverse[columns[k]];
+			if (column <= row)
+			{
+				work[column] = matrix[k];
+			}
+		}
+
+		auto diagonal = work[row];
+		work[row] = 0.0;
+
+		for (auto k = top; k < size; k++)
+		{
+			const auto column = pattern[k];
+			const auto value = work[column] / values[column_offsets[column]];
+			work[column] = 0.0;
+
+			for (auto p = column_offsets[column] + 1; p < next[column]; p++)
+			{
+				work[rows[p]] -= values[p] * value;
+			}
+
+			diagonal -= value * value;
+
+			const auto p = next[column]++;
+			rows[p] = row;
+			values[p] = value;
+		}
+
+		if (diagonal <= 0.0)
+		{
+			size = 0;
+			return false;
+		}
+
+		const auto p = next[row]++;
+		rows[p] = row;
+		values[p] = std::sqrt(diagonal);
+	}
+
+	solution.resize(size);
+	return true;
+}
+
+//==============================================================================
+
+void SparseCholesky::Solve(std::vector<glm::vec3> &rhs) noexcept
+{
+	for (uint i = 0; i < size; i++)
+	{
+		solution[i] = glm::dvec3(rhs[order[i]]);
+	}
+
+	for (uint column = 0; column < size; column++)
+	{
+		const auto value = solution[column] / values[column_offsets[column]];
+		solution[column] = value;
+
+		for (auto p = column_offsets[column] + 1; p < column_offsets[column + 1]; p++)
+		{
+			solution[rows[p]] -= values[p] * value;
+		}
+	}
+
+	for (auto column = size; column-- > 0;)
+	{
+		auto value = solution[column];
+
+		for (auto p = column_offsets[column] + 1; p < column_offsets[column + 1]; p++)
+		{
+			value -= values[p] * solution[rows[p]];
+		}
+
+		solution[column] = value / values[column_offsets[column]];
+	}
+
+	for (uint i = 0; i < size; i++)
+	{
+		rhs[order[i]] = glm::vec3(solution[i]);
+	}
+}
+
+//==============================================================================
+
+void SparseCholesky::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "ordering", MemoryReport::GetBytes(order) + MemoryReport::GetBytes(inverse));
+	report.Add(prefix + "factor", MemoryReport::GetBytes(parents) + MemoryReport::GetBytes(column_offsets) +
+	                              MemoryReport::GetBytes(rows) + MemoryReport::GetBytes(values));
+	report.Add(prefix + "work", MemoryReport::GetBytes(pattern) + MemoryReport::GetBytes(marks) +
+	                            MemoryReport::GetBytes(work) + MemoryReport::GetBytes(solution));
+}
+
+//==============================================================================
@@ -0,0 +1,58 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class MemoryReport;
+
+//==============================================================================
+
+// Cholesky factorization L L^T = P A P^T of a sparse symmetric positive definite
+// matrix given as full compressed rows, for a caller supplied ordering P.
+// Rows of L are found by walking the elimination tree, so the structure is
+// computed in time proportional to the fill. One factor serves the x, y and z
+// right hand sides of a solve.
+class SparseCholesky
+{
+private:
+	uint size;
+
+	std::vector<uint> order;   // row of P A P^T -> row of A
+	std::vector<uint> inverse; // row of A -> row of P A P^T
+
+	std::vector<uint> parents; // elimination tree, size for a root
+	std::vector<uint> column_offsets;
+	std::vector<uint> rows;    // per column of L, the diagonal first
+	std::vector<double> values;
+
+	std::vector<uint> pattern;
+	std::vector<uint> marks;
+	std::vector<double> work;
+	std::vector<glm::dvec3> solution;
+
+private:
+	uint GetRowPattern(uint row, const std::vector<uint> &offsets, const std::vector<uint> &columns) noexcept;
+
+public:
+	SparseCholesky() noexcept;
+
+	// false if the matrix is not positive definite
+	bool Factor(const std::vector<uint> &offsets, const std::vector<uint> &columns, const std::vector<float> &matrix,
+	            const std::vector<uint> &ordering) noexcept;
+
+	// overwrites the right hand side with the solution
+	void Solve(std::vector<glm::vec3> &rhs) noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+};
+
+//==============================================================================
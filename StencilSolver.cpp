@@ -0,0 +1,550 @@
+#include "StencilSolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "MemoryReport.h"
+#include "Particle.h"
+#include "ThreadPool.h"
+
+//==============================================================================
+
+namespace
+{
+	enum Bend : uint
+	{
+		DIAGONAL, // diagonal of cell (i, j)
+		TOP,      // (i, j + 1)-(i + 1, j + 1), shared with cell (i, j + 1)
+		RIGHT     // (i + 1, j)-(i + 1, j + 1), shared with cell (i + 1, j)
+	};
+
+	// Corners of a bend stencil of cell (i, j) as offsets from (i, j), in the
+	// order Topology gives them (ind1, ind2, ind3, ind4). Cells with i < nx / 2
+	// are split along (i + 1, j)-(i, j + 1), the others along (i, j)-(i + 1, j + 1).
+	void GetBend(Bend bend, uint i, uint nx, uint (&di)[4], uint (&dj)[4]) noexcept
+	{
+		static const uint offsets[3][3][2][4] =
+		{
+			{ { { 1, 0, 0, 1 }, { 0, 1, 0, 1 } }, { { 1, 0, 1, 0 }, { 1, 0, 0, 1 } }, { { 0, 0, 0, 0 }, { 0, 0, 0, 0 } } },
+			{ { { 1, 0, 1, 0 }, { 1, 1, 0, 2 } }, { { 1, 0, 0, 1 }, { 1, 1, 0, 2 } }, { { 0, 0, 0, 0 }, { 0, 0, 0, 0 } } },
+			{ { { 1, 1, 0, 2 }, { 0, 1, 1, 0 } }, { { 1, 1, 0, 2 }, { 0, 1, 1, 1 } }, { { 1, 1, 0, 2 }, { 0, 1, 0, 1 } } }
+		};
+
+		// the right stencil also depends on how the next cell is split
+		const auto split = (i < nx / 2) ? ((i + 1 < nx / 2) ? 0 : 1) : 2;
+		const auto variant = (bend == RIGHT) ? split : ((split == 2) ? 1 : 0);
+
+		for (uint k = 0; k < 4; k++)
+		{
+			di[k] = offsets[bend][variant][0][k];
+			dj[k] = offsets[bend][variant][1][k];
+		}
+	}
+
+	// DistanceConstraint::GetCorrection for count disjoint pairs (p1[k * stride], p2[k * stride]),
+	// with scale = -inv_mass / (inv_mass + inv_mass + alpha) hoisted out of the loop
+	template <uint stride>
+	void ProjectDistanceRow(float *__restrict x1, float *__restrict y1, float *__restrict z1, const float *__restrict w1,
+	                        float *__restrict x2, float *__restrict y2, float *__restrict z2, const float *__restrict w2,
+	                        const float *__restrict rest, uint count, float scale) noexcept
+	{
+		for (uint k = 0; k < count; k++)
+		{
+			const auto n = k * stride;
+
+			const auto Lx = x1[n] - x2[n];
+			const auto Ly = y1[n] - y2[n];
+			const auto Lz = z1[n] - z2[n];
+
+			const auto length = std::sqrt(Lx * Lx + Ly * Ly + Lz * Lz);
+			const auto s = scale * (length - rest[n]) / (length + 1e-30f);
+
+			const auto s1 = w1[n] * s;
+			const auto s2 = w2[n] * s;
+
+			x1[n] += s1 * Lx;
+			y1[n] += s1 * Ly;
+			z1[n] += s1 * Lz;
+
+			x2[n] -= s2 * Lx;
+			y2[n] -= s2 * Ly;
+			z2[n] -= s2 * Lz;
+		}
+	}
+
+	constexpr uint BEND_BLOCK = 64;
+
+	// Corners of up to BEND_BLOCK disjoint bend stencils, [corner][stencil]
+	struct BendBlock
+	{
+		float x[4][BEND_BLOCK];
+		float y[4][BEND_BLOCK];
+		float z[4][BEND_BLOCK];
+		float w[4][BEND_BLOCK];
+	};
+
+	// BendConstraint::GetCorrection with a rest angle of PI, as set up by
+	// Cloth::GenerateBendConstraints. The geometry runs twice as vector loops
+	// around the scalar acos; degenerate stencils get a zero constraint.
+	void ProjectBendBlock(BendBlock &block, uint count, float alpha, float inv_mass) noexcept
+	{
+		float cosine[BEND_BLOCK];
+		float sign[BEND_BLOCK];
+
+		for (uint k = 0; k < count; k++)
+		{
+			const auto ex = block.x[1][k] - block.x[0][k];
+			const auto ey = block.y[1][k] - block.y[0][k];
+			const auto ez = block.z[1][k] - block.z[0][k];
+
+			// n1 = (P1 - P3) x (P2 - P3), n2 = (P2 - P4) x (P1 - P4)
+			const auto ax = block.x[0][k] - block.x[2][k], bx = block.x[1][k] - block.x[2][k];
+			const auto ay = block.y[0][k] - block.y[2][k], by = block.y[1][k] - block.y[2][k];
+			const auto az = block.z[0][k] - block.z[2][k], bz = block.z[1][k] - block.z[2][k];
+			const auto cx = block.x[1][k] - block.x[3][k], dx = block.x[0][k] - block.x[3][k];
+			const auto cy = block.y[1][k] - block.y[3][k], dy = block.y[0][k] - block.y[3][k];
+			const auto cz = block.z[1][k] - block.z[3][k], dz = block.z[0][k] - block.z[3][k];
+
+			const auto n1x = ay * bz - az * by, n1y = az * bx - ax * bz, n1z = ax * by - ay * bx;
+			const auto n2x = cy * dz - cz * dy, n2y = cz * dx - cx * dz, n2z = cx * dy - cy * dx;
+
+			const auto elen2 = ex * ex + ey * ey + ez * ez;
+			const auto n1_length2 = n1x * n1x + n1y * n1y + n1z * n1z;
+			const auto n2_length2 = n2x * n2x + n2y * n2y + n2z * n2z;
+
+			const auto valid = (elen2 >= 1e-12f) & (n1_length2 >= 1e-10f) & (n2_length2 >= 1e-10f);
+
+			const auto length2 = n1_length2 * n2_length2;
+
+			auto dot = (n1x * n2x + n1y * n2y + n1z * n2z) / std::sqrt(valid ? length2 : 1.0f);
+			dot = std::min(std::max(dot, -1.0f), 1.0f);
+
+			// the gradients below are those of the unsigned angle
+			const auto orientation = (n1y * n2z - n1z * n2y) * ex + (n1z * n2x - n1x * n2z) * ey + (n1x * n2y - n1y * n2x) * ez;
+			const auto flip = (orientation > 0.0f) ? -1.0f : 1.0f;
+
+			cosine[k] = dot;
+			sign[k] = valid ? flip : 0.0f;
+		}
+
+		float constraint[BEND_BLOCK];
+		for (uint k = 0; k < count; k++)
+		{
+			constraint[k] = sign[k] * std::acos(cosine[k]);
+		}
+
+		for (uint k = 0; k < count; k++)
+		{
+			const auto ex = block.x[1][k] - block.x[0][k];
+			const auto ey = block.y[1][k] - block.y[0][k];
+			const auto ez = block.z[1][k] - block.z[0][k];
+
+			const auto ax = block.x[0][k] - block.x[2][k], bx = block.x[1][k] - block.x[2][k];
+			const auto ay = block.y[0][k] - block.y[2][k], by = block.y[1][k] - block.y[2][k];
+			const auto az = block.z[0][k] - block.z[2][k], bz = block.z[1][k] - block.z[2][k];
+			const auto cx = block.x[1][k] - block.x[3][k], dx = block.x[0][k] - block.x[3][k];
+			const auto cy = block.y[1][k] - block.y[3][k], dy = block.y[0][k] - block.y[3][k];
+			const auto cz = block.z[1][k] - block.z[3][k], dz = block.z[0][k] - block.z[3][k];
+
+			const auto n1x = ay * bz - az * by, n1y = az * bx - ax * bz, n1z = ax * by - ay * bx;
+			const auto n2x = cy * dz - cz * dy, n2y = cz * dx - cx * dz, n2z = cx * dy - cy * dx;
+
+			// degenerate stencils get safe denominators and no correction
+			const auto valid = (constraint[k] != 0.0f);
+
+			const auto elen2 = ex * ex + ey * ey + ez * ez;
+			const auto n1_length2 = n1x * n1x + n1y * n1y + n1z * n1z;
+			const auto n2_length2 = n2x * n2x + n2y * n2y + n2z * n2z;
+
+			const auto elen = std::sqrt(valid ? elen2 : 1.0f);
+			const auto inv_n1_length2 = 1.0f / (valid ? n1_length2 : 1.0f);
+			const auto inv_n2_length2 = 1.0f / (valid ? n2_length2 : 1.0f);
+
+			// n1 / |n1|^2 and n2 / |n2|^2
+			const auto m1x = n1x * inv_n1_length2, m1y = n1y * inv_n1_length2, m1z = n1z * inv_n1_length2;
+			const auto m2x = n2x * inv_n2_length2, m2y = n2y * inv_n2_length2, m2z = n2z * inv_n2_length2;
+
+			const auto inv_elen = 1.0f / elen;
+
+			// dot(P3 - P2, e), dot(P4 - P2, e), dot(P1 - P3, e), dot(P1 - P4, e)
+			const auto e32 = -(bx * ex + by * ey + bz * ez) * inv_elen;
+			const auto e42 = -(cx * ex + cy * ey + cz * ez) * inv_elen;
+			const auto e13 = (ax * ex + ay * ey + az * ez) * inv_elen;
+			const auto e14 = (dx * ex + dy * ey + dz * ez) * inv_elen;
+
+			const auto g0x = e32 * m1x + e42 * m2x, g0y = e32 * m1y + e42 * m2y, g0z = e32 * m1z + e42 * m2z;
+			const auto g1x = e13 * m1x + e14 * m2x, g1y = e13 * m1y + e14 * m2y, g1z = e13 * m1z + e14 * m2z;
+			const auto g2x = elen * m1x, g2y = elen * m1y, g2z = elen * m1z;
+			const auto g3x = elen * m2x, g3y = elen * m2y, g3z = elen * m2z;
+
+			const auto sum = inv_mass * (g0x * g0x + g0y * g0y + g0z * g0z + g1x * g1x + g1y * g1y + g1z * g1z +
+			                             g2x * g2x + g2y * g2y + g2z * g2z + g3x * g3x + g3y * g3y + g3z * g3z);
+
+			const auto delta_lambda = -constraint[k] / (valid ? sum + alpha : 1.0f);
+			const auto s = inv_mass * delta_lambda;
+
+			const auto s0 = s * block.w[0][k];
+			const auto s1 = s * block.w[1][k];
+			const auto s2 = s * block.w[2][k];
+			const auto s3 = s * block.w[3][k];
+
+			block.x[0][k] += s0 * g0x; block.y[0][k] += s0 * g0y; block.z[0][k] += s0 * g0z;
+			block.x[1][k] += s1 * g1x; block.y[1][k] += s1 * g1y; block.z[1][k] += s1 * g1z;
+			block.x[2][k] += s2 * g2x; block.y[2][k] += s2 * g2y; block.z[2][k] += s2 * g2z;
+			block.x[3][k] += s3 * g3x; block.y[3][k] += s3 * g3y; block.z[3][k] += s3 * g3z;
+		}
+	}
+}
+
+//==============================================================================
+
+StencilSolver::StencilSolver(uint nx, uint ny, ThreadPool &pool) noexcept :
+	pool(&pool),
+	nx(nx),
+	ny(ny),
+	distance_compliance(1.0f),
+	bend_compliance(1.0f),
+	resident(false)
+{
+	const auto size = (nx + 1) * (ny + 1);
+
+	x.resize(size);
+	y.resize(size);
+	z.resize(size);
+	weights.resize(size);
+
+	rest_i.resize(size);
+	rest_j.resize(size);
+	rest_d.resize(size);
+}
+
+//==============================================================================
+
+uint StencilSolver::GetIndex(uint i, uint j) const noexcept
+{
+	return i * (ny + 1) + j;
+}
+
+//==============================================================================
+
+glm::vec3 StencilSolver::GetPosition(uint index) const noexcept
+{
+	return glm::vec3(x[index], y[index], z[index]);
+}
+
+//==============================================================================
+
+void StencilSolver::Gather(const std::vector<Particle*> &particles) noexcept
+{
+	const auto size = static_cast<uint>(particles.size());
+
+	pool->ParallelFor(0, size, 4096, [&](uint first, uint last)
+	{
+		for (auto k = first; k < last; k++)
+		{
+			const auto particle = particles[k];
+			const auto &P = particle->GetPosition();
+
+			x[k] = P.x;
+			y[k] = P.y;
+			z[k] = P.z;
+			weights[k] = particle->IsFixed() ? 0.0f : 1.0f;
+		}
+	});
+}
+
+//==============================================================================
+
+void StencilSolver::Scatter(const std::vector<Particle*> &particles) const noexcept
+{
+	const auto size = static_cast<uint>(particles.size());
+
+	pool->ParallelFor(0, size, 4096, [&](uint first, uint last)
+	{
+		for (auto k = first; k < last; k++)
+		{
+			if (weights[k] != 0.0f)
+			{
+				particles[k]->SetPosition(GetPosition(k));
+			}
+		}
+	});
+}
+
+//==============================================================================
+
+template <typename Kernel>
+void StencilSolver::Sweep(uint rows, uint period, const Kernel &kernel) noexcept
+{
+	const auto grain = std::max(1u, 1024u / (ny + 1));
+
+	for (uint c = 0; c < std::min(period, rows); c++)
+	{
+		const auto lines = (rows - c + period - 1) / period;
+
+		pool->ParallelFor(0, lines, grain, [&](uint first, uint last)
+		{
+			for (auto line = first; line < last; line++)
+			{
+				kernel(c + line * period);
+			}
+		});
+	}
+}
+
+//==============================================================================
+
+template <uint stride>
+void StencilSolver::ProjectDistances(uint first1, uint first2, const float *rest, uint count, float scale) noexcept
+{
+	ProjectDistanceRow<stride>(&x[first1], &y[first1], &z[first1], &weights[first1],
+	                           &x[first2], &y[first2], &z[first2], &weights[first2], rest, count, scale);
+}
+
+//==============================================================================
+
+void StencilSolver::ProjectBends(uint bend, uint i, float alpha, float inv_mass) noexcept
+{
+	uint di[4];
+	uint dj[4];
+	GetBend(static_cast<Bend>(bend), i, nx, di, dj);
+
+	// a stencil spans at most 3 cells along the row, so these periods keep a color disjoint
+	const auto size = (bend == TOP) ? ny - 1 : ny;
+	const auto period = (bend == TOP) ? 3u : 2u;
+
+	uint first[4];
+	for (uint k = 0; k < 4; k++)
+	{
+		first[k] = GetIndex(i + di[k], dj[k]);
+	}
+
+	BendBlock block;
+
+	for (uint c = 0; c < period; c++)
+	{
+		for (auto j = c; j < size; j += period * BEND_BLOCK)
+		{
+			const auto count = std::min(BEND_BLOCK, (size - j + period - 1) / period);
+
+			for (uint k = 0; k < 4; k++)
+			{
+				for (uint m = 0; m < count; m++)
+				{
+					const auto index = first[k] + j + m * period;
+
+					block.x[k][m] = x[index];
+					block.y[k][m] = y[index];
+					block.z[k][m] = z[index];
+					block.w[k][m] = weights[index];
+				}
+			}
+
+			ProjectBendBlock(block, count, alpha, inv_mass);
+
+			for (uint k = 0; k < 4; k++)
+			{
+				for (uint m = 0; m < count; m++)
+				{
+					const auto index = first[k] + j + m * period;
+
+					x[index] = block.x[k][m];
+					y[index] = block.y[k][m];
+					z[index] = block.z[k][m];
+				}
+			}
+		}
+	}
+}
+
+//==============================================================================
+
+void StencilSolver::SetRestShape(const std::vector<Particle*> &particles) noexcept
+{
+	Gather(particles);
+
+	const auto Length = [this](uint ind1, uint ind2)
+	{
+		const auto L = GetPosition(ind2) - GetPosition(ind1);
+		return std::sqrt(glm::dot(L, L));
+	};
+
+	for (uint i = 0; i < nx + 1; i++)
+	{
+		for (uint j = 0; j < ny + 1; j++)
+		{
+			const auto index = GetIndex(i, j);
+
+			rest_i[index] = (i < nx) ? Length(index, GetIndex(i + 1, j)) : 0.0f;
+			rest_j[index] = (j < ny) ? Length(index, GetIndex(i, j + 1)) : 0.0f;
+			rest_d[index] = 0.0f;
+
+			if ((i < nx) && (j < ny))
+			{
+				rest_d[index] = (i < nx / 2) ? Length(GetIndex(i + 1, j), GetIndex(i, j + 1)) :
+				                               Length(index, GetIndex(i + 1, j + 1));
+			}
+		}
+	}
+}
+
+//==============================================================================
+
+void StencilSolver::SetStiffness(float value) noexcept
+{
+	distance_compliance = 1.0f / value;
+}
+
+//==============================================================================
+
+void StencilSolver::SetBend(float value) noexcept
+{
+	bend_compliance = 1.0f / value;
+}
+
+//==============================================================================
+
+void StencilSolver::ProjectDistanceConstraints(const std::vector<Particle*> &particles, float dt, float inv_mass) noexcept
+{
+	Gather(particles);
+	resident = true;
+
+	const auto alpha = distance_compliance / (dt * dt);
+	const auto scale = -inv_mass / (inv_mass + inv_mass + alpha);
+
+	// along the rows, even pairs then odd ones
+	Sweep(nx + 1, 1, [&](uint i)
+	{
+		const auto index = GetIndex(i, 0);
+
+		ProjectDistances<2>(index, index + 1, &rest_j[index], (ny + 1) / 2, scale);
+		ProjectDistances<2>(index + 1, index + 2, &rest_j[index + 1], ny / 2, scale);
+	});
+
+	// across the rows, then the cell diagonals
+	Sweep(nx, 2, [&](uint i)
+	{
+		const auto index = GetIndex(i, 0);
+		ProjectDistances<1>(index, index + (ny + 1), &rest_i[index], ny + 1, scale);
+	});
+
+	Sweep(nx, 2, [&](uint i)
+	{
+		const auto index = GetIndex(i, 0);
+		if (i < nx / 2)
+		{
+			ProjectDistances<1>(index + (ny + 1), index + 1, &rest_d[index], ny, scale);
+		}
+		else
+		{
+			ProjectDistances<1>(index, index + (ny + 1) + 1, &rest_d[index], ny, scale);
+		}
+	});
+}
+
+//==============================================================================
+
+void StencilSolver::ProjectBendConstraints(const std::vector<Particle*> &particles, float dt, float inv_mass) noexcept
+{
+	if (!resident)
+	{
+		Gather(particles);
+	}
+
+	const auto alpha = bend_compliance / (dt * dt);
+
+	Sweep(nx, 2, [&](uint i)
+	{
+		ProjectBends(DIAGONAL, i, alpha, inv_mass);
+	});
+
+	if (ny > 1)
+	{
+		Sweep(nx, 2, [&](uint i)
+		{
+			ProjectBends(TOP, i, alpha, inv_mass);
+		});
+	}
+
+	Sweep((nx > 0) ? nx - 1 : 0, 3, [&](uint i)
+	{
+		ProjectBends(RIGHT, i, alpha, inv_mass);
+	});
+
+	Scatter(particles);
+	resident = false;
+}
+
+//==============================================================================
+
+void StencilSolver::GetStencils(std::vector<uint> &distances, std::vector<uint> &bends) const noexcept
+{
+	distances.clear();
+	bends.clear();
+
+	const auto Add = [&](uint i1, uint j1, uint i2, uint j2)
+	{
+		distances.push_back(GetIndex(i1, j1));
+		distances.push_back(GetIndex(i2, j2));
+	};
+
+	for (uint i = 0; i < nx + 1; i++)
+	{
+		for (uint j = 0; j < ny + 1; j++)
+		{
+			if (j < ny)
+			{
+				Add(i, j, i, j + 1);
+			}
+
+			if (i < nx)
+			{
+				Add(i, j, i + 1, j);
+			}
+
+			if ((i < nx) && (j < ny))
+			{
+				if (i < nx / 2)
+				{
+					Add(i + 1, j, i, j + 1);
+				}
+				else
+				{
+					Add(i, j, i + 1, j + 1);
+				}
+			}
+		}
+	}
+
+	for (const auto bend : { DIAGONAL, TOP, RIGHT })
+	{
+		const auto rows = (bend == RIGHT) ? ((nx > 0) ? nx - 1 : 0) : nx;
+		const auto size = (bend == TOP) ? ((ny > 0) ? ny - 1 : 0) : ny;
+
+		for (uint i = 0; i < rows; i++)
+		{
+			uint di[4];
+			uint dj[4];
+			GetBend(bend, i, nx, di, dj);
+
+			for (uint j = 0; j < size; j++)
+			{
+				for (uint k = 0; k < 4; k++)
+				{
+					bends.push_back(GetIndex(i + di[k], j + dj[k]));
+				}
+			}
+		}
+	}
+}
+
+//==============================================================================
+
+void StencilSolver::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "positions", MemoryReport::GetBytes(x) + MemoryReport::GetBytes(y) + MemoryReport::GetBytes(z));
+	report.Add(prefix + "weights", MemoryReport::GetBytes(weights));
+	report.Add(prefix + "rest", MemoryReport::GetBytes(rest_i) + MemoryReport::GetBytes(rest_j) + MemoryReport::GetBytes(rest_d));
+}
+
+//==============================================================================
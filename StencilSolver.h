@@ -0,0 +1,83 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class MemoryReport;
+class Particle;
+class ThreadPool;
+
+//==============================================================================
+
+// XPBD projection for the regular nx * ny grid built by Cloth (see Topology).
+// Particles are copied into rows of (ny + 1) floats per coordinate and the
+// distance and bend constraints are implicit stencils of the (i, j) cell.
+// Each stencil is swept in colors whose members share no particle, so the
+// rows of one color are projected in parallel and each row is a contiguous,
+// vectorizable loop. The copy stays resident from the distance phase to the
+// end of the bend phase, which writes it back: the two are called in a pair
+// every substep, as Cloth does.
+class StencilSolver
+{
+private:
+	ThreadPool *pool;
+
+	uint nx;
+	uint ny;
+
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> weights; // 0 for fixed particles
+
+	std::vector<float> rest_i; // (i, j)-(i + 1, j)
+	std::vector<float> rest_j; // (i, j)-(i, j + 1)
+	std::vector<float> rest_d; // diagonal of cell (i, j)
+
+	float distance_compliance;
+	float bend_compliance;
+
+	bool resident; // x, y, z hold the distance phase result, not yet scattered
+
+private:
+	uint GetIndex(uint i, uint j) const noexcept;
+
+	glm::vec3 GetPosition(uint index) const noexcept;
+
+	void Gather(const std::vector<Particle*> &particles) noexcept;
+	void Scatter(const std::vector<Particle*> &particles) const noexcept;
+
+	template <typename Kernel>
+	void Sweep(uint rows, uint period, const Kernel &kernel) noexcept;
+
+	template <uint stride>
+	void ProjectDistances(uint first1, uint first2, const float *rest, uint count, float scale) noexcept;
+	void ProjectBends(uint bend, uint i, float alpha, float inv_mass) noexcept;
+
+public:
+	StencilSolver(uint nx, uint ny, ThreadPool &pool) noexcept;
+
+	void SetRestShape(const std::vector<Particle*> &particles) noexcept;
+	void SetStiffness(float value) noexcept;
+	void SetBend(float value) noexcept;
+
+	void ProjectDistanceConstraints(const std::vector<Particle*> &particles, float dt, float inv_mass) noexcept;
+	void ProjectBendConstraints(const std::vector<Particle*> &particles, float dt, float inv_mass) noexcept;
+
+	// particle indices the stencils cover: pairs for the distance constraints and
+	// (ind1, ind2, ind3, ind4) for the bend ones, as Topology gives them
+	void GetStencils(std::vector<uint> &distances, std::vector<uint> &bends) const noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+};
+
+//==============================================================================
@@ -0,0 +1,362 @@
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#include "Trace.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+//==============================================================================
+
+namespace
+{
+	// the pool and queue of the calling thread while it runs jobs of that pool
+	thread_local const ThreadPool *current_pool = nullptr;
+	thread_local uint current_index = 0;
+
+	constexpr uint spins = 64;
+
+	void Pin(std::thread &thread, uint core) noexcept
+	{
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(core % CPU_SETSIZE, &set);
+		pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#elif defined(_WIN32)
+		SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(1) << (core % (8 * sizeof(DWORD_PTR))));
+#else
+		(void)thread;
+		(void)core;
+#endif
+	}
+}
+
+//==============================================================================
+
+void ThreadPool::Run(uint index) noexcept
+{
+	current_pool = this;
+	current_index = index;
+
+	TRACE_THREAD("worker");
+	PERF_THREAD();
+
+	for (;;)
+	{
+		for (uint spin = 0; spin < spins; spin++)
+		{
+			Job job;
+			if (Pop(index, job) || Steal(index, job))
+			{
+				TRACE_SCOPE("thread_pool.work");
+				Execute(index, job);
+				spin = 0;
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		sleeping++;
+		wake.wait(lock, [&]() { return stop || (queued.load() != 0); });
+		sleeping--;
+
+		if (stop)
+		{
+			return;
+		}
+	}
+}
+
+//==============================================================================
+
+bool ThreadPool::Push(uint index, const Job &job) noexcept
+{
+	auto &queue = queues[index];
+
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.tail - queue.head == queue_size)
+		{
+			return false;
+		}
+
+		queue.jobs[queue.tail++ % queue_size] = job;
+	}
+
+	queued++;
+
+	if (sleeping.load() != 0)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		wake.notify_one();
+	}
+
+	return true;
+}
+
+//==============================================================================
+
+bool ThreadPool::Pop(uint index, Job &job) noexcept
+{
+	auto &queue = queues[index];
+
+	std::lock_guard<std::mutex> lock(queue.mutex);
+
+	if (queue.tail == queue.head)
+	{
+		return false;
+	}
+
+	job = queue.jobs[--queue.tail % queue_size];
+	queued--;
+
+	return true;
+}
+
+//==============================================================================
+
+bool ThreadPool::Steal(uint index, Job &job) noexcept
+{
+	for (uint k = 1; k < threads; k++)
+	{
+		auto &queue = queues[(index + k) % threads];
+
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.tail != queue.head)
+		{
+			job = queue.jobs[queue.head++ % queue_size];
+			queued--;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//==============================================================================
+
+void ThreadPool::Execute(uint index, Job job) noexcept
+{
+	// halves on multiples of the grain, so the chunks do not depend on who runs them
+
+	while (job.last - job.first > job.grain)
+	{
+		const auto grains = (job.last - job.first + job.grain - 1) / job.grain;
+
+		auto upper = job;
+		upper.first = job.first + (grains / 2) * job.grain;
+
+		if (!Push(index, upper))
+		{
+			break;
+		}
+
+		job.last = upper.first;
+	}
+
+	// charged before the caller can see the job done
+	{
+		PERF_TASK(job.counters);
+		job.run(job.function, job.first, job.last);
+	}
+
+	job.pending->fetch_sub(job.last - job.first);
+}
+
+//==============================================================================
+
+void ThreadPool::Wait(uint index, const std::atomic<uint> &pending) noexcept
+{
+	while (pending.load() != 0)
+	{
+		Job job;
+		if (Pop(index, job) || Steal(index, job))
+		{
+			Execute(index, job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+//==============================================================================
+
+void ThreadPool::Submit(const Job &job, Function run, const void *function) noexcept
+{
+	// outside callers take turns on queue 0, nested calls stay on the queue of their thread
+
+	std::unique_lock<std::mutex> lock(dispatch, std::defer_lock);
+
+	const auto pool = current_pool;
+	const auto index = current_index;
+
+	if (pool != this)
+	{
+		lock.lock();
+
+		current_pool = this;
+		current_index = 0;
+	}
+
+	if (run)
+	{
+		if (!Push(current_index, job))
+		{
+			Execute(current_index, job);
+		}
+
+		run(function, 0, 1);
+	}
+	else
+	{
+		Execute(current_index, job);
+	}
+
+	Wait(current_index, *job.pending);
+
+	current_pool = pool;
+	current_index = index;
+}
+
+//==============================================================================
+
+void ThreadPool::Dispatch(uint begin, uint end, uint grain, Function run, const void *function) noexcept
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	grain = std::max(grain, 1u);
+
+	if (workers.empty() || (end - begin <= grain))
+	{
+		run(function, begin, end);
+		return;
+	}
+
+	std::atomic<uint> pending(end - begin);
+	Submit({ run, function, begin, end, grain, &pending, PerfCounters::GetScope() }, nullptr, nullptr);
+}
+
+//==============================================================================
+
+void ThreadPool::Join(Function run_first, const void *first, Function run_second, const void *second) noexcept
+{
+	if (workers.empty())
+	{
+		run_first(first, 0, 1);
+		run_second(second, 0, 1);
+		return;
+	}
+
+	std::atomic<uint> pending(1);
+	Submit({ run_second, second, 0, 1, 1, &pending, PerfCounters::GetScope() }, run_first, first);
+}
+
+//==============================================================================
+
+void ThreadPool::Stop() noexcept
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+
+	wake.notify_all();
+
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+
+	workers.clear();
+
+	delete[] queues;
+	queues = nullptr;
+
+	stop = false;
+}
+
+//==============================================================================
+
+ThreadPool::ThreadPool(uint threads, bool pinned) noexcept :
+	queues(nullptr),
+	threads(0),
+	pinned(false),
+	queued(0),
+	sleeping(0),
+	stop(false)
+{
+	Start(threads, pinned);
+}
+
+//==============================================================================
+
+ThreadPool::~ThreadPool() noexcept
+{
+	Stop();
+}
+
+//==============================================================================
+
+void ThreadPool::Start(uint threads, bool pinned) noexcept
+{
+	Stop();
+
+	const auto cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+	this->threads = threads ? threads : cores;
+	this->pinned = pinned;
+
+	queues = new Queue[this->threads];
+	for (uint i = 0; i < this->threads; i++)
+	{
+		queues[i].head = 0;
+		queues[i].tail = 0;
+	}
+
+	workers.reserve(this->threads - 1);
+	for (uint i = 1; i < this->threads; i++)
+	{
+		workers.emplace_back(&ThreadPool::Run, this, i);
+
+		if (pinned)
+		{
+			Pin(workers.back(), i % cores);
+		}
+	}
+}
+
+//==============================================================================
+
+uint ThreadPool::GetThreadCount() const noexcept
+{
+	return threads;
+}
+
+//==============================================================================
+
+bool ThreadPool::IsPinned() const noexcept
+{
+	return pinned;
+}
+
+//==============================================================================
@@ -0,0 +1,122 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "PerfCounters.h"
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+//==============================================================================
+
+// Work-stealing pool. Every thread has a queue of jobs: it pushes and pops at
+// the back and idle threads steal from the front. A parallel loop starts as
+// one job that keeps halving its range, down to the grain, pushing the upper
+// halves for others to steal, so loops nested inside jobs spread over the
+// pool instead of running serially. A thread that waits for its jobs runs
+// queued work meanwhile. Threads from outside the pool share queue 0 in turn.
+class ThreadPool
+{
+public:
+	static constexpr uint queue_size = 256;
+
+private:
+	typedef void (*Function)(const void *function, uint first, uint last);
+
+	struct Job
+	{
+		Function run;
+		const void *function;
+		uint first;
+		uint last;
+		uint grain;
+		std::atomic<uint> *pending; // indices left to run
+		PerfCounters::Scope *counters; // scope of the caller, charged with the job
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		Job jobs[queue_size];
+		uint head;
+		uint tail;
+	};
+
+private:
+	std::vector<std::thread> workers;
+	Queue *queues; // 0 for callers outside the pool, then one per worker
+	uint threads;
+	bool pinned;
+
+	std::mutex dispatch;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::atomic<uint> queued;
+	std::atomic<uint> sleeping;
+	bool stop;
+
+private:
+	void Run(uint index) noexcept;
+
+	bool Push(uint index, const Job &job) noexcept;
+	bool Pop(uint index, Job &job) noexcept;
+	bool Steal(uint index, Job &job) noexcept;
+
+	void Execute(uint index, Job job) noexcept;
+	void Wait(uint index, const std::atomic<uint> &pending) noexcept;
+
+	void Submit(const Job &job, Function run, const void *function) noexcept;
+	void Dispatch(uint begin, uint end, uint grain, Function run, const void *function) noexcept;
+	void Join(Function run_first, const void *first, Function run_second, const void *second) noexcept;
+
+	void Stop() noexcept;
+
+	template <typename Function>
+	static void RunRange(const void *function, uint first, uint last)
+	{
+		(*static_cast<const Function*>(function))(first, last);
+	}
+
+	template <typename Function>
+	static void RunCall(const void *function, uint, uint)
+	{
+		(*static_cast<const Function*>(function))();
+	}
+
+public:
+	// 0 threads for one per hardware thread, pinned puts worker i on core i
+	explicit ThreadPool(uint threads = 0, bool pinned = false) noexcept;
+	ThreadPool(const ThreadPool &) = delete;
+	~ThreadPool() noexcept;
+
+	// restarts the workers, must not be called while the pool is running jobs
+	void Start(uint threads, bool pinned) noexcept;
+
+	uint GetThreadCount() const noexcept;
+	bool IsPinned() const noexcept;
+
+	// function(first, last) over chunks of [begin, end) starting at multiples of grain from begin;
+	// the callable is referenced, not copied, so nothing is allocated
+	template <typename Function>
+	void ParallelFor(uint begin, uint end, uint grain, const Function &function) noexcept
+	{
+		Dispatch(begin, end, grain, &RunRange<Function>, &function);
+	}
+
+	// runs first() and second() in parallel and returns when both are done
+	template <typename First, typename Second>
+	void Invoke(const First &first, const Second &second) noexcept
+	{
+		Join(&RunCall<First>, &first, &RunCall<Second>, &second);
+	}
+};
+
+//==============================================================================
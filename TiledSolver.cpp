@@ -0,0 +1,464 @@
+
+#include "TiledSolver.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <unordered_map>
+
+#include "Constraint.h"
+#include "MemoryReport.h"
+#include "Particle.h"
+#include "ThreadPool.h"
+
+//==============================================================================
+
+namespace
+{
+	constexpr uint max_colors = 64; // of the boundary constraints, bits of a mask
+
+	// interleaves the low 10 bits of value with two zero bits between each
+	uint Spread(uint value) noexcept
+	{
+		value &= 0x3ff;
+		value = (value | (value << 16)) & 0x030000ff;
+		value = (value | (value <<  8)) & 0x0300f00f;
+		value = (value | (value <<  4)) & 0x030c30c3;
+		value = (value | (value <<  2)) & 0x09249249;
+		return value;
+	}
+
+	// splits constraints into per tile runs of entries and the boundary entries;
+	// get_local(constraint, tile) returns the entry and sets tile to tiles if it straddles tiles
+	template <typename Constraint, typename GetLocal, typename Entry>
+	void Partition(const std::vector<Constraint> &constraints, uint tiles, const GetLocal &get_local,
+	               std::vector<uint> &offsets, std::vector<Entry> &interior, std::vector<Entry> &boundary) noexcept
+	{
+		std::vector<std::vector<Entry>> lists(tiles);
+
+		for (uint k = 0; k < static_cast<uint>(constraints.size()); k++)
+		{
+			uint tile;
+			const auto entry = get_local(constraints[k], tile);
+
+			if (tile < tiles)
+			{
+				lists[tile].push_back(entry);
+			}
+			else
+			{
+				boundary.push_back(entry);
+			}
+		}
+
+		offsets.assign(1, 0);
+		for (const auto &list : lists)
+		{
+			interior.insert(interior.end(), list.begin(), list.end());
+			offsets.push_back(static_cast<uint>(interior.size()));
+		}
+	}
+
+	// Orders constraints [first, last) of entries, whose slots lie in [base, base + size),
+	// by a greedy coloring in which no two of a color share a particle;
+	// offsets[c] is the first constraint of color c, counted from first.
+	// get_slots(entry, slots) writes the slots of a constraint and returns
+	// their count. Constraints left without a free color share the last one.
+	template <typename Entry, typename GetSlots>
+	void Color(std::vector<Entry> &entries, uint first, uint last, uint base, uint size,
+	           const GetSlots &get_slots, std::vector<uint> &offsets) noexcept
+	{
+		std::vector<unsigned long long> used(size, 0);
+		std::vector<uint> colors(last - first);
+
+		uint count = 0;
+		for (uint k = 0; k < last - first; k++)
+		{
+			uint slots[4];
+			const auto n = get_slots(entries[first + k], slots);
+
+			unsigned long long mask = 0;
+			for (uint i = 0; i < n; i++)
+			{
+				slots[i] -= base;
+				mask |= used[slots[i]];
+			}
+
+			uint color = 0;
+			while ((color < max_colors - 1) && (mask & (1ull << color)))
+			{
+				color++;
+			}
+
+			for (uint i = 0; i < n; i++)
+			{
+				used[slots[i]] |= 1ull << color;
+			}
+
+			colors[k] = color;
+			count = std::max(count, color + 1);
+		}
+
+		offsets.assign(count + 1, 0);
+		for (const auto color : colors)
+		{
+			offsets[color + 1]++;
+		}
+
+		for (uint c = 0; c < count; c++)
+		{
+			offsets[c + 1] += offsets[c];
+		}
+
+		std::vector<Entry> sorted(last - first);
+		std::vector<uint> cursors(offsets.begin(), offsets.end() - 1);
+
+		for (uint k = 0; k < last - first; k++)
+		{
+			sorted[cursors[colors[k]]++] = entries[first + k];
+		}
+
+		std::copy(sorted.begin(), sorted.end(), entries.begin() + first);
+	}
+}
+
+//==============================================================================
+
+TiledSolver::TiledSolver(const std::vector<Particle*> &particles,
+                         const std::vector<DistanceConstraint> &distance_constraints,
+                         const std::vector<BendConstraint> &bend_constraints, ThreadPool &pool) noexcept :
+	pool(&pool),
+	resident(false)
+{
+	const auto size = static_cast<uint>(particles.size());
+
+	// Tiles are runs of the particles in Morton order of their current positions.
+	// One scale for all axes keeps the cells cubic, so a thin axis such as the
+	// noise of a flat sheet does not decide the order.
+
+	glm::vec3 min(0.0f);
+	glm::vec3 max(0.0f);
+
+	for (uint i = 0; i < size; i++)
+	{
+		const auto &P = particles[i]->GetPosition();
+
+		min = (i == 0) ? P : glm::min(min, P);
+		max = (i == 0) ? P : glm::max(max, P);
+	}
+
+	const auto extent = max - min;
+	const auto scale = 1023.0f / std::max(std::max(std::max(extent.x, extent.y), extent.z), 1e-30f);
+
+	std::vector<std::pair<uint, uint>> codes(size);
+	for (uint i = 0; i < size; i++)
+	{
+		const auto cell = (particles[i]->GetPosition() - min) * scale;
+		const auto code = Spread(static_cast<uint>(cell.x)) |
+		                 (Spread(static_cast<uint>(cell.y)) << 1) |
+		                 (Spread(static_cast<uint>(cell.z)) << 2);
+
+		codes[i] = std::make_pair(code, i);
+	}
+
+	std::sort(codes.begin(), codes.end());
+
+	// within a tile the particles keep their own order, so gathering a tile
+	// reads runs of neighbouring particles instead of hopping between them
+	for (uint first = 0; first < size; first += tile_size)
+	{
+		std::sort(codes.begin() + first, codes.begin() + std::min(first + tile_size, size),
+		          [](const std::pair<uint, uint> &a, const std::pair<uint, uint> &b)
+		{
+			return a.second < b.second;
+		});
+	}
+
+	std::unordered_map<const Particle*, uint> slots;
+	slots.reserve(size);
+
+	tile_particles.resize(size);
+	for (uint slot = 0; slot < size; slot++)
+	{
+		tile_particles[slot] = codes[slot].second;
+		slots[particles[codes[slot].second]] = slot;
+	}
+
+	const auto tiles = (size + tile_size - 1) / tile_size;
+
+	tile_offsets.resize(tiles + 1);
+	for (uint tile = 0; tile <= tiles; tile++)
+	{
+		tile_offsets[tile] = std::min(tile * tile_size, size);
+	}
+
+	positions.resize(size);
+	weights.resize(size);
+
+	// the tile of a constraint, or tiles if its particles are in different tiles
+	const auto GetTile = [tiles](std::initializer_list<uint> ind)
+	{
+		const auto tile = *ind.begin() / tile_size;
+		for (const auto i : ind)
+		{
+			if (i / tile_size != tile)
+			{
+				return tiles;
+			}
+		}
+
+		return tile;
+	};
+
+	Partition(distance_constraints, tiles, [&](const DistanceConstraint &constraint, uint &tile)
+	{
+		const auto ind1 = slots[constraint.GetParticle1()];
+		const auto ind2 = slots[constraint.GetParticle2()];
+
+		tile = GetTile({ ind1, ind2 });
+		return Distance{ ind1, ind2, constraint.GetDistance(), constraint.GetCompliance() };
+	}, distance_offsets, distances, boundary_distances);
+
+	Partition(bend_constraints, tiles, [&](const BendConstraint &constraint, uint &tile)
+	{
+		const auto ind1 = slots[constraint.GetParticle1()];
+		const auto ind2 = slots[constraint.GetParticle2()];
+		const auto ind3 = slots[constraint.GetParticle3()];
+		const auto ind4 = slots[constraint.GetParticle4()];
+
+		tile = GetTile({ ind1, ind2, ind3, ind4 });
+		return Bend{ ind1, ind2, ind3, ind4, constraint.GetAngle(), constraint.GetCompliance() };
+	}, bend_offsets, bends, boundary_bends);
+
+	// each color then walks the slots in order
+	std::sort(boundary_distances.begin(), boundary_distances.end(), [](const Distance &a, const Distance &b)
+	{
+		return std::min(a.ind1, a.ind2) < std::min(b.ind1, b.ind2);
+	});
+
+	std::sort(boundary_bends.begin(), boundary_bends.end(), [](const Bend &a, const Bend &b)
+	{
+		return std::min(a.ind1, a.ind2) < std::min(b.ind1, b.ind2);
+	});
+
+	const auto GetDistanceSlots = [](const Distance &constraint, uint *ind)
+	{
+		ind[0] = constraint.ind1;
+		ind[1] = constraint.ind2;
+		return 2u;
+	};
+
+	const auto GetBendSlots = [](const Bend &constraint, uint *ind)
+	{
+		ind[0] = constraint.ind1;
+		ind[1] = constraint.ind2;
+		ind[2] = constraint.ind3;
+		ind[3] = constraint.ind4;
+		return 4u;
+	};
+
+	Color(boundary_distances, 0, static_cast<uint>(boundary_distances.size()), 0, size,
+	      GetDistanceSlots, boundary_distance_offsets);
+	Color(boundary_bends, 0, static_cast<uint>(boundary_bends.size()), 0, size,
+	      GetBendSlots, boundary_bend_offsets);
+
+	// Inside a tile the colors only order the sweep: constraints that follow
+	// each other share no particle, so their projections overlap in the
+	// pipeline instead of waiting on the previous one.
+	std::vector<uint> colors;
+	for (uint tile = 0; tile < tiles; tile++)
+	{
+		const auto base = tile_offsets[tile];
+		const auto count = tile_offsets[tile + 1] - base;
+
+		Color(distances, distance_offsets[tile], distance_offsets[tile + 1], base, count, GetDistanceSlots, colors);
+		Color(bends, bend_offsets[tile], bend_offsets[tile + 1], base, count, GetBendSlots, colors);
+	}
+}
+
+//==============================================================================
+
+void TiledSolver::Gather(const std::vector<Particle*> &particles) noexcept
+{
+	pool->ParallelFor(0, static_cast<uint>(tile_particles.size()), 4096, [&](uint first, uint last)
+	{
+		for (auto slot = first; slot < last; slot++)
+		{
+			const auto particle = particles[tile_particles[slot]];
+
+			positions[slot] = particle->GetPosition();
+			weights[slot] = particle->IsFixed() ? 0.0f : 1.0f;
+		}
+	});
+}
+
+//==============================================================================
+
+void TiledSolver::Scatter(const std::vector<Particle*> &particles) const noexcept
+{
+	pool->ParallelFor(0, static_cast<uint>(tile_particles.size()), 4096, [&](uint first, uint last)
+	{
+		for (auto slot = first; slot < last; slot++)
+		{
+			if (weights[slot] != 0.0f)
+			{
+				particles[tile_particles[slot]]->SetPosition(positions[slot]);
+			}
+		}
+	});
+}
+
+//==============================================================================
+
+void TiledSolver::Move(uint slot, const glm::vec3 &step) noexcept
+{
+	positions[slot] += weights[slot] * step;
+}
+
+//==============================================================================
+
+void TiledSolver::Project(const Distance &constraint, float dt, float inv_mass) noexcept
+{
+	const auto alpha = constraint.compliance / (dt * dt);
+
+	const auto dp = DistanceConstraint::GetCorrection(positions[constraint.ind1], positions[constraint.ind2],
+	                                                  constraint.distance, alpha, inv_mass);
+
+	Move(constraint.ind1, +dp);
+	Move(constraint.ind2, -dp);
+}
+
+//==============================================================================
+
+void TiledSolver::Project(const Bend &constraint, float dt, float inv_mass) noexcept
+{
+	const auto alpha = constraint.compliance / (dt * dt);
+
+	glm::vec3 dp[4];
+	if (BendConstraint::GetCorrection(positions[constraint.ind1], positions[constraint.ind2],
+	                                  positions[constraint.ind3], positions[constraint.ind4],
+	                                  constraint.angle, alpha, inv_mass, dp))
+	{
+		Move(constraint.ind1, dp[0]);
+		Move(constraint.ind2, dp[1]);
+		Move(constraint.ind3, dp[2]);
+		Move(constraint.ind4, dp[3]);
+	}
+}
+
+//==============================================================================
+
+template <typename Entry>
+void TiledSolver::ProjectRuns(const std::vector<uint> &offsets, const std::vector<Entry> &constraints,
+                              bool colored, float dt, float inv_mass) noexcept
+{
+	const auto runs = static_cast<uint>(offsets.size() - 1);
+
+	if (colored)
+	{
+		for (uint c = 0; c < runs; c++)
+		{
+			// a full last color may share particles, so it runs as one task
+			const auto serial = (c == max_colors - 1);
+			const auto grain = serial ? offsets[c + 1] - offsets[c] : 1024u;
+
+			pool->ParallelFor(offsets[c], offsets[c + 1], grain, [&](uint first, uint last)
+			{
+				for (auto k = first; k < last; k++)
+				{
+					Project(constraints[k], dt, inv_mass);
+				}
+			});
+		}
+
+		return;
+	}
+
+	pool->ParallelFor(0, runs, 1, [&](uint first, uint last)
+	{
+		for (auto k = offsets[first]; k < offsets[last]; k++)
+		{
+			Project(constraints[k], dt, inv_mass);
+		}
+	});
+}
+
+//==============================================================================
+
+void TiledSolver::SetStiffness(float value) noexcept
+{
+	for (auto &distance : distances)
+	{
+		distance.compliance = 1.0f / value;
+	}
+
+	for (auto &distance : boundary_distances)
+	{
+		distance.compliance = 1.0f / value;
+	}
+}
+
+//==============================================================================
+
+void TiledSolver::SetBend(float value) noexcept
+{
+	for (auto &bend : bends)
+	{
+		bend.compliance = 1.0f / value;
+	}
+
+	for (auto &bend : boundary_bends)
+	{
+		bend.compliance = 1.0f / value;
+	}
+}
+
+//==============================================================================
+
+void TiledSolver::ProjectDistanceConstraints(const std::vector<Particle*> &particles, float dt, float inv_mass) noexcept
+{
+	Gather(particles);
+	resident = true;
+
+	ProjectRuns(distance_offsets, distances, false, dt, inv_mass);
+	ProjectRuns(boundary_distance_offsets, boundary_distances, true, dt, inv_mass);
+}
+
+//==============================================================================
+
+void TiledSolver::ProjectBendConstraints(const std::vector<Particle*> &particles, float dt, float inv_mass) noexcept
+{
+	if (!resident)
+	{
+		Gather(particles);
+	}
+
+	ProjectRuns(bend_offsets, bends, false, dt, inv_mass);
+	ProjectRuns(boundary_bend_offsets, boundary_bends, true, dt, inv_mass);
+
+	Scatter(particles);
+	resident = false;
+}
+
+//==============================================================================
+
+float TiledSolver::GetInteriorRatio() const noexcept
+{
+	const auto interior = distances.size() + bends.size();
+	const auto boundary = boundary_distances.size() + boundary_bends.size();
+
+	return (interior + boundary > 0) ? static_cast<float>(interior) / static_cast<float>(interior + boundary) : 1.0f;
+}
+
+//==============================================================================
+
+void TiledSolver::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "tiles", MemoryReport::GetBytes(tile_offsets) + MemoryReport::GetBytes(tile_particles));
+	report.Add(prefix + "positions", MemoryReport::GetBytes(positions) + MemoryReport::GetBytes(weights));
+	report.Add(prefix + "distances", MemoryReport::GetBytes(distance_offsets) + MemoryReport::GetBytes(distances) +
+	                                 MemoryReport::GetBytes(boundary_distance_offsets) + MemoryReport::GetBytes(boundary_distances));
+	report.Add(prefix + "bends", MemoryReport::GetBytes(bend_offsets) + MemoryReport::GetBytes(bends) +
+	                             MemoryReport::GetBytes(boundary_bend_offsets) + MemoryReport::GetBytes(boundary_bends));
+}
+
+//==============================================================================
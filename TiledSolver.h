@@ -0,0 +1,110 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class BendConstraint;
+class DistanceConstraint;
+class MemoryReport;
+class Particle;
+class ThreadPool;
+
+//==============================================================================
+
+// XPBD projection over tiles of spatially close particles. The particles are
+// copied in Morton order into one contiguous block, and every constraint is
+// kept with the slots of its particles. A constraint whose particles all belong
+// to one tile is interior: the tiles project their interior constraints in
+// parallel while the tile is hot in cache, ordered by colors so consecutive
+// constraints share no particle and overlap in the pipeline. The remaining boundary constraints
+// are projected afterwards, which reconciles neighbouring tiles; they are
+// greedily colored so the constraints of one color share no particle and run
+// in parallel. Each constraint is projected once per phase, as in XPBD.
+// The copy stays resident from the distance phase to the end of the bend
+// phase, which writes it back: the two are called in a pair every substep.
+class TiledSolver
+{
+public:
+	static constexpr uint tile_size = 1024; // particles, so a tile with its constraints fits in L2
+
+private:
+	struct Distance
+	{
+		uint ind1;
+		uint ind2;
+		float distance;
+		float compliance;
+	};
+
+	struct Bend
+	{
+		uint ind1;
+		uint ind2;
+		uint ind3;
+		uint ind4;
+		float angle;
+		float compliance;
+	};
+
+private:
+	ThreadPool *pool;
+
+	bool resident; // positions hold the distance phase result, not yet scattered
+
+	std::vector<uint> tile_offsets;
+	std::vector<uint> tile_particles; // particle of each slot, tiles are contiguous
+	std::vector<glm::vec3> positions; // per slot
+	std::vector<float> weights;       // per slot, 0 for fixed particles
+
+	std::vector<uint> distance_offsets;
+	std::vector<Distance> distances; // interior constraints, per tile
+	std::vector<uint> boundary_distance_offsets; // per color, the last color may share particles
+	std::vector<Distance> boundary_distances;
+
+	std::vector<uint> bend_offsets;
+	std::vector<Bend> bends;
+	std::vector<uint> boundary_bend_offsets;
+	std::vector<Bend> boundary_bends;
+
+private:
+	void Gather(const std::vector<Particle*> &particles) noexcept;
+	void Scatter(const std::vector<Particle*> &particles) const noexcept;
+
+	void Move(uint slot, const glm::vec3 &step) noexcept;
+
+	void Project(const Distance &constraint, float dt, float inv_mass) noexcept;
+	void Project(const Bend &constraint, float dt, float inv_mass) noexcept;
+
+	// projects constraints [offsets[i], offsets[i + 1]) of every tile or color i,
+	// in parallel, or as one task for the shared last color
+	template <typename Entry>
+	void ProjectRuns(const std::vector<uint> &offsets, const std::vector<Entry> &constraints,
+	                 bool colored, float dt, float inv_mass) noexcept;
+
+public:
+	TiledSolver(const std::vector<Particle*> &particles,
+	            const std::vector<DistanceConstraint> &distance_constraints,
+	            const std::vector<BendConstraint> &bend_constraints, ThreadPool &pool) noexcept;
+
+	void SetStiffness(float value) noexcept;
+	void SetBend(float value) noexcept;
+
+	void ProjectDistanceConstraints(const std::vector<Particle*> &particles, float dt, float inv_mass) noexcept;
+	void ProjectBendConstraints(const std::vector<Particle*> &particles, float dt, float inv_mass) noexcept;
+
+	// share of the distance and bend constraints that are interior to a tile
+	float GetInteriorRatio() const noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+};
+
+//==============================================================================
@@ -1,6 +1,13 @@
 
 #include "Topology.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "MemoryReport.h"
+#include "ThreadPool.h"
+
 //==============================================================================
 
 uint GetIndex(const std::vector<uint> &indices, uint triangle, uint ind1, uint ind2)
@@ -26,68 +33,565 @@ uint GetIndex(const std::vector<uint> &indices, uint triangle, uint ind1, uint i
 
 //==============================================================================
 
-Topology::Topology(uint vertices_size, const std::vector<uint> &indices) noexcept
+namespace
 {
-	edges.clear();
-	vertices_vertices_edges.resize(vertices_size);
+	constexpr uint block_size = 1 << 16;
+	constexpr uint max_blocks = 64;
 
-	for (uint i = 0; i < indices.size(); i += 3)
+	uint GetBlocks(uint size) noexcept
 	{
-		for (uint j = 0; j < 3; j++)
-		{
-			const auto ind1 = indices[i + j];
-			const auto ind2 = indices[i + (j + 1) % 3];
+		return std::max(std::min((size + block_size - 1) / block_size, max_blocks), 1u);
+	}
 
-			auto &edges1 = vertices_vertices_edges[ind1];
-			auto &edges2 = vertices_vertices_edges[ind2];
+	// next corner of the same triangle, so slot s is the half-edge (s, Next(s))
+	uint Next(uint slot) noexcept
+	{
+		return (slot % 3 == 2) ? slot - 2 : slot + 1;
+	}
+
+	// in-place exclusive prefix sum, returns the total
+	uint Scan(std::vector<uint> &values, ThreadPool &pool) noexcept
+	{
+		const auto size = static_cast<uint>(values.size());
+		const auto blocks = GetBlocks(size);
+		const auto step = (size + blocks - 1) / blocks;
 
-			if ((edges1.find(ind2) == edges1.end()) &&
-				(edges2.find(ind1) == edges2.end()))
+		std::vector<uint> sums(blocks + 1, 0);
+
+		pool.ParallelFor(0, blocks, 1, [&](uint first, uint last)
+		{
+			for (auto b = first; b < last; b++)
 			{
-				edges.emplace_back(ind1, ind2);
+				uint sum = 0;
+				for (auto i = b * step; i < std::min((b + 1) * step, size); i++)
+				{
+					sum += values[i];
+				}
 
-				const auto edge = static_cast<uint>(edges.size() - 1);
-				edges1[ind2] = edge;
-				edges2[ind1] = edge;
+				sums[b + 1] = sum;
 			}
+		});
+
+		for (uint b = 0; b < blocks; b++)
+		{
+			sums[b + 1] += sums[b];
 		}
+
+		pool.ParallelFor(0, blocks, 1, [&](uint first, uint last)
+		{
+			for (auto b = first; b < last; b++)
+			{
+				auto sum = sums[b];
+				for (auto i = b * step; i < std::min((b + 1) * step, size); i++)
+				{
+					const auto value = values[i];
+					values[i] = sum;
+					sum += value;
+				}
+			}
+		});
+
+		return sums[blocks];
 	}
 
-	edges_triangles.clear();
-	edges_triangles.resize(edges.size());
+	// Insertion sort for the few entries a vertex usually has, std::sort past
+	// that so a high-valence vertex (the hub of a fan) stays O(d log d).
+	template <typename T>
+	void SortRange(T *begin, T *end) noexcept
+	{
+		if (end - begin > 32)
+		{
+			std::sort(begin, end);
+			return;
+		}
+
+		for (auto i = begin + (begin != end); i < end; i++)
+		{
+			const auto value = *i;
 
-	for (uint i = 0, triangle = 0; i < indices.size(); i += 3, triangle++)
+			auto j = i;
+			for (; (j > begin) && (*(j - 1) > value); j--)
+			{
+				*j = *(j - 1);
+			}
+
+			*j = value;
+		}
+	}
+
+	// Buckets items [0, size) into compressed rows; get_rows(item, rows) writes the
+	// distinct rows of an item (at most three) and returns their count.
+	// Each row lists its items in ascending order.
+	template <typename GetRows>
+	void Bucket(uint rows_size, uint size, const GetRows &get_rows,
+	            std::vector<uint> &offsets, std::vector<uint> &values, ThreadPool &pool) noexcept
 	{
-		const auto ind1 = indices[i + 0];
-		const auto ind2 = indices[i + 1];
-		const auto ind3 = indices[i + 2];
+		std::unique_ptr<std::atomic<uint>[]> cursors(new std::atomic<uint>[rows_size]);
+
+		pool.ParallelFor(0, rows_size, 4096, [&](uint first, uint last)
+		{
+			for (auto r = first; r < last; r++)
+			{
+				cursors[r].store(0, std::memory_order_relaxed);
+			}
+		});
+
+		pool.ParallelFor(0, size, 4096, [&](uint first, uint last)
+		{
+			uint rows[3];
+			for (auto i = first; i < last; i++)
+			{
+				const auto count = get_rows(i, rows);
+				for (uint k = 0; k < count; k++)
+				{
+					cursors[rows[k]].fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+		});
+
+		offsets.assign(rows_size + 1, 0);
+
+		pool.ParallelFor(0, rows_size, 4096, [&](uint first, uint last)
+		{
+			for (auto r = first; r < last; r++)
+			{
+				offsets[r] = cursors[r].load(std::memory_order_relaxed);
+			}
+		});
+
+		values.resize(Scan(offsets, pool));
+
+		pool.ParallelFor(0, rows_size, 4096, [&](uint first, uint last)
+		{
+			for (auto r = first; r < last; r++)
+			{
+				cursors[r].store(offsets[r], std::memory_order_relaxed);
+			}
+		});
 
-		const auto e1 = vertices_vertices_edges[ind1][ind2];
-		const auto e2 = vertices_vertices_edges[ind2][ind3];
-		const auto e3 = vertices_vertices_edges[ind3][ind1];
+		pool.ParallelFor(0, size, 4096, [&](uint first, uint last)
+		{
+			uint rows[3];
+			for (auto i = first; i < last; i++)
+			{
+				const auto count = get_rows(i, rows);
+				for (uint k = 0; k < count; k++)
+				{
+					values[cursors[rows[k]].fetch_add(1, std::memory_order_relaxed)] = i;
+				}
+			}
+		});
 
-		edges_triangles[e1].push_back(triangle);
-		edges_triangles[e2].push_back(triangle);
-		edges_triangles[e3].push_back(triangle);
+		pool.ParallelFor(0, rows_size, 1024, [&](uint first, uint last)
+		{
+			for (auto r = first; r < last; r++)
+			{
+				SortRange(values.data() + offsets[r], values.data() + offsets[r + 1]);
+			}
+		});
 	}
+}
+
+//==============================================================================
+
+void Topology::GenerateVertexAdjacency(uint vertices_size, const std::vector<uint> &indices, ThreadPool &pool) noexcept
+{
+	Bucket(vertices_size, static_cast<uint>(edges.size()), [&](uint edge, uint *rows)
+	{
+		const auto &E = edges[edge];
+
+		rows[0] = E.ind1;
+		rows[1] = E.ind2;
+
+		return (E.ind1 != E.ind2) ? 2u : 1u;
+	}, vertex_edge_offsets, vertex_edges, pool);
 
-	for (uint i = 0; i < edges.size(); i++)
+	Bucket(vertices_size, static_cast<uint>(indices.size() / 3), [&](uint triangle, uint *rows)
 	{
-		auto &edge = edges[i];
-		const auto &triangles = edges_triangles[i];
-		edge.boundary = (triangles.size() <= 1);
-		if (!edge.boundary)
+		const auto i1 = indices[3 * triangle + 0];
+		const auto i2 = indices[3 * triangle + 1];
+		const auto i3 = indices[3 * triangle + 2];
+
+		uint count = 0;
+		rows[count++] = i1;
+		if (i2 != i1)
+		{
+			rows[count++] = i2;
+		}
+		if ((i3 != i1) && (i3 != i2))
 		{
-			const auto t1 = triangles[0];
-			const auto t2 = triangles[1];
+			rows[count++] = i3;
+		}
 
-			const auto ind1 = edge.ind1;
-			const auto ind2 = edge.ind2;
+		return count;
+	}, vertex_triangle_offsets, vertex_triangles, pool);
+}
+
+//==============================================================================
 
-			edge.ind3 = GetIndex(indices, t1, ind1, ind2);
-			edge.ind4 = GetIndex(indices, t2, ind1, ind2);
+Topology::Topology(uint vertices_size, const std::vector<uint> &indices, ThreadPool &pool) noexcept
+{
+	// One slot per half-edge, slot s running from corner s to corner Next(s).
+	// The slots are radix sorted on the packed key (low vertex, high vertex, slot):
+	// a counting pass buckets them by low vertex, and the entries of each bucket
+	// are then ordered by (high vertex, slot) as 64-bit words.
+
+	const auto slots = static_cast<uint>(indices.size() - indices.size() % 3);
+
+	std::unique_ptr<std::atomic<uint>[]> counts(new std::atomic<uint>[vertices_size + 1]);
+
+	pool.ParallelFor(0, vertices_size + 1, 4096, [&](uint first, uint last)
+	{
+		for (auto v = first; v < last; v++)
+		{
+			counts[v].store(0, std::memory_order_relaxed);
 		}
-	}
+	});
+
+	pool.ParallelFor(0, slots, 4096, [&](uint first, uint last)
+	{
+		for (auto s = first; s < last; s++)
+		{
+			const auto low = std::min(indices[s], indices[Next(s)]);
+			counts[low].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	std::vector<uint> buckets(vertices_size + 1);
+
+	pool.ParallelFor(0, vertices_size + 1, 4096, [&](uint first, uint last)
+	{
+		for (auto v = first; v < last; v++)
+		{
+			buckets[v] = counts[v].load(std::memory_order_relaxed);
+		}
+	});
+
+	Scan(buckets, pool);
+
+	pool.ParallelFor(0, vertices_size, 4096, [&](uint first, uint last)
+	{
+		for (auto v = first; v < last; v++)
+		{
+			counts[v].store(buckets[v], std::memory_order_relaxed);
+		}
+	});
+
+	std::vector<unsigned long long> entries(slots);
+
+	pool.ParallelFor(0, slots, 4096, [&](uint first, uint last)
+	{
+		for (auto s = first; s < last; s++)
+		{
+			const auto i1 = indices[s];
+			const auto i2 = indices[Next(s)];
+
+			const auto position = counts[std::min(i1, i2)].fetch_add(1, std::memory_order_relaxed);
+			entries[position] = (static_cast<unsigned long long>(std::max(i1, i2)) << 32) | s;
+		}
+	});
+
+	counts.reset();
+
+	// sort each bucket and flag the first entry of every edge
+
+	std::vector<uint> groups(slots);
+
+	pool.ParallelFor(0, vertices_size, 1024, [&](uint first, uint last)
+	{
+		for (auto v = first; v < last; v++)
+		{
+			const auto begin = buckets[v];
+			const auto end = buckets[v + 1];
+
+			SortRange(entries.data() + begin, entries.data() + end);
+
+			for (auto i = begin; i < end; i++)
+			{
+				groups[i] = ((i == begin) || ((entries[i] >> 32) != (entries[i - 1] >> 32))) ? 1 : 0;
+			}
+		}
+	});
+
+	buckets = std::vector<uint>();
+
+	std::vector<uint> starts(slots + 1);
+
+	pool.ParallelFor(0, slots, 4096, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			starts[i] = groups[i];
+		}
+	});
+
+	const auto edges_size = Scan(groups, pool);
+
+	pool.ParallelFor(0, slots, 4096, [&](uint first, uint last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			if (starts[i])
+			{
+				starts[groups[i]] = i;
+			}
+		}
+	});
+
+	starts[edges_size] = slots;
+	starts.resize(edges_size + 1);
+	groups = std::vector<uint>();
+
+	// edges are numbered by the slot that first meets them, as a serial scan would
+
+	std::vector<uint> slot_edges(slots, 0);
+
+	pool.ParallelFor(0, edges_size, 4096, [&](uint first, uint last)
+	{
+		for (auto g = first; g < last; g++)
+		{
+			slot_edges[static_cast<uint>(entries[starts[g]])] = 1;
+		}
+	});
+
+	Scan(slot_edges, pool);
+
+	edges.assign(edges_size, Edge(0, 0));
+	edge_triangle_offsets.assign(edges_size + 1, 0);
+
+	pool.ParallelFor(0, edges_size, 4096, [&](uint first, uint last)
+	{
+		for (auto g = first; g < last; g++)
+		{
+			const auto slot = static_cast<uint>(entries[starts[g]]);
+			const auto edge = slot_edges[slot];
+
+			edges[edge] = Edge(indices[slot], indices[Next(slot)]);
+			edge_triangle_offsets[edge] = starts[g + 1] - starts[g];
+		}
+	});
+
+	Scan(edge_triangle_offsets, pool);
+	edge_triangles.resize(slots);
+
+	pool.ParallelFor(0, edges_size, 4096, [&](uint first, uint last)
+	{
+		for (auto g = first; g < last; g++)
+		{
+			const auto begin = starts[g];
+			const auto end = starts[g + 1];
+
+			const auto edge = slot_edges[static_cast<uint>(entries[begin])];
+			const auto offset = edge_triangle_offsets[edge];
+
+			for (auto i = begin; i < end; i++)
+			{
+				edge_triangles[offset + i - begin] = static_cast<uint>(entries[i]) / 3;
+			}
+
+			auto &E = edges[edge];
+			E.boundary = (end - begin <= 1);
+			if (!E.boundary)
+			{
+				const auto t1 = static_cast<uint>(entries[begin + 0]) / 3;
+				const auto t2 = static_cast<uint>(entries[begin + 1]) / 3;
+
+				E.ind3 = GetIndex(indices, t1, E.ind1, E.ind2);
+				E.ind4 = GetIndex(indices, t2, E.ind1, E.ind2);
+			}
+		}
+	});
+
+	entries = std::vector<unsigned long long>();
+	starts = std::vector<uint>();
+	slot_edges = std::vector<uint>();
+
+	GenerateVertexAdjacency(vertices_size, indices, pool);
+}
+
+//==============================================================================
+
+Topology::Topology(uint nx, uint ny, const std::vector<uint> &indices, ThreadPool &pool) noexcept
+{
+	// A cell meets its top and right edges and its diagonal first; its bottom
+	// and left edges are new only on the j = 0 and i = 0 borders.
+
+	const auto cells = nx * ny;
+	const auto edges_size = (cells == 0) ? 0 : 3 * cells + nx + ny;
+
+	edges.assign(edges_size, Edge(0, 0));
+	edge_triangle_offsets.assign(edges_size + 1, 0);
+
+	std::vector<uint> slots(edges_size);
+	std::vector<uint> others(edges_size);
+
+	pool.ParallelFor(0, cells, 1024, [&](uint first, uint last)
+	{
+		for (auto c = first; c < last; c++)
+		{
+			const auto i = c / ny;
+			const auto j = c % ny;
+
+			const auto A = 2 * c;
+			const auto B = 2 * c + 1;
+
+			// triangle of the next cell in i holding its left edge, and of the next cell in j holding its bottom edge
+			const auto next_i = (i + 1 < nx) ? ((i + 1 < nx / 2) ? 2 * (c + ny) : 2 * (c + ny) + 1) : ~0u;
+			const auto next_j = (j + 1 < ny) ? 2 * (c + 1) : ~0u;
+
+			auto edge = 3 * c + (i + ((j > 0) ? 1 : 0)) + ((i > 0) ? ny : j);
+
+			const auto Add = [&](uint slot, uint other)
+			{
+				slots[edge] = slot;
+				others[edge] = other;
+				edge_triangle_offsets[edge] = (other == ~0u) ? 1 : 2;
+				edge++;
+			};
+
+			if (i < nx / 2)
+			{
+				if (j == 0)
+				{
+					Add(3 * A + 0, ~0u);
+				}
+				Add(3 * A + 1, B);
+				if (i == 0)
+				{
+					Add(3 * A + 2, ~0u);
+				}
+				Add(3 * B + 0, next_j);
+				Add(3 * B + 2, next_i);
+			}
+			else
+			{
+				if (j == 0)
+				{
+					Add(3 * A + 0, ~0u);
+				}
+				Add(3 * A + 1, next_i);
+				Add(3 * A + 2, B);
+				if (i == 0)
+				{
+					Add(3 * B + 0, ~0u);
+				}
+				Add(3 * B + 2, next_j);
+			}
+		}
+	});
+
+	Scan(edge_triangle_offsets, pool);
+	edge_triangles.resize(edge_triangle_offsets[edges_size]);
+
+	pool.ParallelFor(0, edges_size, 4096, [&](uint first, uint last)
+	{
+		for (auto e = first; e < last; e++)
+		{
+			const auto slot = slots[e];
+			const auto t1 = slot / 3;
+			const auto t2 = others[e];
+
+			auto &E = edges[e];
+			E = Edge(indices[slot], indices[Next(slot)]);
+
+			const auto offset = edge_triangle_offsets[e];
+			edge_triangles[offset] = t1;
+
+			E.boundary = (t2 == ~0u);
+			if (!E.boundary)
+			{
+				edge_triangles[offset + 1] = t2;
+
+				E.ind3 = GetIndex(indices, t1, E.ind1, E.ind2);
+				E.ind4 = GetIndex(indices, t2, E.ind1, E.ind2);
+			}
+		}
+	});
+
+	slots = std::vector<uint>();
+	others = std::vector<uint>();
+
+	// Every edge at a vertex is first met by one of the (up to four) cells around it,
+	// so visiting those cells in order lists the vertex edges and triangles sorted.
+
+	const auto vertices_size = (nx + 1) * (ny + 1);
+
+	const auto Visit = [&](uint vertex, uint *vertex_edge, uint *vertex_triangle, uint &edges_count, uint &triangles_count)
+	{
+		const auto i = vertex / (ny + 1);
+		const auto j = vertex % (ny + 1);
+
+		edges_count = 0;
+		triangles_count = 0;
+
+		for (uint di = 0; di < 2; di++)
+		{
+			for (uint dj = 0; dj < 2; dj++)
+			{
+				if ((i + di < 1) || (i + di > nx) || (j + dj < 1) || (j + dj > ny))
+				{
+					continue;
+				}
+
+				const auto ci = i + di - 1;
+				const auto cj = j + dj - 1;
+				const auto c = ci * ny + cj;
+
+				const auto begin = 3 * c + (ci + ((cj > 0) ? 1 : 0)) + ((ci > 0) ? ny : cj);
+				const auto end = begin + 3 + ((cj == 0) ? 1 : 0) + ((ci == 0) ? 1 : 0);
+
+				for (auto e = begin; e < end; e++)
+				{
+					if ((edges[e].ind1 == vertex) || (edges[e].ind2 == vertex))
+					{
+						if (vertex_edge)
+						{
+							vertex_edge[edges_count] = e;
+						}
+						edges_count++;
+					}
+				}
+
+				for (auto t = 2 * c; t < 2 * c + 2; t++)
+				{
+					if ((indices[3 * t + 0] == vertex) || (indices[3 * t + 1] == vertex) || (indices[3 * t + 2] == vertex))
+					{
+						if (vertex_triangle)
+						{
+							vertex_triangle[triangles_count] = t;
+						}
+						triangles_count++;
+					}
+				}
+			}
+		}
+	};
+
+	vertex_edge_offsets.assign(vertices_size + 1, 0);
+	vertex_triangle_offsets.assign(vertices_size + 1, 0);
+
+	pool.ParallelFor(0, vertices_size, 4096, [&](uint first, uint last)
+	{
+		for (auto v = first; v < last; v++)
+		{
+			Visit(v, nullptr, nullptr, vertex_edge_offsets[v], vertex_triangle_offsets[v]);
+		}
+	});
+
+	vertex_edges.resize(Scan(vertex_edge_offsets, pool));
+	vertex_triangles.resize(Scan(vertex_triangle_offsets, pool));
+
+	pool.ParallelFor(0, vertices_size, 4096, [&](uint first, uint last)
+	{
+		uint edges_count = 0;
+		uint triangles_count = 0;
+
+		for (auto v = first; v < last; v++)
+		{
+			Visit(v, vertex_edges.data() + vertex_edge_offsets[v], vertex_triangles.data() + vertex_triangle_offsets[v],
+			      edges_count, triangles_count);
+		}
+	});
 }
 
 //==============================================================================
@@ -98,3 +602,58 @@ const std::vector<Topology::Edge> &Topology::GetEdges() const noexcept
 }
 
 //==============================================================================
+
+Topology::Range Topology::GetVertexEdges(uint vertex) const noexcept
+{
+	return Range{ vertex_edges.data() + vertex_edge_offsets[vertex], vertex_edges.data() + vertex_edge_offsets[vertex + 1] };
+}
+
+//==============================================================================
+
+Topology::Range Topology::GetVertexTriangles(uint vertex) const noexcept
+{
+	return Range{ vertex_triangles.data() + vertex_triangle_offsets[vertex], vertex_triangles.data() + vertex_triangle_offsets[vertex + 1] };
+}
+
+//==============================================================================
+
+Topology::Range Topology::GetEdgeTriangles(uint edge) const noexcept
+{
+	return Range{ edge_triangles.data() + edge_triangle_offsets[edge], edge_triangles.data() + edge_triangle_offsets[edge + 1] };
+}
+
+//==============================================================================
+
+bool Topology::IsAdjacent(uint ind1, uint ind2) const noexcept
+{
+	const auto edges1 = GetVertexEdges(ind1);
+	const auto edges2 = GetVertexEdges(ind2);
+
+	const auto swap = (edges2.size() < edges1.size());
+
+	const auto vertex = swap ? ind2 : ind1;
+	const auto other = swap ? ind1 : ind2;
+
+	for (const auto edge : swap ? edges2 : edges1)
+	{
+		const auto &E = edges[edge];
+		if (((E.ind1 == vertex) ? E.ind2 : E.ind1) == other)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//==============================================================================
+
+void Topology::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	report.Add(prefix + "edges", MemoryReport::GetBytes(edges));
+	report.Add(prefix + "vertices_edges", MemoryReport::GetBytes(vertex_edge_offsets) + MemoryReport::GetBytes(vertex_edges));
+	report.Add(prefix + "vertices_triangles", MemoryReport::GetBytes(vertex_triangle_offsets) + MemoryReport::GetBytes(vertex_triangles));
+	report.Add(prefix + "edges_triangles", MemoryReport::GetBytes(edge_triangle_offsets) + MemoryReport::GetBytes(edge_triangles));
+}
+
+//==============================================================================
@@ -3,13 +3,16 @@
 
 //==============================================================================
 
-#include <unordered_map>
+#include <string>
 #include <vector>
 
 //==============================================================================
 
 typedef unsigned int uint;
 
+class MemoryReport;
+class ThreadPool;
+
 //==============================================================================
 
 class Topology
@@ -33,17 +36,60 @@ public:
 		}
 	};
 
+	// contiguous run of indices inside one of the adjacency arrays
+	struct Range
+	{
+		const uint *first;
+		const uint *last;
+
+		const uint *begin() const noexcept
+		{
+			return first;
+		}
+
+		const uint *end() const noexcept
+		{
+			return last;
+		}
+
+		uint size() const noexcept
+		{
+			return static_cast<uint>(last - first);
+		}
+	};
+
 private:
 	std::vector<Edge> edges;
 
-	std::vector<std::vector<uint>> vertices_edges;
-	std::vector<std::unordered_map<uint, uint>> vertices_vertices_edges;
-	std::vector<std::vector<uint>> edges_triangles;
+	// compressed rows: the entries of row i are values[offsets[i]] .. values[offsets[i + 1] - 1]
+	std::vector<uint> vertex_edge_offsets;
+	std::vector<uint> vertex_edges;
+	std::vector<uint> vertex_triangle_offsets;
+	std::vector<uint> vertex_triangles;
+	std::vector<uint> edge_triangle_offsets;
+	std::vector<uint> edge_triangles;
+
+private:
+	void GenerateVertexAdjacency(uint vertices_size, const std::vector<uint> &indices, ThreadPool &pool) noexcept;
 
 public:
-	Topology(uint vertices_size, const std::vector<uint> &indices) noexcept;
+	Topology(uint vertices_size, const std::vector<uint> &indices, ThreadPool &pool) noexcept;
+
+	// Regular nx * ny grid as generated by Cloth: vertex (i, j) is i * (ny + 1) + j,
+	// cell (i, j) holds triangles 2 * (i * ny + j) and 2 * (i * ny + j) + 1 and is
+	// split along (i + 1, j)-(i, j + 1) for i < nx / 2 and along (i, j)-(i + 1, j + 1) otherwise.
+	// Produces the same result as the general constructor without sorting.
+	Topology(uint nx, uint ny, const std::vector<uint> &indices, ThreadPool &pool) noexcept;
 
 	const std::vector<Edge> &GetEdges() const noexcept;
+
+	Range GetVertexEdges(uint vertex) const noexcept;
+	Range GetVertexTriangles(uint vertex) const noexcept;
+	Range GetEdgeTriangles(uint edge) const noexcept;
+
+	bool IsAdjacent(uint ind1, uint ind2) const noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
 };
 
 //==============================================================================
@@ -0,0 +1,214 @@
+
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//==============================================================================
+
+namespace
+{
+	struct Event
+	{
+		const char *name;
+		unsigned long long time; // nanoseconds since the trace started
+		char phase;
+	};
+
+	// allocated when the thread registers, its pages are touched as it fills
+	constexpr uint max_events = 1 << 20;
+
+	// written only by the owning thread; size is published after the event.
+	// A scope is only begun with room left for its end and the ends of the
+	// scopes still open, so once full whole scopes are dropped, never an end.
+	struct Buffer
+	{
+		uint thread;
+		std::string name;
+		std::unique_ptr<Event[]> events;
+		std::atomic<uint> size;
+		uint open;    // recorded scopes that have not ended
+		uint dropped; // dropped scopes that have not ended, nested inside each other
+		std::atomic<unsigned long long> drops;
+
+		explicit Buffer(uint thread) noexcept :
+			thread(thread),
+			name("thread " + std::to_string(thread)),
+			events(new Event[max_events]),
+			size(0),
+			open(0),
+			dropped(0),
+			drops(0)
+		{
+		}
+	};
+
+	struct Registry;
+
+	bool WriteRegistry(Registry &registry, const std::string &path) noexcept;
+
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<Buffer>> buffers;
+		std::chrono::steady_clock::time_point start;
+		std::string output;
+
+		Registry() noexcept :
+			start(std::chrono::steady_clock::now())
+		{
+		}
+
+		~Registry() noexcept
+		{
+			if (!output.empty())
+			{
+				WriteRegistry(*this, output);
+			}
+		}
+	};
+
+	Registry &GetRegistry() noexcept
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	thread_local Buffer *thread_buffer = nullptr;
+
+	Buffer &GetBuffer() noexcept
+	{
+		if (!thread_buffer)
+		{
+			auto &registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+
+			const auto thread = static_cast<uint>(registry.buffers.size());
+			registry.buffers.emplace_back(new Buffer(thread));
+			thread_buffer = registry.buffers.back().get();
+		}
+
+		return *thread_buffer;
+	}
+
+	void Record(Buffer &buffer, const char *name, char phase) noexcept
+	{
+		const auto index = buffer.size.load(std::memory_order_relaxed);
+
+		const auto elapsed = std::chrono::steady_clock::now() - GetRegistry().start;
+		const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+		buffer.events[index] = { name, static_cast<unsigned long long>(time), phase };
+		buffer.size.store(index + 1, std::memory_order_release);
+	}
+
+	bool WriteRegistry(Registry &registry, const std::string &path) noexcept
+	{
+		const auto file = fopen(path.c_str(), "w");
+		if (!file)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		fprintf(file, "{\"traceEvents\":[\n");
+
+		auto first = true;
+		for (const auto &buffer : registry.buffers)
+		{
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			        first ? "" : ",\n", buffer->thread, buffer->name.c_str());
+			first = false;
+
+			const auto size = buffer->size.load(std::memory_order_acquire);
+			for (uint i = 0; i < size; i++)
+			{
+				const auto &event = buffer->events[i];
+
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+				        event.name, event.phase, 1.0e-3 * static_cast<double>(event.time), buffer->thread);
+			}
+		}
+
+		fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+		for (const auto &buffer : registry.buffers)
+		{
+			const auto drops = buffer->drops.load(std::memory_order_relaxed);
+			if (drops)
+			{
+				fprintf(stderr, "trace: %s was full, %llu scopes dropped\n", buffer->name.c_str(), drops);
+			}
+		}
+
+		return fclose(file) == 0;
+	}
+}
+
+//==============================================================================
+
+void Trace::Begin(const char *name) noexcept
+{
+	auto &buffer = GetBuffer();
+
+	const auto size = buffer.size.load(std::memory_order_relaxed);
+	if (buffer.dropped || (size + buffer.open + 2 > max_events))
+	{
+		buffer.dropped++;
+		buffer.drops.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Record(buffer, name, 'B');
+	buffer.open++;
+}
+
+//==============================================================================
+
+void Trace::End(const char *name) noexcept
+{
+	auto &buffer = GetBuffer();
+
+	if (buffer.dropped)
+	{
+		buffer.dropped--;
+		return;
+	}
+
+	Record(buffer, name, 'E');
+	buffer.open--;
+}
+
+//==============================================================================
+
+void Trace::SetThreadName(const char *name) noexcept
+{
+	auto &buffer = GetBuffer();
+
+	std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+	buffer.name = name + (" " + std::to_string(buffer.thread));
+}
+
+//==============================================================================
+
+bool Trace::Write(const std::string &path) noexcept
+{
+	return WriteRegistry(GetRegistry(), path);
+}
+
+//==============================================================================
+
+void Trace::SetOutput(const std::string &path) noexcept
+{
+	auto &registry = GetRegistry();
+
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	registry.output = path;
+}
+
+//==============================================================================
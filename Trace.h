@@ -0,0 +1,59 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+//==============================================================================
+
+class Trace
+{
+public:
+	static void Begin(const char *name) noexcept;
+	static void End(const char *name) noexcept;
+	static void SetThreadName(const char *name) noexcept;
+
+	static bool Write(const std::string &path) noexcept;
+	static void SetOutput(const std::string &path) noexcept;
+};
+
+//==============================================================================
+
+class TraceScope
+{
+private:
+	const char *name;
+
+public:
+	explicit TraceScope(const char *name) noexcept :
+		name(name)
+	{
+		Trace::Begin(name);
+	}
+
+	TraceScope(const TraceScope &) = delete;
+
+	~TraceScope() noexcept
+	{
+		Trace::End(name);
+	}
+};
+
+//==============================================================================
+
+#ifdef CLOTH_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_THREAD(name) Trace::SetThreadName(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+#endif
+
+//==============================================================================
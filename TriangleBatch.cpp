@@ -0,0 +1,474 @@
+
+#include "TriangleBatch.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "MemoryReport.h"
+#include "ThreadPool.h"
+
+#if defined(__AVX__)
+#define TRIANGLE_BATCH_AVX
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define TRIANGLE_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+//==============================================================================
+
+// every path the compiler targets is built, the widest one serves Intersect
+namespace
+{
+
+#if defined(TRIANGLE_BATCH_AVX)
+constexpr auto widest_path = TriangleBatch::Path::AVX;
+#elif defined(TRIANGLE_BATCH_SSE2)
+constexpr auto widest_path = TriangleBatch::Path::SSE2;
+#else
+constexpr auto widest_path = TriangleBatch::Path::SCALAR;
+#endif
+
+
+#if defined(TRIANGLE_BATCH_AVX)
+
+struct AvxLanes
+{
+	static constexpr uint width = 8;
+
+	__m256 value;
+
+	AvxLanes(__m256 value) noexcept : value(value) {}
+
+	static AvxLanes Load(const float *p) noexcept { return _mm256_loadu_ps(p); }
+	static AvxLanes Set(float x)         noexcept { return _mm256_set1_ps(x); }
+	static AvxLanes Bits(uint x)         noexcept { return _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(x))); }
+	static AvxLanes Index(uint base)     noexcept
+	{
+		const auto b = static_cast<int>(base);
+		return _mm256_castsi256_ps(_mm256_setr_epi32(b, b + 1, b + 2, b + 3, b + 4, b + 5, b + 6, b + 7));
+	}
+
+	void Store(float *p) const noexcept { _mm256_storeu_ps(p, value); }
+};
+
+inline AvxLanes operator+ (AvxLanes a, AvxLanes b) noexcept { return _mm256_add_ps(a.value, b.value); }
+inline AvxLanes operator- (AvxLanes a, AvxLanes b) noexcept { return _mm256_sub_ps(a.value, b.value); }
+inline AvxLanes operator* (AvxLanes a, AvxLanes b) noexcept { return _mm256_mul_ps(a.value, b.value); }
+inline AvxLanes operator/ (AvxLanes a, AvxLanes b) noexcept { return _mm256_div_ps(a.value, b.value); }
+inline AvxLanes operator& (AvxLanes a, AvxLanes b) noexcept { return _mm256_and_ps(a.value, b.value); }
+inline AvxLanes operator< (AvxLanes a, AvxLanes b) noexcept { return _mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ); }
+inline AvxLanes operator<=(AvxLanes a, AvxLanes b) noexcept { return _mm256_cmp_ps(a.value, b.value, _CMP_LE_OQ); }
+inline AvxLanes operator!=(AvxLanes a, AvxLanes b) noexcept { return _mm256_cmp_ps(a.value, b.value, _CMP_NEQ_OQ); }
+
+inline AvxLanes Select(AvxLanes mask, AvxLanes a, AvxLanes b) noexcept { return _mm256_blendv_ps(b.value, a.value, mask.value); }
+inline bool     Any(AvxLanes mask)                            noexcept { return _mm256_movemask_ps(mask.value) != 0; }
+
+#endif
+
+#if defined(TRIANGLE_BATCH_SSE2)
+
+struct Sse2Lanes
+{
+	static constexpr uint width = 4;
+
+	__m128 value;
+
+	Sse2Lanes(__m128 value) noexcept : value(value) {}
+
+	static Sse2Lanes Load(const float *p) noexcept { return _mm_loadu_ps(p); }
+	static Sse2Lanes Set(float x)         noexcept { return _mm_set1_ps(x); }
+	static Sse2Lanes Bits(uint x)         noexcept { return _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(x))); }
+	static Sse2Lanes Index(uint base)     noexcept
+	{
+		const auto b = static_cast<int>(base);
+		return _mm_castsi128_ps(_mm_setr_epi32(b, b + 1, b + 2, b + 3));
+	}
+
+	void Store(float *p) const noexcept { _mm_storeu_ps(p, value); }
+};
+
+inline Sse2Lanes operator+ (Sse2Lanes a, Sse2Lanes b) noexcept { return _mm_add_ps(a.value, b.value); }
+inline Sse2Lanes operator- (Sse2Lanes a, Sse2Lanes b) noexcept { return _mm_sub_ps(a.value, b.value); }
+inline Sse2Lanes operator* (Sse2Lanes a, Sse2Lanes b) noexcept { return _mm_mul_ps(a.value, b.value); }
+inline Sse2Lanes operator/ (Sse2Lanes a, Sse2Lanes b) noexcept { return _mm_div_ps(a.value, b.value); }
+inline Sse2Lanes operator& (Sse2Lanes a, Sse2Lanes b) noexcept { return _mm_and_ps(a.value, b.value); }
+inline Sse2Lanes operator< (Sse2Lanes a, Sse2Lanes b) noexcept { return _mm_cmplt_ps(a.value, b.value); }
+inline Sse2Lanes operator<=(Sse2Lanes a, Sse2Lanes b) noexcept { return _mm_cmple_ps(a.value, b.value); }
+inline Sse2Lanes operator!=(Sse2Lanes a, Sse2Lanes b) noexcept { return _mm_cmpneq_ps(a.value, b.value); }
+
+inline Sse2Lanes Select(Sse2Lanes mask, Sse2Lanes a, Sse2Lanes b) noexcept
+{
+	return _mm_or_ps(_mm_and_ps(mask.value, a.value), _mm_andnot_ps(mask.value, b.value));
+}
+
+inline bool Any(Sse2Lanes mask) noexcept { return _mm_movemask_ps(mask.value) != 0; }
+
+#endif
+
+struct ScalarLanes
+{
+	static constexpr uint width = 1;
+
+	float value;
+
+	ScalarLanes(float value) noexcept : value(value) {}
+
+	static ScalarLanes Load(const float *p) noexcept { return *p; }
+	static ScalarLanes Set(float x)         noexcept { return x; }
+	static ScalarLanes Bits(uint x)         noexcept
+	{
+		float f;
+		std::memcpy(&f, &x, sizeof(f));
+		return f;
+	}
+	static ScalarLanes Index(uint base)     noexcept { return Bits(base); }
+
+	void Store(float *p) const noexcept { *p = value; }
+};
+
+inline ScalarLanes operator+ (ScalarLanes a, ScalarLanes b) noexcept { return a.value + b.value; }
+inline ScalarLanes operator- (ScalarLanes a, ScalarLanes b) noexcept { return a.value - b.value; }
+inline ScalarLanes operator* (ScalarLanes a, ScalarLanes b) noexcept { return a.value * b.value; }
+inline ScalarLanes operator/ (ScalarLanes a, ScalarLanes b) noexcept { return a.value / b.value; }
+inline ScalarLanes operator& (ScalarLanes a, ScalarLanes b) noexcept { return ((a.value != 0.0f) && (b.value != 0.0f)) ? 1.0f : 0.0f; }
+inline ScalarLanes operator< (ScalarLanes a, ScalarLanes b) noexcept { return (a.value <  b.value) ? 1.0f : 0.0f; }
+inline ScalarLanes operator<=(ScalarLanes a, ScalarLanes b) noexcept { return (a.value <= b.value) ? 1.0f : 0.0f; }
+inline ScalarLanes operator!=(ScalarLanes a, ScalarLanes b) noexcept { return (a.value != b.value) ? 1.0f : 0.0f; }
+
+inline ScalarLanes Select(ScalarLanes mask, ScalarLanes a, ScalarLanes b) noexcept { return (mask.value != 0.0f) ? a : b; }
+inline bool        Any(ScalarLanes mask)                               noexcept { return mask.value != 0.0f; }
+
+//==============================================================================
+
+template <typename Lanes>
+struct RayLanes
+{
+	Lanes ox, oy, oz;
+	Lanes dx, dy, dz;
+
+	Lanes t, u, v, triangle;
+
+	RayLanes() noexcept :
+		ox(Lanes::Set(0.0f)), oy(Lanes::Set(0.0f)), oz(Lanes::Set(0.0f)),
+		dx(Lanes::Set(0.0f)), dy(Lanes::Set(0.0f)), dz(Lanes::Set(0.0f)),
+		t(Lanes::Set(FLT_MAX)),
+		u(Lanes::Set(0.0f)),
+		v(Lanes::Set(0.0f)),
+		triangle(Lanes::Bits(RayHit::none))
+	{
+	}
+
+	explicit RayLanes(const Ray &ray) noexcept :
+		RayLanes()
+	{
+		const auto &O = ray.GetOrigin();
+		const auto D = ray.GetEnd() - O;
+
+		ox = Lanes::Set(O.x);
+		oy = Lanes::Set(O.y);
+		oz = Lanes::Set(O.z);
+
+		dx = Lanes::Set(D.x);
+		dy = Lanes::Set(D.y);
+		dz = Lanes::Set(D.z);
+	}
+
+	bool Reduce(RayHit &hit) const noexcept
+	{
+		float T[Lanes::width], U[Lanes::width], V[Lanes::width], I[Lanes::width];
+		t.Store(T);
+		u.Store(U);
+		v.Store(V);
+		triangle.Store(I);
+
+		hit = RayHit();
+
+		auto tmin = FLT_MAX;
+		for (uint i = 0; i < Lanes::width; i++)
+		{
+			if (T[i] < tmin)
+			{
+				tmin = T[i];
+
+				std::memcpy(&hit.triangle, &I[i], sizeof(uint));
+				hit.t = T[i];
+				hit.u = U[i];
+				hit.v = V[i];
+			}
+		}
+
+		return hit.IsHit();
+	}
+};
+
+}
+
+//==============================================================================
+
+TriangleBatch::TriangleBatch() noexcept :
+	size(0)
+{
+}
+
+//==============================================================================
+
+uint TriangleBatch::GetSize() const noexcept
+{
+	return size;
+}
+
+//==============================================================================
+
+void TriangleBatch::Resize(uint value) noexcept
+{
+	size = value;
+
+	const auto padded = (size + packet_size - 1) / packet_size * packet_size;
+
+	for (auto array : { &ax, &ay, &az, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z })
+	{
+		if (array->size() != padded)
+		{
+			array->assign(padded, 0.0f);
+		}
+
+		// degenerate padding never hits, even after shrinking
+		std::fill(array->begin() + size, array->end(), 0.0f);
+	}
+}
+
+//==============================================================================
+
+void TriangleBatch::Set(uint index, const glm::vec3 &A, const glm::vec3 &B, const glm::vec3 &C) noexcept
+{
+	const auto AB = B - A;
+	const auto AC = C - A;
+
+	ax[index] = A.x;
+	ay[index] = A.y;
+	az[index] = A.z;
+
+	e1x[index] = AB.x;
+	e1y[index] = AB.y;
+	e1z[index] = AB.z;
+
+	e2x[index] = AC.x;
+	e2y[index] = AC.y;
+	e2z[index] = AC.z;
+}
+
+//==============================================================================
+
+template <typename Lanes>
+static void IntersectLanes(RayLanes<Lanes> &ray,
+	                       Lanes ax,  Lanes ay,  Lanes az,
+	                       Lanes e1x, Lanes e1y, Lanes e1z,
+	                       Lanes e2x, Lanes e2y, Lanes e2z,
+	                       Lanes index) noexcept
+{
+	const auto zero = Lanes::Set(0.0f);
+	const auto one  = Lanes::Set(1.0f);
+
+	const auto px = ray.dy * e2z - ray.dz * e2y;
+	const auto py = ray.dz * e2x - ray.dx * e2z;
+	const auto pz = ray.dx * e2y - ray.dy * e2x;
+
+	const auto det = e1x * px + e1y * py + e1z * pz;
+	const auto inv_det = one / det;
+
+	const auto tx = ray.ox - ax;
+	const auto ty = ray.oy - ay;
+	const auto tz = ray.oz - az;
+
+	const auto u = (tx * px + ty * py + tz * pz) * inv_det;
+
+	const auto qx = ty * e1z - tz * e1y;
+	const auto qy = tz * e1x - tx * e1z;
+	const auto qz = tx * e1y - ty * e1x;
+
+	const auto v = (ray.dx * qx + ray.dy * qy + ray.dz * qz) * inv_det;
+	const auto t = (e2x * qx + e2y * qy + e2z * qz) * inv_det;
+
+	const auto mask = (det != zero) & (zero <= u) & (zero <= v) & ((u + v) <= one) &
+	                  (zero < t) & (t < ray.t);
+
+	if (Any(mask))
+	{
+		ray.t        = Select(mask, t, ray.t);
+		ray.u        = Select(mask, u, ray.u);
+		ray.v        = Select(mask, v, ray.v);
+		ray.triangle = Select(mask, index, ray.triangle);
+	}
+}
+
+//==============================================================================
+
+template <typename Lanes>
+bool TriangleBatch::IntersectWith(const Ray &ray, RayHit &hit) const noexcept
+{
+	RayLanes<Lanes> lanes(ray);
+
+	const auto padded = static_cast<uint>(ax.size());
+	for (uint i = 0; i < padded; i += Lanes::width)
+	{
+		IntersectLanes(lanes,
+			Lanes::Load(&ax[i]),  Lanes::Load(&ay[i]),  Lanes::Load(&az[i]),
+			Lanes::Load(&e1x[i]), Lanes::Load(&e1y[i]), Lanes::Load(&e1z[i]),
+			Lanes::Load(&e2x[i]), Lanes::Load(&e2y[i]), Lanes::Load(&e2z[i]),
+			Lanes::Index(i));
+	}
+
+	return lanes.Reduce(hit);
+}
+
+//==============================================================================
+
+template <typename Lanes>
+void TriangleBatch::IntersectWith(const std::vector<Ray> &rays, std::vector<RayHit> &hits, ThreadPool &pool) const noexcept
+{
+	constexpr uint block_size = 16;
+
+	hits.resize(rays.size());
+
+	const auto padded = static_cast<uint>(ax.size());
+	const auto count  = static_cast<uint>(rays.size());
+	const auto blocks = (count + block_size - 1) / block_size;
+
+	pool.ParallelFor(0, blocks, 1, [&](uint begin, uint end)
+	{
+		for (auto b = begin; b < end; b++)
+		{
+			const auto first = b * block_size;
+			const auto last = (first + block_size < count) ? first + block_size : count;
+
+			RayLanes<Lanes> block[block_size];
+			for (auto r = first; r < last; r++)
+			{
+				block[r - first] = RayLanes<Lanes>(rays[r]);
+			}
+
+			for (uint i = 0; i < padded; i += Lanes::width)
+			{
+				const auto Ax  = Lanes::Load(&ax[i]);
+				const auto Ay  = Lanes::Load(&ay[i]);
+				const auto Az  = Lanes::Load(&az[i]);
+				const auto E1x = Lanes::Load(&e1x[i]);
+				const auto E1y = Lanes::Load(&e1y[i]);
+				const auto E1z = Lanes::Load(&e1z[i]);
+				const auto E2x = Lanes::Load(&e2x[i]);
+				const auto E2y = Lanes::Load(&e2y[i]);
+				const auto E2z = Lanes::Load(&e2z[i]);
+				const auto index = Lanes::Index(i);
+
+				for (auto r = first; r < last; r++)
+				{
+					IntersectLanes(block[r - first], Ax, Ay, Az, E1x, E1y, E1z, E2x, E2y, E2z, index);
+				}
+			}
+
+			for (auto r = first; r < last; r++)
+			{
+				block[r - first].Reduce(hits[r]);
+			}
+		}
+	});
+}
+
+//==============================================================================
+
+bool TriangleBatch::IsAvailable(Path path) noexcept
+{
+	switch (path)
+	{
+	case Path::SCALAR:
+		return true;
+
+#if defined(TRIANGLE_BATCH_SSE2)
+	case Path::SSE2:
+		return true;
+#endif
+
+#if defined(TRIANGLE_BATCH_AVX)
+	case Path::AVX:
+		return true;
+#endif
+
+	default:
+		return false;
+	}
+}
+
+//==============================================================================
+
+bool TriangleBatch::Intersect(const Ray &ray, RayHit &hit, Path path) const noexcept
+{
+	switch (path)
+	{
+#if defined(TRIANGLE_BATCH_AVX)
+	case Path::AVX:
+		return IntersectWith<AvxLanes>(ray, hit);
+#endif
+
+#if defined(TRIANGLE_BATCH_SSE2)
+	case Path::SSE2:
+		return IntersectWith<Sse2Lanes>(ray, hit);
+#endif
+
+	default:
+		return IntersectWith<ScalarLanes>(ray, hit);
+	}
+}
+
+//==============================================================================
+
+void TriangleBatch::Intersect(const std::vector<Ray> &rays, std::vector<RayHit> &hits, ThreadPool &pool, Path path) const noexcept
+{
+	switch (path)
+	{
+#if defined(TRIANGLE_BATCH_AVX)
+	case Path::AVX:
+		IntersectWith<AvxLanes>(rays, hits, pool);
+		break;
+#endif
+
+#if defined(TRIANGLE_BATCH_SSE2)
+	case Path::SSE2:
+		IntersectWith<Sse2Lanes>(rays, hits, pool);
+		break;
+#endif
+
+	default:
+		IntersectWith<ScalarLanes>(rays, hits, pool);
+		break;
+	}
+}
+
+//==============================================================================
+
+bool TriangleBatch::Intersect(const Ray &ray, RayHit &hit) const noexcept
+{
+	return Intersect(ray, hit, widest_path);
+}
+
+//==============================================================================
+
+void TriangleBatch::Intersect(const std::vector<Ray> &rays, std::vector<RayHit> &hits, ThreadPool &pool) const noexcept
+{
+	Intersect(rays, hits, pool, widest_path);
+}
+
+//==============================================================================
+
+void TriangleBatch::GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept
+{
+	const auto bytes = MemoryReport::GetBytes(ax) + MemoryReport::GetBytes(ay) + MemoryReport::GetBytes(az) +
+	                   MemoryReport::GetBytes(e1x) + MemoryReport::GetBytes(e1y) + MemoryReport::GetBytes(e1z) +
+	                   MemoryReport::GetBytes(e2x) + MemoryReport::GetBytes(e2y) + MemoryReport::GetBytes(e2z);
+
+	report.Add(prefix + "triangles", bytes);
+}
+
+//==============================================================================
@@ -0,0 +1,94 @@
+
+#pragma once
+
+//==============================================================================
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Ray.h"
+
+//==============================================================================
+
+typedef unsigned int uint;
+
+class MemoryReport;
+class ThreadPool;
+
+//==============================================================================
+
+struct RayHit
+{
+	static constexpr uint none = ~0u;
+
+	uint triangle;
+	float t;
+	float u;
+	float v;
+
+	RayHit() noexcept :
+		triangle(none),
+		t(0.0f),
+		u(0.0f),
+		v(0.0f)
+	{
+	}
+
+	bool IsHit() const noexcept
+	{
+		return triangle != none;
+	}
+};
+
+//==============================================================================
+
+class TriangleBatch
+{
+public:
+	static constexpr uint packet_size = 8;
+
+	// instruction sets of the intersection kernel, the widest one compiled in is the default
+	enum class Path
+	{
+		SCALAR,
+		SSE2,
+		AVX
+	};
+
+private:
+	uint size;
+
+	std::vector<float> ax, ay, az;
+	std::vector<float> e1x, e1y, e1z;
+	std::vector<float> e2x, e2y, e2z;
+
+private:
+	template <typename Lanes>
+	bool IntersectWith(const Ray &ray, RayHit &hit) const noexcept;
+
+	template <typename Lanes>
+	void IntersectWith(const std::vector<Ray> &rays, std::vector<RayHit> &hits, ThreadPool &pool) const noexcept;
+
+public:
+	TriangleBatch() noexcept;
+
+	static bool IsAvailable(Path path) noexcept;
+
+	uint GetSize() const noexcept;
+
+	void Resize(uint value) noexcept;
+	void Set(uint index, const glm::vec3 &A, const glm::vec3 &B, const glm::vec3 &C) noexcept;
+
+	bool Intersect(const Ray &ray, RayHit &hit) const noexcept;
+	void Intersect(const std::vector<Ray> &rays, std::vector<RayHit> &hits, ThreadPool &pool) const noexcept;
+
+	// a path that is not available runs the scalar kernel
+	bool Intersect(const Ray &ray, RayHit &hit, Path path) const noexcept;
+	void Intersect(const std::vector<Ray> &rays, std::vector<RayHit> &hits, ThreadPool &pool, Path path) const noexcept;
+
+	void GetMemoryUsage(MemoryReport &report, const std::string &prefix) const noexcept;
+};
+
+//==============================================================================